@@ -30,7 +30,15 @@ CRC_FUNC g_CrcUpdateT4;
 CRC_FUNC g_CrcUpdateT8;
 CRC_FUNC g_CrcUpdate;
 
-UInt32 g_CrcTable[256 * CRC_NUM_TABLES];
+#ifdef MY_CPU_LE
+  /* Table is precomputed and lives in read-only data */
+  #include "7zCrcTable.h"
+  #if CRC_TABLE_PRECOMPUTED_NUM_TABLES != CRC_NUM_TABLES
+    #error Precomputed CRC table does not match CRC_NUM_TABLES
+  #endif
+#else
+  UInt32 g_CrcTable[256 * CRC_NUM_TABLES];
+#endif
 
 UInt32 MY_FAST_CALL CrcUpdate(UInt32 v, const void *data, size_t size)
 {
@@ -55,6 +63,7 @@ UInt32 MY_FAST_CALL CrcUpdateT1(UInt32 v, const void *data, size_t size, const U
 
 void MY_FAST_CALL CrcGenerateTable()
 {
+  #ifndef MY_CPU_LE
   UInt32 i;
   for (i = 0; i < 256; i++)
   {
@@ -69,6 +78,7 @@ void MY_FAST_CALL CrcGenerateTable()
     UInt32 r = g_CrcTable[(size_t)i - 256];
     g_CrcTable[i] = g_CrcTable[r & 0xFF] ^ (r >> 8);
   }
+  #endif
 
   #if CRC_NUM_TABLES < 4
   
@@ -5,12 +5,18 @@
 #define __7Z_CRC_H
 
 #include "7zTypes.h"
+#include "CpuArch.h"
 
 EXTERN_C_BEGIN
 
+#ifdef MY_CPU_LE
+extern const UInt32 g_CrcTable[];
+#else
 extern UInt32 g_CrcTable[];
+#endif
 
-/* Call CrcGenerateTable one time before other CRC functions */
+/* Call CrcGenerateTable one time before other CRC functions.
+   On little-endian CPUs the table is precomputed and this only selects the update function. */
 void MY_FAST_CALL CrcGenerateTable(void);
 
 #define CRC_INIT_VAL 0xFFFFFFFF
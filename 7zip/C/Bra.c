@@ -61,6 +61,54 @@ SizeT ARM_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 }
 
 
+/* SevenInstall: ARM64.
+   BL: 26-bit word offset; ADRP: 21-bit page offset, converted only
+   for targets within +-512 MiB, so that other instructions with the
+   same opcode bits are left alone as far as possible. */
+SizeT ARM64_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
+{
+  Byte *p;
+  const Byte *lim;
+  size &= ~(size_t)3;
+  p = data;
+  lim = data + size;
+
+  for (; p < lim; p += 4)
+  {
+    UInt32 v = GetUi32(p);
+    UInt32 pc = ip + (UInt32)(p - data);
+
+    if ((v >> 26) == 0x25)
+    {
+      /* BL */
+      pc >>= 2;
+      if (!encoding)
+        pc = (UInt32)0 - pc;
+      v = 0x94000000 | ((v + pc) & 0x03FFFFFF);
+      SetUi32(p, v);
+    }
+    else if ((v & 0x9F000000) == 0x90000000)
+    {
+      /* ADRP */
+      UInt32 src = ((v >> 29) & 3) | ((v >> 3) & 0x001FFFFC);
+      UInt32 dest;
+      if (((src + 0x00020000) & 0x001C0000) != 0)
+        continue;
+      pc >>= 12;
+      if (!encoding)
+        pc = (UInt32)0 - pc;
+      dest = src + pc;
+      v &= 0x9000001F;
+      v |= (dest & 3) << 29;
+      v |= (dest & 0x0003FFFC) << 3;
+      v |= ((UInt32)0 - (dest & 0x00020000)) & 0x00E00000;
+      SetUi32(p, v);
+    }
+  }
+  return size;
+}
+
+
 SizeT ARMT_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 {
   Byte *p;
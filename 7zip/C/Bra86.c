@@ -4,6 +4,16 @@
 #include "Precomp.h"
 
 #include "Bra.h"
+#include "CpuArch.h"
+
+/* SevenInstall: find E8/E9 candidates 16 bytes at a time */
+#ifdef MY_CPU_X86_OR_AMD64
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define BRA86_USE_SSE2
+#endif
 
 #define Test86MSByte(b) ((((b) + 1) & 0xFE) == 0)
 
@@ -20,6 +30,28 @@ SizeT x86_Convert(Byte *data, SizeT size, UInt32 ip, UInt32 *state, int encoding
   {
     Byte *p = data + pos;
     const Byte *limit = data + size;
+    #ifdef BRA86_USE_SSE2
+    for (; limit - p >= 16; p += 16)
+    {
+      __m128i v = _mm_loadu_si128((const __m128i *)p);
+      v = _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8((char)0xFE)), _mm_set1_epi8((char)0xE8));
+      {
+        unsigned m = (unsigned)_mm_movemask_epi8(v);
+        if (m != 0)
+        {
+          /* the scalar loop below stops at the first candidate */
+          #ifdef _MSC_VER
+          unsigned long i;
+          _BitScanForward(&i, m);
+          p += i;
+          #else
+          p += __builtin_ctz(m);
+          #endif
+          break;
+        }
+      }
+    }
+    #endif
     for (; p < limit; p++)
       if ((*p & 0xFE) == 0xE8)
         break;
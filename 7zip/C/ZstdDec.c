@@ -0,0 +1,1064 @@
+/* ZstdDec.c -- Zstandard Decoder
+SevenInstall : Public domain
+This code implements the format described in RFC 8878.
+Dictionaries are not supported. */
+
+#include "Precomp.h"
+
+#include <string.h>
+
+#include "CpuArch.h"
+#include "ZstdDec.h"
+
+#ifdef _MSC_VER
+#include <stdlib.h>
+#define ZSTD_ROTL64(x, n) _rotl64((x), (n))
+#else
+#define ZSTD_ROTL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+#endif
+
+#define GetUi24(p) ((UInt32)GetUi16(p) | ((UInt32)((const Byte *)(p))[2] << 16))
+
+static unsigned HighBit32(UInt32 v)
+{
+  unsigned n = 0;
+  while (v >>= 1)
+    n++;
+  return n;
+}
+
+
+/* ---------- XXH64 ---------- */
+
+#define XXH_P1 UINT64_CONST(0x9E3779B185EBCA87)
+#define XXH_P2 UINT64_CONST(0xC2B2AE3D27D4EB4F)
+#define XXH_P3 UINT64_CONST(0x165667B19E3779F9)
+#define XXH_P4 UINT64_CONST(0x85EBCA77C2B2AE63)
+#define XXH_P5 UINT64_CONST(0x27D4EB2F165667C5)
+
+static UInt64 Xxh64_Round(UInt64 acc, UInt64 input)
+{
+  acc += input * XXH_P2;
+  acc = ZSTD_ROTL64(acc, 31);
+  return acc * XXH_P1;
+}
+
+static UInt64 Xxh64_MergeRound(UInt64 acc, UInt64 v)
+{
+  acc ^= Xxh64_Round(0, v);
+  return acc * XXH_P1 + XXH_P4;
+}
+
+void Xxh64_Init(CXxh64 *p)
+{
+  p->v[0] = XXH_P1 + XXH_P2;
+  p->v[1] = XXH_P2;
+  p->v[2] = 0;
+  p->v[3] = (UInt64)0 - XXH_P1;
+  p->totalSize = 0;
+  p->bufSize = 0;
+}
+
+static void Xxh64_Stripes(UInt64 *v, const Byte *data, size_t numStripes)
+{
+  UInt64 v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+  for (; numStripes != 0; numStripes--, data += 32)
+  {
+    v0 = Xxh64_Round(v0, GetUi64(data));
+    v1 = Xxh64_Round(v1, GetUi64(data + 8));
+    v2 = Xxh64_Round(v2, GetUi64(data + 16));
+    v3 = Xxh64_Round(v3, GetUi64(data + 24));
+  }
+  v[0] = v0; v[1] = v1; v[2] = v2; v[3] = v3;
+}
+
+void Xxh64_Update(CXxh64 *p, const void *data, size_t size)
+{
+  const Byte *d = (const Byte *)data;
+  p->totalSize += size;
+  if (p->bufSize != 0)
+  {
+    size_t rem = 32 - p->bufSize;
+    if (rem > size)
+      rem = size;
+    memcpy(p->buf + p->bufSize, d, rem);
+    p->bufSize += (unsigned)rem;
+    d += rem;
+    size -= rem;
+    if (p->bufSize != 32)
+      return;
+    Xxh64_Stripes(p->v, p->buf, 1);
+    p->bufSize = 0;
+  }
+  Xxh64_Stripes(p->v, d, size >> 5);
+  d += size & ~(size_t)31;
+  size &= 31;
+  memcpy(p->buf, d, size);
+  p->bufSize = (unsigned)size;
+}
+
+UInt64 Xxh64_Digest(const CXxh64 *p)
+{
+  UInt64 h;
+  const Byte *d = p->buf;
+  unsigned size = p->bufSize;
+  if (p->totalSize >= 32)
+  {
+    h = ZSTD_ROTL64(p->v[0], 1) + ZSTD_ROTL64(p->v[1], 7) + ZSTD_ROTL64(p->v[2], 12) + ZSTD_ROTL64(p->v[3], 18);
+    h = Xxh64_MergeRound(h, p->v[0]);
+    h = Xxh64_MergeRound(h, p->v[1]);
+    h = Xxh64_MergeRound(h, p->v[2]);
+    h = Xxh64_MergeRound(h, p->v[3]);
+  }
+  else
+    h = XXH_P5;
+  h += p->totalSize;
+  for (; size >= 8; size -= 8, d += 8)
+  {
+    h ^= Xxh64_Round(0, GetUi64(d));
+    h = ZSTD_ROTL64(h, 27) * XXH_P1 + XXH_P4;
+  }
+  if (size >= 4)
+  {
+    h ^= (UInt64)GetUi32(d) * XXH_P1;
+    h = ZSTD_ROTL64(h, 23) * XXH_P2 + XXH_P3;
+    size -= 4;
+    d += 4;
+  }
+  for (; size != 0; size--, d++)
+  {
+    h ^= *d * XXH_P5;
+    h = ZSTD_ROTL64(h, 11) * XXH_P1;
+  }
+  h ^= h >> 33;
+  h *= XXH_P2;
+  h ^= h >> 29;
+  h *= XXH_P3;
+  h ^= h >> 32;
+  return h;
+}
+
+
+/* ---------- Frame header ---------- */
+
+static const Byte k_DictIdSize[4] = { 0, 1, 2, 4 };
+
+unsigned ZstdFrameHeader_GetSize(const Byte *src)
+{
+  unsigned fhd = src[4];
+  unsigned fcsFlag = fhd >> 6;
+  unsigned singleSegment = (fhd >> 5) & 1;
+  return ZSTD_FRAME_HEADER_SIZE_MIN
+      + (singleSegment ^ 1)
+      + k_DictIdSize[fhd & 3]
+      + (fcsFlag == 0 ? singleSegment : ((unsigned)1 << fcsFlag));
+}
+
+SRes ZstdFrameHeader_Parse(CZstdFrameHeader *p, const Byte *src)
+{
+  unsigned fhd = src[4];
+  unsigned fcsFlag = fhd >> 6;
+  unsigned singleSegment = (fhd >> 5) & 1;
+  unsigned pos = ZSTD_FRAME_HEADER_SIZE_MIN;
+
+  if (fhd & 8)
+    return SZ_ERROR_DATA;
+  p->ChecksumFlag = (fhd >> 2) & 1;
+
+  p->WindowSize = 0;
+  if (!singleSegment)
+  {
+    unsigned wd = src[pos++];
+    UInt64 windowBase = (UInt64)1 << (10 + (wd >> 3));
+    p->WindowSize = windowBase + (windowBase >> 3) * (wd & 7);
+  }
+
+  switch (fhd & 3)
+  {
+    case 0: p->DictID = 0; break;
+    case 1: p->DictID = src[pos]; break;
+    case 2: p->DictID = GetUi16(src + pos); break;
+    default: p->DictID = GetUi32(src + pos); break;
+  }
+  pos += k_DictIdSize[fhd & 3];
+  if (p->DictID != 0)
+    return SZ_ERROR_UNSUPPORTED;
+
+  switch (fcsFlag)
+  {
+    case 0: p->ContentSize = singleSegment ? src[pos] : ZSTD_CONTENT_SIZE_UNKNOWN; break;
+    case 1: p->ContentSize = (UInt64)GetUi16(src + pos) + 256; break;
+    case 2: p->ContentSize = GetUi32(src + pos); break;
+    default: p->ContentSize = GetUi64(src + pos); break;
+  }
+  if (singleSegment)
+    p->WindowSize = p->ContentSize;
+  return SZ_OK;
+}
+
+
+/* ---------- Bit streams ---------- */
+
+/* Forward bit reading, for table descriptions.
+   Reading past the end returns zero bits; the caller checks the consumed size. */
+
+static UInt32 GetBitsFwd(const Byte *src, size_t srcSize, size_t bitPos, unsigned numBits)
+{
+  size_t bytePos = bitPos >> 3;
+  UInt32 v = 0;
+  unsigned i;
+  for (i = 0; i < 4 && bytePos + i < srcSize; i++)
+    v |= (UInt32)src[bytePos + i] << (8 * i);
+  return (v >> (bitPos & 7)) & (((UInt32)1 << numBits) - 1);
+}
+
+/* Backward bit reading: the stream is read from its last byte towards
+   its first one. The highest set bit of the last byte marks the start. */
+
+typedef struct
+{
+  UInt64 Value;
+  unsigned Consumed;
+  const Byte *Ptr;
+  const Byte *Start;
+} CBitRev;
+
+#define BITREV_UNFINISHED 0
+#define BITREV_END_OF_BUFFER 1
+#define BITREV_COMPLETED 2
+#define BITREV_OVERFLOW 3
+
+static SRes BitRev_Init(CBitRev *p, const Byte *src, size_t size)
+{
+  Byte last;
+  if (size == 0)
+    return SZ_ERROR_DATA;
+  last = src[size - 1];
+  if (last == 0)
+    return SZ_ERROR_DATA;
+  p->Start = src;
+  if (size >= 8)
+  {
+    p->Ptr = src + size - 8;
+    p->Value = GetUi64(p->Ptr);
+    p->Consumed = 0;
+  }
+  else
+  {
+    size_t i;
+    p->Ptr = src;
+    p->Value = 0;
+    for (i = 0; i < size; i++)
+      p->Value |= (UInt64)src[i] << (8 * i);
+    p->Consumed = (unsigned)(8 - size) * 8;
+  }
+  p->Consumed += 8 - HighBit32(last);
+  return SZ_OK;
+}
+
+static UInt32 BitRev_Peek(const CBitRev *p, unsigned numBits)
+{
+  /* (numBits == 0) is allowed */
+  return (UInt32)(((p->Value << (p->Consumed & 63)) >> 1) >> (63 - numBits));
+}
+
+static UInt32 BitRev_Read(CBitRev *p, unsigned numBits)
+{
+  UInt32 v = BitRev_Peek(p, numBits);
+  p->Consumed += numBits;
+  return v;
+}
+
+static unsigned BitRev_Reload(CBitRev *p)
+{
+  size_t numBytes;
+  unsigned res = BITREV_UNFINISHED;
+  if (p->Consumed > 64)
+    return BITREV_OVERFLOW;
+  if (p->Ptr >= p->Start + 8)
+  {
+    p->Ptr -= p->Consumed >> 3;
+    p->Consumed &= 7;
+    p->Value = GetUi64(p->Ptr);
+    return BITREV_UNFINISHED;
+  }
+  if (p->Ptr == p->Start)
+    return p->Consumed < 64 ? BITREV_END_OF_BUFFER : BITREV_COMPLETED;
+  numBytes = p->Consumed >> 3;
+  if (p->Ptr - numBytes < p->Start)
+  {
+    numBytes = (size_t)(p->Ptr - p->Start);
+    res = BITREV_END_OF_BUFFER;
+  }
+  p->Ptr -= numBytes;
+  p->Consumed -= (unsigned)numBytes * 8;
+  p->Value = GetUi64(p->Ptr);
+  return res;
+}
+
+#define BitRev_IsCompleted(p) ((p)->Ptr == (p)->Start && (p)->Consumed == 64)
+
+
+/* ---------- FSE ---------- */
+
+#define FSE_SYMBOLS_MAX 53
+
+/* Reads a FSE table description.
+   numSymbols: in - maximum number of symbols, out - number of symbols */
+static SRes Fse_ReadCounts(Int16 *counts, unsigned *numSymbols, unsigned *tableLog, unsigned maxLog,
+    const Byte *src, size_t srcSize, size_t *readSize)
+{
+  size_t bitPos = 4;
+  unsigned symbol = 0;
+  unsigned log;
+  Int32 remaining;
+  UInt32 threshold;
+  unsigned numBits;
+
+  if (srcSize == 0)
+    return SZ_ERROR_DATA;
+  log = (src[0] & 15) + 5;
+  if (log > maxLog)
+    return SZ_ERROR_DATA;
+  remaining = ((Int32)1 << log) + 1;
+  threshold = (UInt32)1 << log;
+  numBits = log + 1;
+
+  while (remaining > 1)
+  {
+    UInt32 max = 2 * threshold - 1 - (UInt32)remaining;
+    UInt32 v = GetBitsFwd(src, srcSize, bitPos, numBits);
+    Int32 count;
+    if (symbol >= *numSymbols)
+      return SZ_ERROR_DATA;
+    if ((v & (threshold - 1)) < max)
+    {
+      count = (Int32)(v & (threshold - 1));
+      bitPos += numBits - 1;
+    }
+    else
+    {
+      count = (Int32)v;
+      if (v >= threshold)
+        count -= (Int32)max;
+      bitPos += numBits;
+    }
+    count--;
+    remaining -= count < 0 ? -count : count;
+    counts[symbol++] = (Int16)count;
+    if (count == 0)
+    {
+      for (;;)
+      {
+        unsigned repeat = GetBitsFwd(src, srcSize, bitPos, 2);
+        unsigned i;
+        bitPos += 2;
+        for (i = 0; i < repeat; i++)
+        {
+          if (symbol >= *numSymbols)
+            return SZ_ERROR_DATA;
+          counts[symbol++] = 0;
+        }
+        if (repeat != 3)
+          break;
+      }
+    }
+    if (remaining < 1)
+      return SZ_ERROR_DATA;
+    while ((UInt32)remaining < threshold)
+    {
+      numBits--;
+      threshold >>= 1;
+    }
+  }
+
+  *readSize = (bitPos + 7) >> 3;
+  if (*readSize > srcSize)
+    return SZ_ERROR_DATA;
+  *numSymbols = symbol;
+  *tableLog = log;
+  return SZ_OK;
+}
+
+static SRes Fse_BuildTable(CZstdFseEntry *table, const Int16 *counts, unsigned numSymbols, unsigned tableLog)
+{
+  UInt16 symbolNext[FSE_SYMBOLS_MAX];
+  UInt32 tableSize = (UInt32)1 << tableLog;
+  UInt32 mask = tableSize - 1;
+  UInt32 step = (tableSize >> 1) + (tableSize >> 3) + 3;
+  UInt32 highThreshold = tableSize - 1;
+  UInt32 pos = 0;
+  unsigned s;
+
+  for (s = 0; s < numSymbols; s++)
+  {
+    if (counts[s] == -1)
+    {
+      table[highThreshold--].Symbol = (Byte)s;
+      symbolNext[s] = 1;
+    }
+    else
+      symbolNext[s] = (UInt16)counts[s];
+  }
+
+  for (s = 0; s < numSymbols; s++)
+  {
+    Int32 i;
+    for (i = 0; i < counts[s]; i++)
+    {
+      table[pos].Symbol = (Byte)s;
+      do
+        pos = (pos + step) & mask;
+      while (pos > highThreshold);
+    }
+  }
+  if (pos != 0)
+    return SZ_ERROR_DATA;
+
+  for (pos = 0; pos < tableSize; pos++)
+  {
+    UInt32 next = symbolNext[table[pos].Symbol]++;
+    unsigned numBits = tableLog - HighBit32(next);
+    table[pos].NumBits = (Byte)numBits;
+    table[pos].NewState = (UInt16)((next << numBits) - tableSize);
+  }
+  return SZ_OK;
+}
+
+#define Fse_Symbol(table, state) ((table)[state].Symbol)
+#define Fse_Update(table, state, br) \
+  state = (table)[state].NewState + BitRev_Read(br, (table)[state].NumBits)
+
+
+/* ---------- Huffman ---------- */
+
+#define HUF_WEIGHTS_MAX 255
+
+static SRes Huf_ReadWeights(Byte *weights, unsigned *numWeights, const Byte *src, size_t srcSize, size_t *readSize)
+{
+  unsigned header;
+  unsigned n = 0;
+
+  if (srcSize == 0)
+    return SZ_ERROR_DATA;
+  header = src[0];
+
+  if (header >= 128)
+  {
+    /* direct representation: 4 bits per weight */
+    unsigned i;
+    n = header - 127;
+    if (1 + (size_t)((n + 1) >> 1) > srcSize)
+      return SZ_ERROR_DATA;
+    for (i = 0; i < n; i++)
+    {
+      Byte b = src[1 + (i >> 1)];
+      weights[i] = (Byte)((i & 1) ? (b & 15) : (b >> 4));
+    }
+    *readSize = 1 + ((n + 1) >> 1);
+  }
+  else
+  {
+    /* FSE compressed weights, two interleaved states */
+    CZstdFseEntry table[1 << 6];
+    Int16 counts[16];
+    unsigned numSymbols = 12;
+    unsigned tableLog;
+    size_t countsSize;
+    CBitRev br;
+    UInt32 state1, state2;
+    size_t compSize = header;
+
+    if (compSize == 0 || compSize + 1 > srcSize)
+      return SZ_ERROR_DATA;
+    RINOK(Fse_ReadCounts(counts, &numSymbols, &tableLog, 6, src + 1, compSize, &countsSize));
+    RINOK(Fse_BuildTable(table, counts, numSymbols, tableLog));
+    RINOK(BitRev_Init(&br, src + 1 + countsSize, compSize - countsSize));
+    state1 = BitRev_Read(&br, tableLog);
+    state2 = BitRev_Read(&br, tableLog);
+    BitRev_Reload(&br);
+
+    for (;;)
+    {
+      if (n + 2 > HUF_WEIGHTS_MAX)
+        return SZ_ERROR_DATA;
+      weights[n++] = Fse_Symbol(table, state1);
+      Fse_Update(table, state1, &br);
+      if (BitRev_Reload(&br) == BITREV_OVERFLOW)
+      {
+        weights[n++] = Fse_Symbol(table, state2);
+        break;
+      }
+      weights[n++] = Fse_Symbol(table, state2);
+      Fse_Update(table, state2, &br);
+      if (BitRev_Reload(&br) == BITREV_OVERFLOW)
+      {
+        if (n + 1 > HUF_WEIGHTS_MAX)
+          return SZ_ERROR_DATA;
+        weights[n++] = Fse_Symbol(table, state1);
+        break;
+      }
+    }
+    *readSize = 1 + compSize;
+  }
+
+  *numWeights = n;
+  return SZ_OK;
+}
+
+static SRes Huf_ReadTable(CZstdDec *p, const Byte *src, size_t srcSize, size_t *readSize)
+{
+  Byte weights[HUF_WEIGHTS_MAX + 1];
+  UInt32 rankStart[ZSTD_HUF_LOG_MAX + 2];
+  unsigned numWeights, i;
+  unsigned tableLog;
+  UInt32 total = 0, rest;
+
+  RINOK(Huf_ReadWeights(weights, &numWeights, src, srcSize, readSize));
+
+  for (i = 0; i < numWeights; i++)
+  {
+    if (weights[i] > ZSTD_HUF_LOG_MAX)
+      return SZ_ERROR_DATA;
+    if (weights[i] != 0)
+      total += (UInt32)1 << (weights[i] - 1);
+  }
+  if (total == 0)
+    return SZ_ERROR_DATA;
+  tableLog = HighBit32(total) + 1;
+  if (tableLog > ZSTD_HUF_LOG_MAX)
+    return SZ_ERROR_DATA;
+  /* the weight of the last symbol is implied */
+  rest = ((UInt32)1 << tableLog) - total;
+  if ((rest & (rest - 1)) != 0)
+    return SZ_ERROR_DATA;
+  weights[numWeights++] = (Byte)(HighBit32(rest) + 1);
+
+  memset(rankStart, 0, sizeof(rankStart));
+  for (i = 0; i < numWeights; i++)
+    rankStart[weights[i]]++;
+  {
+    UInt32 next = 0;
+    unsigned w;
+    for (w = 1; w <= tableLog; w++)
+    {
+      UInt32 cur = next;
+      next += rankStart[w] << (w - 1);
+      rankStart[w] = cur;
+    }
+  }
+
+  for (i = 0; i < numWeights; i++)
+  {
+    unsigned w = weights[i];
+    UInt32 len, k;
+    UInt16 entry;
+    if (w == 0)
+      continue;
+    len = (UInt32)1 << (w - 1);
+    entry = (UInt16)((i << 8) | (tableLog + 1 - w));
+    for (k = 0; k < len; k++)
+      p->HufTable[rankStart[w] + k] = entry;
+    rankStart[w] += len;
+  }
+
+  p->HufLog = tableLog;
+  p->HufValid = True;
+  return SZ_OK;
+}
+
+#define HUF_DECODE_SYMBOL(dest, table, log, br) \
+  { UInt16 e = table[BitRev_Peek(br, log)]; *(dest)++ = (Byte)(e >> 8); (br)->Consumed += e & 0xFF; }
+
+static SRes Huf_DecodeStream(const CZstdDec *p, const Byte *src, size_t srcSize, Byte *dest, size_t destSize)
+{
+  const UInt16 *table = p->HufTable;
+  unsigned log = p->HufLog;
+  Byte *destEnd = dest + destSize;
+  CBitRev br;
+
+  RINOK(BitRev_Init(&br, src, srcSize));
+  BitRev_Reload(&br);
+
+  /* up to 4 * 11 bits after reload */
+  while (destEnd - dest >= 4 && BitRev_Reload(&br) == BITREV_UNFINISHED)
+  {
+    HUF_DECODE_SYMBOL(dest, table, log, &br);
+    HUF_DECODE_SYMBOL(dest, table, log, &br);
+    HUF_DECODE_SYMBOL(dest, table, log, &br);
+    HUF_DECODE_SYMBOL(dest, table, log, &br);
+  }
+  while (dest != destEnd)
+  {
+    if (BitRev_Reload(&br) == BITREV_OVERFLOW)
+      return SZ_ERROR_DATA;
+    HUF_DECODE_SYMBOL(dest, table, log, &br);
+  }
+  BitRev_Reload(&br);
+  return BitRev_IsCompleted(&br) ? SZ_OK : SZ_ERROR_DATA;
+}
+
+
+/* ---------- Literals ---------- */
+
+static SRes DecodeLiterals(CZstdDec *p, const Byte *src, size_t srcSize,
+    const Byte **literals, size_t *literalsSize, size_t *readSize)
+{
+  unsigned b0, type, sizeFormat;
+  if (srcSize == 0)
+    return SZ_ERROR_DATA;
+  b0 = src[0];
+  type = b0 & 3;
+  sizeFormat = (b0 >> 2) & 3;
+
+  if (type < 2)
+  {
+    /* raw or RLE */
+    size_t headerSize, size;
+    switch (sizeFormat)
+    {
+      case 0: case 2: headerSize = 1; size = b0 >> 3; break;
+      case 1:
+        headerSize = 2;
+        if (srcSize < 2)
+          return SZ_ERROR_DATA;
+        size = (b0 >> 4) + ((size_t)src[1] << 4);
+        break;
+      default:
+        headerSize = 3;
+        if (srcSize < 3)
+          return SZ_ERROR_DATA;
+        size = (b0 >> 4) + ((size_t)src[1] << 4) + ((size_t)src[2] << 12);
+        break;
+    }
+    if (size > ZSTD_BLOCK_SIZE_MAX)
+      return SZ_ERROR_DATA;
+    if (type == 0)
+    {
+      if (headerSize + size > srcSize)
+        return SZ_ERROR_DATA;
+      *literals = src + headerSize;
+      *readSize = headerSize + size;
+    }
+    else
+    {
+      if (headerSize + 1 > srcSize)
+        return SZ_ERROR_DATA;
+      memset(p->Literals, src[headerSize], size);
+      *literals = p->Literals;
+      *readSize = headerSize + 1;
+    }
+    *literalsSize = size;
+    return SZ_OK;
+  }
+
+  {
+    /* Huffman compressed */
+    size_t headerSize, regenSize, compSize, treeSize = 0;
+    unsigned numStreams = (sizeFormat == 0) ? 1 : 4;
+    const Byte *data;
+    size_t dataSize;
+
+    switch (sizeFormat)
+    {
+      case 0: case 1:
+      {
+        UInt32 v;
+        headerSize = 3;
+        if (srcSize < headerSize)
+          return SZ_ERROR_DATA;
+        v = GetUi24(src);
+        regenSize = (v >> 4) & 0x3FF;
+        compSize = (v >> 14) & 0x3FF;
+        break;
+      }
+      case 2:
+      {
+        UInt32 v;
+        headerSize = 4;
+        if (srcSize < headerSize)
+          return SZ_ERROR_DATA;
+        v = GetUi32(src);
+        regenSize = (v >> 4) & 0x3FFF;
+        compSize = v >> 18;
+        break;
+      }
+      default:
+      {
+        UInt32 v;
+        headerSize = 5;
+        if (srcSize < headerSize)
+          return SZ_ERROR_DATA;
+        v = GetUi32(src);
+        regenSize = (v >> 4) & 0x3FFFF;
+        compSize = (v >> 22) + ((size_t)src[4] << 10);
+        break;
+      }
+    }
+    if (regenSize > ZSTD_BLOCK_SIZE_MAX || headerSize + compSize > srcSize)
+      return SZ_ERROR_DATA;
+
+    if (type == 2)
+    {
+      RINOK(Huf_ReadTable(p, src + headerSize, compSize, &treeSize));
+    }
+    else if (!p->HufValid)
+      return SZ_ERROR_DATA;
+
+    data = src + headerSize + treeSize;
+    dataSize = compSize - treeSize;
+
+    if (numStreams == 1)
+    {
+      RINOK(Huf_DecodeStream(p, data, dataSize, p->Literals, regenSize));
+    }
+    else
+    {
+      size_t sizes[4];
+      size_t segment = (regenSize + 3) >> 2;
+      Byte *dest = p->Literals;
+      unsigned i;
+      if (dataSize < 6 || segment * 3 > regenSize)
+        return SZ_ERROR_DATA;
+      sizes[0] = GetUi16(data);
+      sizes[1] = GetUi16(data + 2);
+      sizes[2] = GetUi16(data + 4);
+      data += 6;
+      dataSize -= 6;
+      if (sizes[0] + sizes[1] + sizes[2] > dataSize)
+        return SZ_ERROR_DATA;
+      sizes[3] = dataSize - sizes[0] - sizes[1] - sizes[2];
+      for (i = 0; i < 4; i++)
+      {
+        size_t destSize = (i == 3) ? regenSize - segment * 3 : segment;
+        RINOK(Huf_DecodeStream(p, data, sizes[i], dest, destSize));
+        data += sizes[i];
+        dest += destSize;
+      }
+    }
+
+    *literals = p->Literals;
+    *literalsSize = regenSize;
+    *readSize = headerSize + compSize;
+    return SZ_OK;
+  }
+}
+
+
+/* ---------- Sequences ---------- */
+
+#define LL_SYMBOLS 36
+#define ML_SYMBOLS 53
+#define OF_SYMBOLS 32
+
+static const UInt32 k_LlBase[LL_SYMBOLS] =
+{
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+  16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+  8192, 16384, 32768, 65536
+};
+
+static const Byte k_LlBits[LL_SYMBOLS] =
+{
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+  13, 14, 15, 16
+};
+
+static const UInt32 k_MlBase[ML_SYMBOLS] =
+{
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+  19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+  35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+  4099, 8195, 16387, 32771, 65539
+};
+
+static const Byte k_MlBits[ML_SYMBOLS] =
+{
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+  12, 13, 14, 15, 16
+};
+
+static const Int16 k_LlDefault[LL_SYMBOLS] =
+{
+  4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+  -1, -1, -1, -1
+};
+
+static const Int16 k_MlDefault[ML_SYMBOLS] =
+{
+  1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+  -1, -1, -1, -1, -1
+};
+
+static const Int16 k_OfDefault[29] =
+{
+  1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+#define SEQ_MODE_PREDEFINED 0
+#define SEQ_MODE_RLE 1
+#define SEQ_MODE_FSE 2
+#define SEQ_MODE_REPEAT 3
+
+static SRes BuildSeqTable(CZstdFseEntry *table, unsigned *tableLog, unsigned mode,
+    unsigned maxSymbols, unsigned maxLog,
+    const Int16 *defaultCounts, unsigned defaultNumSymbols, unsigned defaultLog,
+    BoolInt repeatValid,
+    const Byte *src, size_t srcSize, size_t *readSize)
+{
+  *readSize = 0;
+  switch (mode)
+  {
+    case SEQ_MODE_PREDEFINED:
+      *tableLog = defaultLog;
+      return Fse_BuildTable(table, defaultCounts, defaultNumSymbols, defaultLog);
+    case SEQ_MODE_RLE:
+      if (srcSize == 0 || src[0] >= maxSymbols)
+        return SZ_ERROR_DATA;
+      table[0].Symbol = src[0];
+      table[0].NumBits = 0;
+      table[0].NewState = 0;
+      *tableLog = 0;
+      *readSize = 1;
+      return SZ_OK;
+    case SEQ_MODE_FSE:
+    {
+      Int16 counts[FSE_SYMBOLS_MAX];
+      unsigned numSymbols = maxSymbols;
+      RINOK(Fse_ReadCounts(counts, &numSymbols, tableLog, maxLog, src, srcSize, readSize));
+      return Fse_BuildTable(table, counts, numSymbols, *tableLog);
+    }
+    default:
+      return repeatValid ? SZ_OK : SZ_ERROR_DATA;
+  }
+}
+
+static void CopyMatch(Byte *dest, size_t offset, size_t len)
+{
+  const Byte *src = dest - offset;
+  if (offset >= len)
+  {
+    memcpy(dest, src, len);
+    return;
+  }
+  if (offset == 1)
+  {
+    memset(dest, *src, len);
+    return;
+  }
+  /* overlapping: [src, dest) repeats with period (offset), so copy
+     ever larger non-overlapping pieces of it */
+  while (len != 0)
+  {
+    size_t cur = (size_t)(dest - src);
+    if (cur > len)
+      cur = len;
+    memcpy(dest, src, cur);
+    dest += cur;
+    len -= cur;
+  }
+}
+
+static SRes DecodeSequences(CZstdDec *p, const Byte *src, size_t srcSize,
+    const Byte *literals, size_t literalsSize,
+    Byte *dest, size_t destAvail, size_t historySize, size_t *destLen)
+{
+  unsigned numSeqs;
+  size_t pos;
+  Byte *op = dest;
+  Byte *opEnd = dest + (destAvail < ZSTD_BLOCK_SIZE_MAX ? destAvail : ZSTD_BLOCK_SIZE_MAX);
+  const Byte *litEnd = literals + literalsSize;
+  BoolInt outputLimited = (destAvail < ZSTD_BLOCK_SIZE_MAX);
+
+  if (srcSize == 0)
+    return SZ_ERROR_DATA;
+  {
+    unsigned b0 = src[0];
+    if (b0 < 128)
+    {
+      numSeqs = b0;
+      pos = 1;
+    }
+    else if (b0 < 255)
+    {
+      if (srcSize < 2)
+        return SZ_ERROR_DATA;
+      numSeqs = ((b0 - 128) << 8) + src[1];
+      pos = 2;
+    }
+    else
+    {
+      if (srcSize < 3)
+        return SZ_ERROR_DATA;
+      numSeqs = src[1] + ((unsigned)src[2] << 8) + 0x7F00;
+      pos = 3;
+    }
+  }
+
+  if (numSeqs != 0)
+  {
+    unsigned modes;
+    size_t readSize;
+    CBitRev br;
+    UInt32 llState, ofState, mlState;
+    UInt32 *rep = p->Rep;
+
+    if (pos >= srcSize)
+      return SZ_ERROR_DATA;
+    modes = src[pos++];
+    if (modes & 3)
+      return SZ_ERROR_DATA;
+
+    RINOK(BuildSeqTable(p->LlTable, &p->LlLog, modes >> 6, LL_SYMBOLS, ZSTD_LL_LOG_MAX,
+        k_LlDefault, LL_SYMBOLS, 6, p->TablesValid, src + pos, srcSize - pos, &readSize));
+    pos += readSize;
+    RINOK(BuildSeqTable(p->OfTable, &p->OfLog, (modes >> 4) & 3, OF_SYMBOLS, ZSTD_OF_LOG_MAX,
+        k_OfDefault, 29, 5, p->TablesValid, src + pos, srcSize - pos, &readSize));
+    pos += readSize;
+    RINOK(BuildSeqTable(p->MlTable, &p->MlLog, (modes >> 2) & 3, ML_SYMBOLS, ZSTD_ML_LOG_MAX,
+        k_MlDefault, ML_SYMBOLS, 6, p->TablesValid, src + pos, srcSize - pos, &readSize));
+    pos += readSize;
+    p->TablesValid = True;
+
+    RINOK(BitRev_Init(&br, src + pos, srcSize - pos));
+    llState = BitRev_Read(&br, p->LlLog);
+    ofState = BitRev_Read(&br, p->OfLog);
+    mlState = BitRev_Read(&br, p->MlLog);
+    BitRev_Reload(&br);
+
+    for (;;)
+    {
+      const CZstdFseEntry *llEntry = &p->LlTable[llState];
+      const CZstdFseEntry *ofEntry = &p->OfTable[ofState];
+      const CZstdFseEntry *mlEntry = &p->MlTable[mlState];
+      unsigned ofCode = ofEntry->Symbol;
+      unsigned mlCode = mlEntry->Symbol;
+      unsigned llCode = llEntry->Symbol;
+      UInt32 offsetValue, offset;
+      size_t matchLen, litLen;
+
+      offsetValue = ((UInt32)1 << ofCode) + BitRev_Read(&br, ofCode);
+      BitRev_Reload(&br);
+      matchLen = k_MlBase[mlCode] + BitRev_Read(&br, k_MlBits[mlCode]);
+      litLen = k_LlBase[llCode] + BitRev_Read(&br, k_LlBits[llCode]);
+      BitRev_Reload(&br);
+
+      if (offsetValue > 3)
+      {
+        offset = offsetValue - 3;
+        rep[2] = rep[1];
+        rep[1] = rep[0];
+        rep[0] = offset;
+      }
+      else
+      {
+        unsigned index = offsetValue - 1 + (litLen == 0);
+        if (index == 0)
+          offset = rep[0];
+        else
+        {
+          offset = (index == 3) ? rep[0] - 1 : rep[index];
+          if (index != 1)
+            rep[2] = rep[1];
+          rep[1] = rep[0];
+          rep[0] = offset;
+        }
+      }
+
+      if (litLen > (size_t)(litEnd - literals)
+          || litLen + matchLen > (size_t)(opEnd - op))
+        return outputLimited ? SZ_ERROR_OUTPUT_EOF : SZ_ERROR_DATA;
+      memcpy(op, literals, litLen);
+      literals += litLen;
+      op += litLen;
+
+      if (offset == 0 || offset > historySize + (size_t)(op - dest))
+        return SZ_ERROR_DATA;
+      CopyMatch(op, offset, matchLen);
+      op += matchLen;
+
+      if (--numSeqs == 0)
+        break;
+
+      Fse_Update(p->LlTable, llState, &br);
+      Fse_Update(p->MlTable, mlState, &br);
+      Fse_Update(p->OfTable, ofState, &br);
+      BitRev_Reload(&br);
+    }
+
+    if (!BitRev_IsCompleted(&br))
+      return SZ_ERROR_DATA;
+  }
+  else if (pos != srcSize)
+    return SZ_ERROR_DATA;
+
+  {
+    size_t rem = (size_t)(litEnd - literals);
+    if (rem > (size_t)(opEnd - op))
+      return outputLimited ? SZ_ERROR_OUTPUT_EOF : SZ_ERROR_DATA;
+    memcpy(op, literals, rem);
+    op += rem;
+  }
+
+  *destLen = (size_t)(op - dest);
+  return SZ_OK;
+}
+
+
+/* ---------- Blocks ---------- */
+
+void ZstdDec_InitFrame(CZstdDec *p)
+{
+  p->TablesValid = False;
+  p->HufValid = False;
+  p->Rep[0] = 1;
+  p->Rep[1] = 4;
+  p->Rep[2] = 8;
+}
+
+UInt32 ZstdBlockHeader_GetContentSize(UInt32 blockHeader)
+{
+  return ((blockHeader >> 1) & 3) == 1 ? 1 : (blockHeader >> 3);
+}
+
+SRes ZstdDec_DecodeBlock(CZstdDec *p, UInt32 blockHeader,
+    const Byte *src, size_t srcSize,
+    Byte *dest, size_t destAvail, size_t historySize, size_t *destLen)
+{
+  UInt32 size = blockHeader >> 3;
+  *destLen = 0;
+  if (size > ZSTD_BLOCK_SIZE_MAX || srcSize != ZstdBlockHeader_GetContentSize(blockHeader))
+    return SZ_ERROR_DATA;
+
+  switch ((blockHeader >> 1) & 3)
+  {
+    case 0:
+      if (size > destAvail)
+        return SZ_ERROR_OUTPUT_EOF;
+      memcpy(dest, src, size);
+      *destLen = size;
+      return SZ_OK;
+    case 1:
+      if (size > destAvail)
+        return SZ_ERROR_OUTPUT_EOF;
+      memset(dest, src[0], size);
+      *destLen = size;
+      return SZ_OK;
+    case 2:
+    {
+      const Byte *literals;
+      size_t literalsSize, readSize;
+      RINOK(DecodeLiterals(p, src, srcSize, &literals, &literalsSize, &readSize));
+      return DecodeSequences(p, src + readSize, srcSize - readSize, literals, literalsSize,
+          dest, destAvail, historySize, destLen);
+    }
+  }
+  return SZ_ERROR_DATA;
+}
@@ -0,0 +1,125 @@
+/* ZstdDec.h -- Zstandard Decoder
+SevenInstall : Public domain */
+
+#ifndef __ZSTD_DEC_H
+#define __ZSTD_DEC_H
+
+#include "7zTypes.h"
+
+EXTERN_C_BEGIN
+
+#define ZSTD_FRAME_MAGIC 0xFD2FB528
+#define ZSTD_SKIPPABLE_MAGIC_MIN 0x184D2A50
+#define ZSTD_SKIPPABLE_MAGIC_MAX 0x184D2A5F
+
+#define ZSTD_BLOCK_SIZE_MAX (1 << 17)
+#define ZSTD_BLOCK_HEADER_SIZE 3
+#define ZSTD_CHECKSUM_SIZE 4
+
+/* Magic number and frame header descriptor */
+#define ZSTD_FRAME_HEADER_SIZE_MIN 5
+#define ZSTD_FRAME_HEADER_SIZE_MAX 18
+
+#define ZSTD_CONTENT_SIZE_UNKNOWN ((UInt64)(Int64)-1)
+
+
+/* ---------- XXH64 (content checksum) ---------- */
+
+typedef struct
+{
+  UInt64 v[4];
+  UInt64 totalSize;
+  Byte buf[32];
+  unsigned bufSize;
+} CXxh64;
+
+void Xxh64_Init(CXxh64 *p);
+void Xxh64_Update(CXxh64 *p, const void *data, size_t size);
+UInt64 Xxh64_Digest(const CXxh64 *p);
+
+
+/* ---------- Frame header ---------- */
+
+typedef struct
+{
+  UInt64 ContentSize;     /* ZSTD_CONTENT_SIZE_UNKNOWN, if not stored */
+  UInt64 WindowSize;
+  UInt32 DictID;
+  BoolInt ChecksumFlag;
+} CZstdFrameHeader;
+
+/* ZstdFrameHeader_GetSize
+     returns the size of the frame header (including magic number),
+     derived from the first ZSTD_FRAME_HEADER_SIZE_MIN bytes.
+     The magic number must be ZSTD_FRAME_MAGIC. */
+unsigned ZstdFrameHeader_GetSize(const Byte *src);
+
+/* ZstdFrameHeader_Parse
+     src must contain the full header (ZstdFrameHeader_GetSize bytes).
+   Returns:
+     SZ_OK
+     SZ_ERROR_DATA - reserved bits are set
+     SZ_ERROR_UNSUPPORTED - dictionary is required */
+SRes ZstdFrameHeader_Parse(CZstdFrameHeader *p, const Byte *src);
+
+
+/* ---------- Block decoder ---------- */
+
+typedef struct
+{
+  Byte Symbol;
+  Byte NumBits;
+  UInt16 NewState;
+} CZstdFseEntry;
+
+#define ZSTD_LL_LOG_MAX 9
+#define ZSTD_ML_LOG_MAX 9
+#define ZSTD_OF_LOG_MAX 8
+#define ZSTD_HUF_LOG_MAX 11
+
+typedef struct
+{
+  CZstdFseEntry LlTable[1 << ZSTD_LL_LOG_MAX];
+  CZstdFseEntry MlTable[1 << ZSTD_ML_LOG_MAX];
+  CZstdFseEntry OfTable[1 << ZSTD_OF_LOG_MAX];
+  unsigned LlLog;
+  unsigned MlLog;
+  unsigned OfLog;
+  BoolInt TablesValid;
+
+  UInt16 HufTable[1 << ZSTD_HUF_LOG_MAX];   /* (symbol << 8) | numBits */
+  unsigned HufLog;
+  BoolInt HufValid;
+
+  UInt32 Rep[3];
+
+  Byte Literals[ZSTD_BLOCK_SIZE_MAX];
+} CZstdDec;
+
+/* ZstdDec_InitFrame - must be called at the start of each frame */
+void ZstdDec_InitFrame(CZstdDec *p);
+
+/* ZstdDec_DecodeBlock
+     blockHeader - the 3-byte block header (little endian)
+     src, srcSize - block content; (srcSize) must match the header
+                    (1 byte for RLE blocks)
+     dest - write position; the (historySize) bytes before dest are
+            previous output of the frame that matches may refer to
+     destAvail - space available at dest
+     *destLen - receives the number of bytes written
+   Returns:
+     SZ_OK
+     SZ_ERROR_DATA - data error
+     SZ_ERROR_OUTPUT_EOF - not enough space at dest */
+SRes ZstdDec_DecodeBlock(CZstdDec *p, UInt32 blockHeader,
+    const Byte *src, size_t srcSize,
+    Byte *dest, size_t destAvail, size_t historySize, size_t *destLen);
+
+/* Size of block content stored in the archive for a given block header */
+UInt32 ZstdBlockHeader_GetContentSize(UInt32 blockHeader);
+
+#define ZstdBlockHeader_IsLast(h) (((h) & 1) != 0)
+
+EXTERN_C_END
+
+#endif
@@ -2,9 +2,13 @@
 
 #include "StdAfx.h"
 
+#include "../../../Common/Defs.h"
+#include "../../../Common/IoPolicy.h"
+
 #include "../../Common/LimitedStreams.h"
 #include "../../Common/ProgressUtils.h"
 #include "../../Common/StreamObjects.h"
+#include "../../Common/StreamUtils.h"
 
 #include "7zDecode.h"
 
@@ -216,6 +220,135 @@ STDMETHODIMP CLockedSequentialInStreamST::Read(void *data, UInt32 size, UInt32 *
 #endif
 
 
+#ifdef _WIN32
+
+/* SevenInstall: Fast path for folders that are only stored (Copy method):
+   data is written directly from a mapping of the archive file, so it
+   doesn't have to be read into (and copied out of) a coder buffer.
+   The next window is prefetched while the current one is written. */
+
+static const UInt32 kCopyMapWindowSize = 1 << 24;
+
+struct CPrefetchRange
+{
+  void *VirtualAddress;
+  SIZE_T NumberOfBytes;
+};
+
+typedef BOOL (WINAPI *Func_PrefetchVirtualMemory)(HANDLE process, ULONG_PTR numEntries, CPrefetchRange *ranges, ULONG flags);
+
+static void PrefetchView(const Byte *view, UInt32 size)
+{
+  // Windows 8 or later
+  static Func_PrefetchVirtualMemory prefetchFunc = (Func_PrefetchVirtualMemory)(void *)
+      ::GetProcAddress(::GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory");
+  if (!prefetchFunc || !view)
+    return;
+  CPrefetchRange range;
+  range.VirtualAddress = (void *)view;
+  range.NumberOfBytes = size;
+  prefetchFunc(::GetCurrentProcess(), 1, &range, 0);
+}
+
+static const Byte *MapView(HANDLE mapping, UInt64 offset, UInt32 size)
+{
+  return (const Byte *)::MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset, size);
+}
+
+// Reading from the mapping raises an exception on I/O errors
+static HRESULT WriteMappedData(ISequentialOutStream *outStream, const Byte *data, UInt32 size)
+{
+  __try
+  {
+    return WriteStream(outStream, data, size);
+  }
+  __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+  {
+    return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+  }
+}
+
+static HRESULT CopyFolder_Mapped(HANDLE file, UInt64 pos, UInt64 size,
+    ISequentialOutStream *outStream, ICompressProgressInfo *progress)
+{
+  if (size == 0)
+    return S_OK;
+  HANDLE mapping = ::CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping)
+    return HRESULT_FROM_WIN32(::GetLastError());
+
+  SYSTEM_INFO systemInfo;
+  ::GetSystemInfo(&systemInfo);
+  const UInt64 end = pos + size;
+  const UInt32 chunkSize = g_IoPolicy.CoderBufSize;
+
+  // Views must start at a multiple of the allocation granularity
+  UInt64 viewStart = pos - pos % systemInfo.dwAllocationGranularity;
+  UInt32 viewSize = (UInt32)MyMin((UInt64)kCopyMapWindowSize, end - viewStart);
+  const Byte *view = MapView(mapping, viewStart, viewSize);
+  PrefetchView(view, viewSize);
+
+  HRESULT res = S_OK;
+  UInt64 processed = 0;
+  for (;;)
+  {
+    if (!view)
+    {
+      res = HRESULT_FROM_WIN32(::GetLastError());
+      break;
+    }
+
+    const UInt64 nextStart = viewStart + viewSize;
+    UInt32 nextSize = 0;
+    const Byte *nextView = NULL;
+    if (nextStart < end)
+    {
+      nextSize = (UInt32)MyMin((UInt64)kCopyMapWindowSize, end - nextStart);
+      nextView = MapView(mapping, nextStart, nextSize);
+      PrefetchView(nextView, nextSize);
+    }
+
+    for (UInt64 p = MyMax(pos, viewStart); p < nextStart;)
+    {
+      UInt32 cur = (UInt32)MyMin((UInt64)chunkSize, nextStart - p);
+      res = WriteMappedData(outStream, view + (size_t)(p - viewStart), cur);
+      if (res != S_OK)
+        break;
+      p += cur;
+      processed += cur;
+      if (progress)
+      {
+        res = progress->SetRatioInfo(&processed, &processed);
+        if (res != S_OK)
+          break;
+      }
+    }
+
+    ::UnmapViewOfFile(view);
+    if (res != S_OK || nextStart >= end)
+    {
+      if (nextView)
+        ::UnmapViewOfFile(nextView);
+      break;
+    }
+    view = nextView;
+    viewStart = nextStart;
+    viewSize = nextSize;
+  }
+
+  ::CloseHandle(mapping);
+  return res;
+}
+
+static bool IsCopyFolder(const CFolderEx &folderInfo)
+{
+  return folderInfo.Coders.Size() == 1
+      && folderInfo.Coders[0].MethodID == k_Copy
+      && folderInfo.Coders[0].NumStreams == 1
+      && folderInfo.PackStreams.Size() == 1;
+}
+
+#endif
 
 HRESULT CDecoder::Decode(
     DECL_EXTERNAL_CODECS_LOC_VARS
@@ -264,6 +397,26 @@ HRESULT CDecoder::Decode(
     fullUnpack = (*unpackSize == folderUnpackSize);
   }
 
+  #ifdef _WIN32
+  if (outStream && g_IoPolicy.MapStoredData && IsCopyFolder(folderInfo)
+      && packPositions[1] - packPositions[0] == folderUnpackSize)
+  {
+    CMyComPtr<IStreamGetFileHandle> getFileHandle;
+    inStream->QueryInterface(IID_IStreamGetFileHandle, (void **)&getFileHandle);
+    HANDLE file;
+    LARGE_INTEGER fileSize;
+    const UInt64 packPos = startPos + packPositions[0];
+    // Truncated archives take the regular path, which reports the error properly
+    if (getFileHandle && getFileHandle->GetFileHandle(&file) == S_OK
+        && ::GetFileSizeEx(file, &fileSize)
+        && packPos + folderUnpackSize <= (UInt64)fileSize.QuadPart)
+    {
+      return CopyFolder_Mapped(file, packPos, unpackSize ? *unpackSize : folderUnpackSize,
+          outStream, compressProgress);
+    }
+  }
+  #endif
+
   /*
   We don't need to init isEncrypted and passwordIsDefined
   We must upgrade them only
@@ -601,10 +601,8 @@ STDMETHODIMP CHandler::GetProperty(UInt32 index, PROPID propID, PROPVARIANT *val
     */
 
     case kpidPath: return _db.GetPath_Prop(index, value);
-    
-    #ifndef _SFX
-    
-    case kpidMethod: return SetMethodToProp(_db.FileIndexToFolderIndexMap[index2], value);
+
+    // Also needed in SFX builds: used for per-folder extraction statistics
     case kpidBlock:
       {
         CNum folderIndex = _db.FileIndexToFolderIndexMap[index2];
@@ -612,6 +610,10 @@ STDMETHODIMP CHandler::GetProperty(UInt32 index, PROPID propID, PROPVARIANT *val
           PropVarEm_Set_UInt32(value, (UInt32)folderIndex);
       }
       break;
+    
+    #ifndef _SFX
+    
+    case kpidMethod: return SetMethodToProp(_db.FileIndexToFolderIndexMap[index2], value);
     /*
     case kpidPackedSize0:
     case kpidPackedSize1:
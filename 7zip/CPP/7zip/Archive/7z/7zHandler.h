@@ -11,7 +11,8 @@
 #ifndef __7Z_SET_PROPERTIES
 
 #ifdef EXTRACT_ONLY
-  #if !defined(_7ZIP_ST) && !defined(_SFX)
+  // SevenInstall: also used in SFX builds, to allow limiting threads and memory
+  #if !defined(_7ZIP_ST)
     #define __7Z_SET_PROPERTIES
   #endif
 #else
@@ -43,6 +44,7 @@ public:
   bool _numSolidBytesDefined;
   bool _solidExtension;
   bool _useTypeSorting;
+  bool _keepClientOrder; // SevenInstall
 
   bool _compressHeaders;
   bool _encryptHeadersSpecified;
@@ -634,6 +634,7 @@ STDMETHODIMP CHandler::UpdateItems(ISequentialOutStream *outStream, UInt32 numIt
   options.NumSolidBytes = _numSolidBytes;
   options.SolidExtension = _solidExtension;
   options.UseTypeSorting = _useTypeSorting;
+  options.KeepClientOrder = _keepClientOrder;
 
   options.RemoveSfxBlock = _removeSfxBlock;
   // options.VolumeMode = _volumeMode;
@@ -725,6 +726,7 @@ void COutHandler::InitProps7z()
 
   InitSolid();
   _useTypeSorting = false;
+  _keepClientOrder = false;
 }
 
 void COutHandler::InitProps()
@@ -860,6 +862,8 @@ HRESULT COutHandler::SetProperty(const wchar_t *nameSpec, const PROPVARIANT &val
     if (name.IsEqualTo("mtf")) return PROPVARIANT_to_bool(value, _useMultiThreadMixer);
 
     if (name.IsEqualTo("qs")) return PROPVARIANT_to_bool(value, _useTypeSorting);
+    // SevenInstall: "qo" keeps the item order given by the caller
+    if (name.IsEqualTo("qo")) return PROPVARIANT_to_bool(value, _keepClientOrder);
 
     // if (name.IsEqualTo("v"))  return PROPVARIANT_to_bool(value, _volumeMode);
   }
@@ -118,6 +118,7 @@ const UInt32 k_IA64  = 0x3030401;
 const UInt32 k_ARM   = 0x3030501;
 const UInt32 k_ARMT  = 0x3030701;
 const UInt32 k_SPARC = 0x3030805;
+const UInt32 k_ARM64 = 0xa; // SevenInstall
 
 const UInt32 k_AES   = 0x6F10701;
 
@@ -136,6 +137,7 @@ static inline bool IsFilterMethod(UInt64 m)
     case k_ARM:
     case k_ARMT:
     case k_SPARC:
+    case k_ARM64:
     case k_SWAP2:
     case k_SWAP4:
       return true;
@@ -38,7 +38,7 @@ struct CFilterMode
   {
     if (Id == k_IA64)
       Delta = 16;
-    else if (Id == k_ARM || Id == k_PPC || Id == k_SPARC)
+    else if (Id == k_ARM || Id == k_PPC || Id == k_SPARC || Id == k_ARM64)
       Delta = 4;
     else if (Id == k_ARMT)
       Delta = 2;
@@ -91,6 +91,7 @@ static int Parse_EXE(const Byte *buf, size_t size, CFilterMode *filterMode)
     case 0x01C4:  filterId = k_ARMT; break; // WinRT
 
     case 0x0200:  filterId = k_IA64; break;
+    case 0xAA64:  filterId = k_ARM64; break; // SevenInstall
     default:  return 0;
   }
 
@@ -164,6 +165,7 @@ static int Parse_ELF(const Byte *buf, size_t size, CFilterMode *filterMode)
     case 20:
     case 21: if (!be) return 0; filterId = k_PPC; break;
     case 40: if ( be) return 0; filterId = k_ARM; break;
+    case 183: if ( be) return 0; filterId = k_ARM64; break; // SevenInstall
     
     /* Some IA-64 ELF exacutable have size that is not aligned for 16 bytes.
        So we don't use IA-64 filter for IA-64 ELF */
@@ -192,6 +194,7 @@ static int Parse_ELF(const Byte *buf, size_t size, CFilterMode *filterMode)
 #define MACH_MACHINE_PPC 18
 #define MACH_MACHINE_PPC64 (MACH_ARCH_ABI64 | MACH_MACHINE_PPC)
 #define MACH_MACHINE_AMD64 (MACH_ARCH_ABI64 | MACH_MACHINE_386)
+#define MACH_MACHINE_ARM64 (MACH_ARCH_ABI64 | MACH_MACHINE_ARM)
 
 static unsigned Parse_MACH(const Byte *buf, size_t size, CFilterMode *filterMode)
 {
@@ -215,6 +218,7 @@ static unsigned Parse_MACH(const Byte *buf, size_t size, CFilterMode *filterMode
     case MACH_MACHINE_386:
     case MACH_MACHINE_AMD64: filterId = k_X86; break;
     case MACH_MACHINE_ARM:   if ( be) return 0; filterId = k_ARM; break;
+    case MACH_MACHINE_ARM64: if ( be) return 0; filterId = k_ARM64; break; // SevenInstall
     case MACH_MACHINE_SPARC: if (!be) return 0; filterId = k_SPARC; break;
     case MACH_MACHINE_PPC:
     case MACH_MACHINE_PPC64: if (!be) return 0; filterId = k_PPC; break;
@@ -375,6 +379,7 @@ static inline bool IsExeFilter(CMethodId m)
     case k_PPC:
     case k_SPARC:
     case k_IA64:
+    case k_ARM64:
       return true;
   }
   return false;
@@ -674,6 +679,7 @@ struct CSortParam
 {
   // const CObjectVector<CTreeFolder> *TreeFolders;
   bool SortByType;
+  bool KeepClientOrder; // SevenInstall
 };
 
 /*
@@ -711,6 +717,8 @@ static int CompareUpdateItems(const CRefItem *p1, const CRefItem *p2, void *para
   
   // bool sortByType = *(bool *)param;
   const CSortParam *sortParam = (const CSortParam *)param;
+  if (sortParam->KeepClientOrder)
+    return MyCompare(u1.IndexInClient, u2.IndexInClient);
   bool sortByType = sortParam->SortByType;
   if (sortByType)
   {
@@ -2309,6 +2317,7 @@ HRESULT Update(
     CSortParam sortParam;
     // sortParam.TreeFolders = &treeFolders;
     sortParam.SortByType = sortByType;
+    sortParam.KeepClientOrder = options.KeepClientOrder;
     refItems.Sort(CompareUpdateItems, (void *)&sortParam);
     
     CObjArray<UInt32> indices(numFiles);
@@ -99,6 +99,8 @@ struct CUpdateOptions
   bool SolidExtension;
   
   bool UseTypeSorting;
+  // SevenInstall: keep the order of the update callback (e.g. grouped by directory)
+  bool KeepClientOrder;
   
   bool RemoveSfxBlock;
   bool MultiThreadMixer;
@@ -113,6 +115,7 @@ struct CUpdateOptions
       NumSolidBytes((UInt64)(Int64)(-1)),
       SolidExtension(false),
       UseTypeSorting(true),
+      KeepClientOrder(false),
       RemoveSfxBlock(false),
       MultiThreadMixer(true)
     {}
@@ -14,9 +14,8 @@
   #define USE_MIXER_ST
 #else
   #define USE_MIXER_MT
-  #ifndef _SFX
-    #define USE_MIXER_ST
-  #endif
+  // SevenInstall: single-threaded mixer is also needed in SFX builds (for thread limits)
+  #define USE_MIXER_ST
 #endif
 
 #ifdef USE_MIXER_MT
@@ -15,6 +15,14 @@
 
 #include "FileStreams.h"
 
+#ifdef USE_WIN_FILE
+#include "../../../C/CpuArch.h"
+#ifdef MY_CPU_X86_OR_AMD64
+#include <emmintrin.h>
+#endif
+#include <winioctl.h>
+#endif
+
 static inline HRESULT ConvertBoolToHRESULT(bool result)
 {
   #ifdef _WIN32
@@ -309,6 +317,17 @@ STDMETHODIMP CInFileStream::GetProps(UInt64 *size, FILETIME *cTime, FILETIME *aT
   return GetLastError();
 }
 
+STDMETHODIMP CInFileStream::GetFileHandle(HANDLE *handle)
+{
+  #ifdef SUPPORT_DEVICE_FILE
+  // Reads from devices go through our own buffer
+  if (File.IsDeviceFile)
+    return E_NOTIMPL;
+  #endif
+  *handle = File.GetHandle();
+  return S_OK;
+}
+
 STDMETHODIMP CInFileStream::GetProps2(CStreamFileProps *props)
 {
   BY_HANDLE_FILE_INFORMATION info;
@@ -335,20 +354,129 @@ STDMETHODIMP CInFileStream::GetProps2(CStreamFileProps *props)
 
 HRESULT COutFileStream::Close()
 {
+  #ifdef USE_WIN_FILE
+  RINOK(FinishMapping());
+  RINOK(FinishSparse());
+  #endif
   return ConvertBoolToHRESULT(File.Close());
 }
 
+#ifdef USE_WIN_FILE
+
+/* SevenInstall: sparse output.
+   Holes are made of whole blocks (relative to the file start) of this size,
+   which is the NTFS sparse allocation unit for common cluster sizes. */
+static const UInt32 kSparseBlockSize = 1 << 16;
+
+// size must be a multiple of 64
+static bool IsZeroBlock(const Byte *p, UInt32 size)
+{
+  #ifdef MY_CPU_X86_OR_AMD64
+  const __m128i *v = (const __m128i *)p;
+  const __m128i zero = _mm_setzero_si128();
+  for (; size != 0; size -= 64, v += 4)
+  {
+    __m128i x = _mm_or_si128(
+        _mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)),
+        _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)) != 0xFFFF)
+      return false;
+  }
+  return true;
+  #else
+  for (; size != 0; size -= 8, p += 8)
+    if (GetUi32(p) != 0 || GetUi32(p + 4) != 0)
+      return false;
+  return true;
+  #endif
+}
+
+HRESULT COutFileStream::FlushHole()
+{
+  if (_pendingHole == 0)
+    return S_OK;
+  UInt64 holeEnd;
+  if (!File.Seek((Int64)_pendingHole, FILE_CURRENT, holeEnd))
+    return ConvertBoolToHRESULT(false);
+  /* Preallocated space would still be allocated; zeroing deallocates it.
+     Holes read as zeros anyway, so errors don't matter. */
+  FILE_ZERO_DATA_INFORMATION zeroInfo;
+  zeroInfo.FileOffset.QuadPart = (LONGLONG)(holeEnd - _pendingHole);
+  zeroInfo.BeyondFinalZero.QuadPart = (LONGLONG)holeEnd;
+  DWORD bytesReturned;
+  File.DeviceIoControl(FSCTL_SET_ZERO_DATA, &zeroInfo, sizeof(zeroInfo), NULL, 0, &bytesReturned);
+  _pendingHole = 0;
+  return S_OK;
+}
+
+HRESULT COutFileStream::FinishSparse()
+{
+  if (_sparseState <= 0)
+    return S_OK;
+  bool holeAtEnd = (_pendingHole != 0);
+  RINOK(FlushHole());
+  if (holeAtEnd && !File.SetEndOfFile())
+    return ConvertBoolToHRESULT(false);
+  FILE_STANDARD_INFO info;
+  if (GetFileInformationByHandleEx(File.GetHandle(), FileStandardInfo, &info, sizeof(info))
+      && info.EndOfFile.QuadPart > info.AllocationSize.QuadPart)
+    SparseSaved = (UInt64)(info.EndOfFile.QuadPart - info.AllocationSize.QuadPart);
+  _sparseState = -1;
+  return S_OK;
+}
+
+HRESULT COutFileStream::WriteSparse(const void *data, UInt32 size, UInt32 *processedSize)
+{
+  const Byte *p = (const Byte *)data;
+  // Bytes up to the next block boundary of the file
+  UInt32 len = (UInt32)(0 - ProcessedSize) & (kSparseBlockSize - 1);
+
+  if (len == 0)
+  {
+    UInt32 zeros = 0;
+    while (size - zeros >= kSparseBlockSize && IsZeroBlock(p + zeros, kSparseBlockSize))
+      zeros += kSparseBlockSize;
+    if (zeros != 0)
+    {
+      if (_sparseState == 0)
+      {
+        DWORD bytesReturned;
+        _sparseState = File.DeviceIoControl(FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &bytesReturned) ? 1 : -1;
+        if (_sparseState < 0)
+          return WriteData(data, size, processedSize);
+      }
+      _pendingHole += zeros;
+      ProcessedSize += zeros;
+      SparseSkipped += zeros;
+      if (processedSize)
+        *processedSize = zeros;
+      return S_OK;
+    }
+    len = kSparseBlockSize;
+  }
+
+  // Write data up to the next zero block
+  if (len > size)
+    len = size;
+  while (len < size && (size - len < kSparseBlockSize || !IsZeroBlock(p + len, kSparseBlockSize)))
+    len += MyMin(kSparseBlockSize, size - len);
+  RINOK(FlushHole());
+  return WriteData(data, len, processedSize);
+}
+
+#endif
+
 STDMETHODIMP COutFileStream::Write(const void *data, UInt32 size, UInt32 *processedSize)
 {
   #ifdef USE_WIN_FILE
 
-  UInt32 realProcessedSize;
-  bool result = File.Write(data, size, realProcessedSize);
-  ProcessedSize += realProcessedSize;
-  if (processedSize)
-    *processedSize = realProcessedSize;
-  return ConvertBoolToHRESULT(result);
-  
+  // SevenInstall
+  if (_mapping)
+    return WriteMapped(data, size, processedSize);
+  if (Sparse && _sparseState >= 0)
+    return WriteSparse(data, size, processedSize);
+  return WriteData(data, size, processedSize);
+
   #else
   
   if (processedSize)
@@ -363,6 +491,142 @@ STDMETHODIMP COutFileStream::Write(const void *data, UInt32 size, UInt32 *proces
   
   #endif
 }
+
+#ifdef USE_WIN_FILE
+
+HRESULT COutFileStream::WriteData(const void *data, UInt32 size, UInt32 *processedSize)
+{
+  UInt32 realProcessedSize;
+  LARGE_INTEGER writeStart, writeEnd;
+  if (MeasureWriteTime)
+    QueryPerformanceCounter(&writeStart);
+  bool result = File.Write(data, size, realProcessedSize);
+  if (MeasureWriteTime)
+  {
+    QueryPerformanceCounter(&writeEnd);
+    WriteTicks += (UInt64)(writeEnd.QuadPart - writeStart.QuadPart);
+  }
+  ProcessedSize += realProcessedSize;
+  if (processedSize)
+    *processedSize = realProcessedSize;
+  return ConvertBoolToHRESULT(result);
+}
+
+
+/* SevenInstall: mapped output.
+   Views are a multiple of the allocation granularity (64 KB), so consecutive
+   views can be placed back to back. */
+static const UInt32 kOutMapViewSize = 1 << 24;
+
+// Writing to the mapping raises an exception on I/O errors
+static HRESULT CopyToView(Byte *dest, const void *data, UInt32 size)
+{
+  __try
+  {
+    memcpy(dest, data, size);
+    return S_OK;
+  }
+  __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+  {
+    return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+  }
+}
+
+bool COutFileStream::MapOutput(UInt64 size)
+{
+  if (_mapping || size == 0)
+    return false;
+  _mapping = ::CreateFileMappingW(File.GetHandle(), NULL, PAGE_READWRITE, 0, 0, NULL);
+  if (!_mapping)
+    return false;
+  _view = NULL;
+  _viewPos = 0;
+  _viewSize = 0;
+  _mapPos = 0;
+  _mapSize = size;
+  return true;
+}
+
+HRESULT COutFileStream::MapNextView()
+{
+  if (_view)
+  {
+    ::UnmapViewOfFile(_view);
+    _view = NULL;
+  }
+  // Views are only changed at a view boundary, which is suitably aligned
+  _viewPos = _mapPos;
+  const UInt64 rem = _mapSize - _viewPos;
+  _viewSize = (rem < kOutMapViewSize) ? (UInt32)rem : kOutMapViewSize;
+  _view = (Byte *)::MapViewOfFile(_mapping, FILE_MAP_WRITE, (DWORD)(_viewPos >> 32), (DWORD)_viewPos, _viewSize);
+  if (!_view)
+    return HRESULT_FROM_WIN32(::GetLastError());
+  return S_OK;
+}
+
+HRESULT COutFileStream::WriteMapped(const void *data, UInt32 size, UInt32 *processedSize)
+{
+  if (processedSize)
+    *processedSize = 0;
+  LARGE_INTEGER writeStart, writeEnd;
+  if (MeasureWriteTime)
+    QueryPerformanceCounter(&writeStart);
+  HRESULT res = S_OK;
+  while (size != 0 && _mapPos < _mapSize)
+  {
+    if (!_view || _mapPos == _viewPos + _viewSize)
+    {
+      res = MapNextView();
+      if (res != S_OK)
+        break;
+    }
+    UInt32 cur = (UInt32)(_viewPos + _viewSize - _mapPos);
+    if (cur > size)
+      cur = size;
+    res = CopyToView(_view + (size_t)(_mapPos - _viewPos), data, cur);
+    if (res != S_OK)
+      break;
+    _mapPos += cur;
+    ProcessedSize += cur;
+    if (processedSize)
+      *processedSize += cur;
+    data = (const Byte *)data + cur;
+    size -= cur;
+  }
+  if (MeasureWriteTime)
+  {
+    QueryPerformanceCounter(&writeEnd);
+    WriteTicks += (UInt64)(writeEnd.QuadPart - writeStart.QuadPart);
+  }
+  if (res != S_OK || size == 0)
+    return res;
+
+  // More data than expected
+  RINOK(FinishMapping());
+  UInt32 processed2 = 0;
+  res = WriteData(data, size, &processed2);
+  if (processedSize)
+    *processedSize += processed2;
+  return res;
+}
+
+HRESULT COutFileStream::FinishMapping()
+{
+  if (!_mapping)
+    return S_OK;
+  if (_view)
+  {
+    ::UnmapViewOfFile(_view);
+    _view = NULL;
+  }
+  ::CloseHandle(_mapping);
+  _mapping = NULL;
+  // Regular writes continue after the mapped data
+  UInt64 newPosition;
+  return ConvertBoolToHRESULT(File.Seek(_mapPos, newPosition));
+}
+
+#endif
   
 STDMETHODIMP COutFileStream::Seek(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition)
 {
@@ -371,6 +635,7 @@ STDMETHODIMP COutFileStream::Seek(Int64 offset, UInt32 seekOrigin, UInt64 *newPo
   
   #ifdef USE_WIN_FILE
 
+  RINOK(FinishMapping()); // SevenInstall
   UInt64 realNewPosition;
   bool result = File.Seek(offset, seekOrigin, realNewPosition);
   if (newPosition)
@@ -393,6 +658,7 @@ STDMETHODIMP COutFileStream::SetSize(UInt64 newSize)
 {
   #ifdef USE_WIN_FILE
   
+  RINOK(FinishMapping()); // SevenInstall
   UInt64 currentPos;
   if (!File.Seek(0, FILE_CURRENT, currentPos))
     return E_FAIL;
@@ -75,11 +75,22 @@ public:
     return File.OpenShared(fileName, shareForWrite);
   }
 
+  // SevenInstall: open for reading mostly from front to back
+  bool OpenSequential(CFSTR fileName)
+  {
+    #ifdef USE_WIN_FILE
+    return File.Open(fileName, FILE_SHARE_READ, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN);
+    #else
+    return File.Open(fileName);
+    #endif
+  }
+
   MY_QUERYINTERFACE_BEGIN2(IInStream)
   MY_QUERYINTERFACE_ENTRY(IStreamGetSize)
   #ifdef USE_WIN_FILE
   MY_QUERYINTERFACE_ENTRY(IStreamGetProps)
   MY_QUERYINTERFACE_ENTRY(IStreamGetProps2)
+  MY_QUERYINTERFACE_ENTRY(IStreamGetFileHandle)
   #endif
   MY_QUERYINTERFACE_END
   MY_ADDREF_RELEASE
@@ -91,6 +102,7 @@ public:
   #ifdef USE_WIN_FILE
   STDMETHOD(GetProps)(UInt64 *size, FILETIME *cTime, FILETIME *aTime, FILETIME *mTime, UInt32 *attrib);
   STDMETHOD(GetProps2)(CStreamFileProps *props);
+  STDMETHOD(GetFileHandle)(HANDLE *handle);
   #endif
 };
 
@@ -115,22 +127,92 @@ public:
   #else
   NC::NFile::NIO::COutFile File;
   #endif
-  virtual ~COutFileStream() {}
+  COutFileStream(): MeasureWriteTime(false), WriteTicks(0), Sparse(false)
+  {
+    ResetSparse();
+    #ifdef USE_WIN_FILE
+    _mapping = NULL;
+    _view = NULL;
+    #endif
+  }
+  virtual ~COutFileStream()
+  {
+    #ifdef USE_WIN_FILE
+    FinishMapping();
+    #endif
+  }
   bool Create(CFSTR fileName, bool createAlways)
   {
     ProcessedSize = 0;
+    WriteTicks = 0;
+    ResetSparse();
     return File.Create(fileName, createAlways);
   }
   bool Open(CFSTR fileName, DWORD creationDisposition)
   {
     ProcessedSize = 0;
+    WriteTicks = 0;
+    ResetSparse();
     return File.Open(fileName, creationDisposition);
   }
+  #ifdef USE_WIN_FILE
+  // SevenInstall: open a file that is to be written with MapOutput()
+  bool OpenForMapping(CFSTR fileName, DWORD creationDisposition)
+  {
+    ProcessedSize = 0;
+    WriteTicks = 0;
+    ResetSparse();
+    return File.OpenReadWrite(fileName, creationDisposition);
+  }
+  #endif
 
   HRESULT Close();
   
   UInt64 ProcessedSize;
 
+  // If set, the time spent in Write() is accumulated in WriteTicks (QueryPerformanceCounter() units)
+  bool MeasureWriteTime;
+  UInt64 WriteTicks;
+
+  /* SevenInstall: If set, block aligned runs of zeros are not written, but
+     left as holes of a sparse file. Files are only made sparse once a hole is
+     found; if that fails, zeros are written as usual. */
+  bool Sparse;
+  // Bytes not written because of holes
+  UInt64 SparseSkipped;
+  // Disk space saved by holes; set by FinishSparse()
+  UInt64 SparseSaved;
+  // Extend the file over a hole at the end. Call before setting file times.
+  HRESULT FinishSparse();
+private:
+  int _sparseState; // 0: no holes yet, 1: file is sparse, -1: can't be sparse
+  UInt64 _pendingHole;
+  void ResetSparse() { SparseSkipped = 0; SparseSaved = 0; _sparseState = 0; _pendingHole = 0; }
+  HRESULT WriteData(const void *data, UInt32 size, UInt32 *processedSize);
+  HRESULT WriteSparse(const void *data, UInt32 size, UInt32 *processedSize);
+  HRESULT FlushHole();
+public:
+
+  #ifdef USE_WIN_FILE
+  /* SevenInstall: Write the data of a file opened with OpenForMapping(), which
+     already has its final length (size), through a mapping of the file. Writes past that
+     length go back to WriteFile(). Returns false if the file can't be mapped;
+     writes go to WriteFile() then. */
+  bool MapOutput(UInt64 size);
+  // Unmap the file. Call before changing the length or the times of the file.
+  HRESULT FinishMapping();
+private:
+  HANDLE _mapping;
+  Byte *_view;
+  UInt64 _viewPos;  // file offset of _view
+  UInt32 _viewSize;
+  UInt64 _mapPos;   // file offset of the next write
+  UInt64 _mapSize;
+  HRESULT MapNextView();
+  HRESULT WriteMapped(const void *data, UInt32 size, UInt32 *processedSize);
+public:
+  #endif
+
   #ifdef USE_WIN_FILE
   bool SetTime(const FILETIME *cTime, const FILETIME *aTime, const FILETIME *mTime)
   {
@@ -3,6 +3,7 @@
 #include "StdAfx.h"
 
 #include "../../Common/Defs.h"
+#include "../../Common/IoPolicy.h"
 
 #include "FilterCoder.h"
 #include "StreamUtils.h"
@@ -36,8 +37,6 @@ void CAlignedMidBuffer::AllocAligned(size_t size)
 */
 
 
-static const UInt32 kBufSize = 1 << 20;
-
 STDMETHODIMP CFilterCoder::SetInBufSize(UInt32 , UInt32 size) { _inBufSize = size; return S_OK; }
 STDMETHODIMP CFilterCoder::SetOutBufSize(UInt32 , UInt32 size) { _outBufSize = size; return S_OK; }
 
@@ -69,8 +68,8 @@ HRESULT CFilterCoder::Init_and_Alloc()
 
 CFilterCoder::CFilterCoder(bool encodeMode):
     _bufSize(0),
-    _inBufSize(kBufSize),
-    _outBufSize(kBufSize),
+    _inBufSize(g_IoPolicy.CoderBufSize), // SevenInstall: buffer size from I/O policy
+    _outBufSize(g_IoPolicy.CoderBufSize),
     _encodeMode(encodeMode),
     _outSizeIsDefined(false),
     _outSize(0),
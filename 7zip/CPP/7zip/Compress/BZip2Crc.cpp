@@ -4,23 +4,26 @@
 
 #include "BZip2Crc.h"
 
-UInt32 CBZip2Crc::Table[256];
-
 static const UInt32 kBZip2CrcPoly = 0x04c11db7;  /* AUTODIN II, Ethernet, & FDDI */
 
-void CBZip2Crc::InitTable()
+// Table is computed at compile time, so no static initializer is needed
+static constexpr UInt32 BZip2CrcEntry(UInt32 i)
 {
-  for (UInt32 i = 0; i < 256; i++)
-  {
-    UInt32 r = (i << 24);
-    for (unsigned j = 0; j < 8; j++)
-      r = (r << 1) ^ (kBZip2CrcPoly & ((UInt32)0 - (r >> 31)));
-    Table[i] = r;
-  }
+  UInt32 r = (i << 24);
+  for (unsigned j = 0; j < 8; j++)
+    r = (r << 1) ^ (kBZip2CrcPoly & ((UInt32)0 - (r >> 31)));
+  return r;
 }
 
-class CBZip2CrcTableInit
+#define BZIP2_CRC_4(i)  BZip2CrcEntry(i), BZip2CrcEntry(i + 1), BZip2CrcEntry(i + 2), BZip2CrcEntry(i + 3)
+#define BZIP2_CRC_16(i) BZIP2_CRC_4(i), BZIP2_CRC_4(i + 4), BZIP2_CRC_4(i + 8), BZIP2_CRC_4(i + 12)
+#define BZIP2_CRC_64(i) BZIP2_CRC_16(i), BZIP2_CRC_16(i + 16), BZIP2_CRC_16(i + 32), BZIP2_CRC_16(i + 48)
+
+const UInt32 CBZip2Crc::Table[256] =
 {
-public:
-  CBZip2CrcTableInit() { CBZip2Crc::InitTable(); }
-} g_BZip2CrcTableInit;
+  BZIP2_CRC_64(0), BZIP2_CRC_64(64), BZIP2_CRC_64(128), BZIP2_CRC_64(192)
+};
+
+#undef BZIP2_CRC_64
+#undef BZIP2_CRC_16
+#undef BZIP2_CRC_4
@@ -8,9 +8,8 @@
 class CBZip2Crc
 {
   UInt32 _value;
-  static UInt32 Table[256];
+  static const UInt32 Table[256];
 public:
-  static void InitTable();
   CBZip2Crc(): _value(0xFFFFFFFF) {};
   void Init() { _value = 0xFFFFFFFF; }
   void UpdateByte(Byte b) { _value = Table[(_value >> 24) ^ b] ^ (_value << 8); }
@@ -20,6 +20,7 @@ CREATE_BRA(IA64)
 CREATE_BRA(ARM)
 CREATE_BRA(ARMT)
 CREATE_BRA(SPARC)
+CREATE_BRA(ARM64) // SevenInstall
 
 #define METHOD_ITEM(n, id, name) \
     REGISTER_FILTER_ITEM( \
@@ -33,7 +34,9 @@ REGISTER_CODECS_VAR
   METHOD_ITEM(IA64,  0x401, "IA64"),
   METHOD_ITEM(ARM,   0x501, "ARM"),
   METHOD_ITEM(ARMT,  0x701, "ARMT"),
-  METHOD_ITEM(SPARC, 0x805, "SPARC")
+  METHOD_ITEM(SPARC, 0x805, "SPARC"),
+  // SevenInstall: same ID as the 7-Zip 23 ARM64 filter
+  REGISTER_FILTER_ITEM(CreateBra_Decoder_ARM64, CreateBra_Encoder_ARM64, 0xa, "ARM64")
 };
 
 REGISTER_CODECS(Branch)
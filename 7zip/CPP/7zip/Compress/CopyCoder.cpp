@@ -4,12 +4,12 @@
 
 #include "../../../C/Alloc.h"
 
+#include "../../Common/IoPolicy.h"
+
 #include "CopyCoder.h"
 
 namespace NCompress {
 
-static const UInt32 kBufSize = 1 << 17;
-
 CCopyCoder::~CCopyCoder()
 {
   ::MidFree(_buf);
@@ -27,7 +27,9 @@ STDMETHODIMP CCopyCoder::Code(ISequentialInStream *inStream,
 {
   if (!_buf)
   {
-    _buf = (Byte *)::MidAlloc(kBufSize);
+    // SevenInstall: buffer size from I/O policy
+    _bufSize = g_IoPolicy.CopyBufSize;
+    _buf = (Byte *)::MidAlloc(_bufSize);
     if (!_buf)
       return E_OUTOFMEMORY;
   }
@@ -36,7 +38,7 @@ STDMETHODIMP CCopyCoder::Code(ISequentialInStream *inStream,
   
   for (;;)
   {
-    UInt32 size = kBufSize;
+    UInt32 size = _bufSize;
     if (outSize && size > *outSize - TotalSize)
       size = (UInt32)(*outSize - TotalSize);
     if (size == 0)
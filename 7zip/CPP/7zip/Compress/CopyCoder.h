@@ -18,11 +18,12 @@ class CCopyCoder:
   public CMyUnknownImp
 {
   Byte *_buf;
+  UInt32 _bufSize;
   CMyComPtr<ISequentialInStream> _inStream;
 public:
   UInt64 TotalSize;
   
-  CCopyCoder(): _buf(0), TotalSize(0) {};
+  CCopyCoder(): _buf(0), _bufSize(0), TotalSize(0) {};
   ~CCopyCoder();
 
   MY_UNKNOWN_IMP5(
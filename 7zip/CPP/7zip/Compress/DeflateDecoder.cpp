@@ -144,6 +144,7 @@ bool CCoder::ReadTables(void)
     memcpy(levels.distLevels, tmpLevels + numLitLenLevels, _numDistLevels);
   }
   RIF(m_MainDecoder.Build(levels.litLenLevels));
+  m_LiteralPairs.Build(m_MainDecoder, 0x100); // SevenInstall
   return m_DistDecoder.Build(levels.distLevels);
 }
 
@@ -237,7 +238,23 @@ HRESULT CCoder::CodeSpec(UInt32 curSize, bool finishInputStream, UInt32 inputPro
       if (m_InBitStream.ExtraBitsWereRead_Fast())
         return S_FALSE;
 
-      UInt32 sym = m_MainDecoder.Decode(&m_InBitStream);
+      // SevenInstall: short codes, and pairs of literals, are resolved with a single lookup
+      UInt32 sym;
+      const UInt32 item = (curSize >= 2 ? m_LiteralPairs.Lookup(&m_InBitStream) : 0);
+      if (item != 0)
+      {
+        m_InBitStream.MovePos((unsigned)(item & NHuffman::kPairItemNumBitsMask));
+        sym = (item >> NHuffman::kPairItemSym0Shift) & NHuffman::kPairItemSym0Mask;
+        if (((item >> NHuffman::kPairItemKindShift) & 3) == NHuffman::kPairItemKind_Literals)
+        {
+          m_OutWindowStream.PutByte((Byte)sym);
+          m_OutWindowStream.PutByte((Byte)(item >> NHuffman::kPairItemSym1Shift));
+          curSize -= 2;
+          continue;
+        }
+      }
+      else
+        sym = m_MainDecoder.Decode(&m_InBitStream);
 
       if (sym < 0x100)
       {
@@ -18,6 +18,9 @@ namespace NCompress {
 namespace NDeflate {
 namespace NDecoder {
 
+// SevenInstall: width of the literal pair lookup; covers two 5-6 bit literal codes
+const unsigned kNumLiteralPairBits = 11;
+
 const int kLenIdFinished = -1;
 const int kLenIdNeedInit = -2;
 
@@ -37,6 +40,7 @@ class CCoder:
   NBitl::CDecoder<CInBuffer> m_InBitStream;
   NCompress::NHuffman::CDecoder<kNumHuffmanBits, kFixedMainTableSize> m_MainDecoder;
   NCompress::NHuffman::CDecoder<kNumHuffmanBits, kFixedDistTableSize> m_DistDecoder;
+  NCompress::NHuffman::CLiteralPairTable<kNumLiteralPairBits> m_LiteralPairs; // SevenInstall
   NCompress::NHuffman::CDecoder7b<kLevelTableSize> m_LevelDecoder;
 
   UInt32 m_StoredBlockSize;
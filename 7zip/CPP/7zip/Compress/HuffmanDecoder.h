@@ -165,6 +165,17 @@ public:
   }
 
   
+  // SevenInstall: pair (sym << kNumPairLenBits | len) of the code at the top of
+  // the (numBits)-bit value (bits), if that code is in the primary table; 0 otherwise
+  UInt32 GetTablePair(UInt32 bits, unsigned numBits) const
+  {
+    UInt32 val = bits << (kNumBitsMax - numBits);
+    if (val >= _limits[kNumTableBits])
+      return 0;
+    return _lens[val >> (kNumBitsMax - kNumTableBits)];
+  }
+
+  
   template <class TBitDecoder>
   MY_FORCE_INLINE
   UInt32 DecodeFull(TBitDecoder *bitStream) const
@@ -189,6 +200,69 @@ public:
 
 
 
+
+/* SevenInstall: primary lookup table that resolves two consecutive literals
+   (symbols below numLiterals) with one lookup of kNumPairTableBits bits.
+   Items:
+     numBits | (kind << kPairItemKindShift) | (sym0 << kPairItemSym0Shift) | (sym1 << kPairItemSym1Shift)
+   kind is kPairItemKind_Literal or kPairItemKind_Literals for one or two literals,
+   kPairItemKind_Symbol for any other symbol in sym0.
+   0 means that the next code is longer than the table. */
+
+const unsigned kPairItemKindShift = 5;
+const unsigned kPairItemSym0Shift = 7;
+const unsigned kPairItemSym1Shift = 16;
+const UInt32 kPairItemNumBitsMask = (1 << kPairItemKindShift) - 1;
+const UInt32 kPairItemSym0Mask = (1 << (kPairItemSym1Shift - kPairItemSym0Shift)) - 1;
+
+const unsigned kPairItemKind_Literal = 1;
+const unsigned kPairItemKind_Literals = 2;
+const unsigned kPairItemKind_Symbol = 3;
+
+template <unsigned kNumPairTableBits>
+class CLiteralPairTable
+{
+  UInt32 _items[1 << kNumPairTableBits];
+public:
+  template <class TDecoder>
+  void Build(const TDecoder &decoder, UInt32 numLiterals) throw()
+  {
+    const UInt32 kMask = ((UInt32)1 << kNumPairTableBits) - 1;
+    for (UInt32 v = 0; v <= kMask; v++)
+    {
+      UInt32 item = 0;
+      const UInt32 pair = decoder.GetTablePair(v, kNumPairTableBits);
+      const unsigned len = (unsigned)(pair & kPairLenMask);
+      const UInt32 sym = pair >> kNumPairLenBits;
+      if (pair != 0 && len <= kNumPairTableBits)
+      {
+        if (sym >= numLiterals)
+          item = len | (kPairItemKind_Symbol << kPairItemKindShift) | (sym << kPairItemSym0Shift);
+        else
+        {
+          item = len | (kPairItemKind_Literal << kPairItemKindShift) | (sym << kPairItemSym0Shift);
+          // the bits past the table are zero here, so the second code counts only if it fits
+          const UInt32 pair2 = decoder.GetTablePair((v << len) & kMask, kNumPairTableBits);
+          const unsigned len2 = (unsigned)(pair2 & kPairLenMask);
+          const UInt32 sym2 = pair2 >> kNumPairLenBits;
+          if (pair2 != 0 && len + len2 <= kNumPairTableBits && sym2 < numLiterals)
+            item = (len + len2) | (kPairItemKind_Literals << kPairItemKindShift)
+                | (sym << kPairItemSym0Shift) | (sym2 << kPairItemSym1Shift);
+        }
+      }
+      _items[v] = item;
+    }
+  }
+
+  template <class TBitDecoder>
+  MY_FORCE_INLINE
+  UInt32 Lookup(TBitDecoder *bitStream) const
+  {
+    return _items[bitStream->GetValue(kNumPairTableBits)];
+  }
+};
+
+
 template <UInt32 m_NumSymbols>
 class CDecoder7b
 {
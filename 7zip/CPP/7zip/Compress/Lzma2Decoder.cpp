@@ -7,6 +7,8 @@
 #include "../../../C/Alloc.h"
 // #include "../../../C/CpuTicks.h"
 
+#include "../../Common/IoPolicy.h"
+
 #include "../Common/StreamUtils.h"
 
 #include "Lzma2Decoder.h"
@@ -19,8 +21,8 @@ CDecoder::CDecoder():
     , _inProcessed(0)
     , _prop(0xFF)
     , _finishMode(false)
-    , _inBufSize(1 << 20)
-    , _outStep(1 << 20)
+    , _inBufSize(g_IoPolicy.CoderBufSize) // SevenInstall: buffer sizes from I/O policy
+    , _outStep(g_IoPolicy.CoderBufSize)
     #ifndef _7ZIP_ST
     , _tryMt(1)
     , _numThreads(1)
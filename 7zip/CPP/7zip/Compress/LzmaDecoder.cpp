@@ -4,6 +4,8 @@
 
 #include "../../../C/Alloc.h"
 
+#include "../../Common/IoPolicy.h"
+
 #include "../Common/StreamUtils.h"
 
 #include "LzmaDecoder.h"
@@ -30,9 +32,9 @@ CDecoder::CDecoder():
     FinishStream(false),
     _propsWereSet(false),
     _outSizeDefined(false),
-    _outStep(1 << 20),
+    _outStep(g_IoPolicy.CoderBufSize), // SevenInstall: buffer sizes from I/O policy
     _inBufSize(0),
-    _inBufSizeNew(1 << 20)
+    _inBufSizeNew(g_IoPolicy.CoderBufSize)
 {
   _inProcessed = 0;
   _inPos = _inLim = 0;
@@ -6,6 +6,8 @@
 #include "../../../C/Alloc.h"
 #include "../../../C/CpuArch.h"
 
+#include "../../Common/IoPolicy.h"
+
 #include "../Common/StreamUtils.h"
 
 #include "PpmdDecoder.h"
@@ -13,7 +15,6 @@
 namespace NCompress {
 namespace NPpmd {
 
-static const UInt32 kBufSize = (1 << 20);
 
 enum
 {
@@ -97,7 +98,9 @@ STDMETHODIMP CDecoder::Code(ISequentialInStream *inStream, ISequentialOutStream
 {
   if (!_outBuf)
   {
-    _outBuf = (Byte *)::MidAlloc(kBufSize);
+    // SevenInstall: buffer size from I/O policy
+    _outBufSize = g_IoPolicy.CoderBufSize;
+    _outBuf = (Byte *)::MidAlloc(_outBufSize);
     if (!_outBuf)
       return E_OUTOFMEMORY;
   }
@@ -108,7 +111,7 @@ STDMETHODIMP CDecoder::Code(ISequentialInStream *inStream, ISequentialOutStream
   do
   {
     const UInt64 startPos = _processedSize;
-    HRESULT res = CodeSpec(_outBuf, kBufSize);
+    HRESULT res = CodeSpec(_outBuf, _outBufSize);
     size_t processed = (size_t)(_processedSize - startPos);
     RINOK(WriteStream(outStream, _outBuf, processed));
     RINOK(res);
@@ -27,6 +27,7 @@ class CDecoder :
   public CMyUnknownImp
 {
   Byte *_outBuf;
+  UInt32 _outBufSize;
   CPpmd7z_RangeDec _rangeDec;
   CByteInBufWrap _inStream;
   CPpmd7 _ppmd;
@@ -71,7 +72,7 @@ public:
   STDMETHOD(Read)(void *data, UInt32 size, UInt32 *processedSize);
   #endif
 
-  CDecoder(): _outBuf(NULL), _outSizeDefined(false)
+  CDecoder(): _outBuf(NULL), _outBufSize(0), _outSizeDefined(false)
   {
     Ppmd7z_RangeDec_CreateVTable(&_rangeDec);
     _rangeDec.Stream = &_inStream.vt;
@@ -0,0 +1,601 @@
+// ZstdDecoder.cpp
+// SevenInstall: Zstandard decoder (7-Zip-zstd method ID)
+
+#include "StdAfx.h"
+
+#include "../../../C/Alloc.h"
+#include "../../../C/CpuArch.h"
+
+#include "../../Common/IoPolicy.h"
+
+#ifndef _7ZIP_ST
+#include "../../Windows/Synchronization.h"
+#include "../../Windows/Thread.h"
+#endif
+
+#include "../Common/StreamUtils.h"
+
+#include "ZstdDecoder.h"
+
+static HRESULT SResToHRESULT(SRes res)
+{
+  switch (res)
+  {
+    case SZ_OK: return S_OK;
+    case SZ_ERROR_MEM: return E_OUTOFMEMORY;
+    case SZ_ERROR_PARAM: return E_INVALIDARG;
+    case SZ_ERROR_UNSUPPORTED: return E_NOTIMPL;
+    case SZ_ERROR_DATA:
+    case SZ_ERROR_CRC:
+    case SZ_ERROR_OUTPUT_EOF:
+      return S_FALSE;
+  }
+  return E_FAIL;
+}
+
+#define GetBlockHeader(p) (GetUi16(p) | ((UInt32)(p)[2] << 16))
+
+namespace NCompress {
+namespace NZstd {
+
+// Largest window accepted by the streaming decoder (zstd --long=31 on 64-bit).
+static const UInt64 kWindowSizeMax = (UInt64)1 << (sizeof(size_t) == 4 ? 29 : 31);
+
+CDecoder::CDecoder():
+      _dec(NULL)
+    , _inStream(NULL)
+    , _inBuf(NULL)
+    , _inBufSize(g_IoPolicy.CoderBufSize)
+    , _inPos(0)
+    , _inLim(0)
+    , _inEnd(false)
+    , _inProcessed(0)
+    , _inStreamRead(0)
+    , _inSize(NULL)
+    , _outStream(NULL)
+    , _progress(NULL)
+    , _outWritten(0)
+    , _outSize(0)
+    , _outSizeDefined(false)
+    , _finishMode(false)
+    , _blockBuf(NULL)
+    #ifndef _7ZIP_ST
+    , _numThreads(1)
+    , _memUsage((UInt64)(sizeof(size_t)) << 28)
+    , _jobsMemUsage(0)
+    #endif
+{}
+
+CDecoder::~CDecoder()
+{
+  MyFree(_dec);
+  MyFree(_inBuf);
+  MyFree(_blockBuf);
+}
+
+STDMETHODIMP CDecoder::SetDecoderProperties2(const Byte *prop, UInt32 size)
+{
+  // 7-Zip-zstd stores the library version and compression level; neither is needed to decode.
+  UNUSED_VAR(prop);
+  if (size > 5)
+    return E_NOTIMPL;
+  return S_OK;
+}
+
+STDMETHODIMP CDecoder::SetFinishMode(UInt32 finishMode)
+{
+  _finishMode = (finishMode != 0);
+  return S_OK;
+}
+
+STDMETHODIMP CDecoder::GetInStreamProcessedSize(UInt64 *value)
+{
+  *value = _inProcessed;
+  return S_OK;
+}
+
+#ifndef _7ZIP_ST
+
+STDMETHODIMP CDecoder::SetNumberOfThreads(UInt32 numThreads)
+{
+  _numThreads = numThreads;
+  return S_OK;
+}
+
+STDMETHODIMP CDecoder::SetMemLimit(UInt64 memUsage)
+{
+  _memUsage = memUsage;
+  return S_OK;
+}
+
+#endif
+
+
+HRESULT CDecoder::ReadInput(Byte *dest, size_t size, size_t &processed)
+{
+  processed = 0;
+  while (size != 0)
+  {
+    if (_inPos == _inLim)
+    {
+      if (_inEnd)
+        break;
+      size_t rem = _inBufSize;
+      if (_inSize)
+      {
+        const UInt64 inRem = *_inSize - _inStreamRead;
+        if (rem > inRem)
+          rem = (size_t)inRem;
+      }
+      _inPos = 0;
+      _inLim = 0;
+      if (rem != 0)
+      {
+        RINOK(ReadStream(_inStream, _inBuf, &rem));
+      }
+      _inStreamRead += rem;
+      _inLim = rem;
+      if (rem == 0)
+      {
+        _inEnd = true;
+        break;
+      }
+    }
+    size_t cur = _inLim - _inPos;
+    if (cur > size)
+      cur = size;
+    memcpy(dest, _inBuf + _inPos, cur);
+    _inPos += cur;
+    _inProcessed += cur;
+    dest += cur;
+    size -= cur;
+    processed += cur;
+  }
+  return S_OK;
+}
+
+HRESULT CDecoder::ReadExact(Byte *dest, size_t size)
+{
+  size_t processed;
+  RINOK(ReadInput(dest, size, processed));
+  return (processed == size) ? S_OK : S_FALSE;
+}
+
+// Returns a pointer to the next (size) input bytes: directly into the input buffer
+// if they are contiguous there, otherwise copied to the block buffer.
+HRESULT CDecoder::ReadBlock(const Byte *&data, size_t size)
+{
+  if (_inLim - _inPos >= size)
+  {
+    data = _inBuf + _inPos;
+    _inPos += size;
+    _inProcessed += size;
+    return S_OK;
+  }
+  data = _blockBuf;
+  return ReadExact(_blockBuf, size);
+}
+
+HRESULT CDecoder::SkipInput(UInt64 size)
+{
+  while (size != 0)
+  {
+    size_t cur = ZSTD_BLOCK_SIZE_MAX;
+    if (cur > size)
+      cur = (size_t)size;
+    RINOK(ReadExact(_blockBuf, cur));
+    size -= cur;
+  }
+  return S_OK;
+}
+
+HRESULT CDecoder::WriteOutput(const Byte *data, size_t size)
+{
+  if (_outSizeDefined)
+  {
+    const UInt64 rem = _outSize - _outWritten;
+    if (size > rem)
+    {
+      if (_finishMode)
+        return S_FALSE;
+      size = (size_t)rem;
+    }
+  }
+  if (size == 0)
+    return S_OK;
+  RINOK(WriteStream(_outStream, data, size));
+  _outWritten += size;
+  if (_progress)
+  {
+    RINOK(_progress->SetRatioInfo(&_inProcessed, &_outWritten));
+  }
+  return S_OK;
+}
+
+
+/*
+  Streaming decode of one frame.
+  The output is collected in a buffer of (2 * window + block); when it runs out of
+  space, everything is flushed and the last (window) bytes are moved to the front
+  as match history. Frames that fit the buffer completely are decoded in place.
+*/
+
+HRESULT CDecoder::DecodeFrame(const CZstdFrameHeader &header)
+{
+  if (header.WindowSize > kWindowSizeMax)
+    return E_NOTIMPL;
+  const size_t windowSize = (size_t)header.WindowSize;
+  size_t bufSize = windowSize * 2 + ZSTD_BLOCK_SIZE_MAX;
+  const bool wholeFrame = (header.ContentSize <= bufSize);
+  if (wholeFrame)
+    bufSize = (size_t)header.ContentSize;
+  #ifndef _7ZIP_ST
+  // frames whose window needs more than the memory limit allows are not decoded
+  if (bufSize > _memUsage)
+    return E_OUTOFMEMORY;
+  #endif
+
+  _window.AllocAtLeast(bufSize);
+  if (!_window.IsAllocated())
+    return E_OUTOFMEMORY;
+  Byte *buf = _window;
+
+  const size_t outStep = g_IoPolicy.CoderBufSize;
+  size_t pos = 0;
+  size_t flushed = 0;
+  UInt64 frameSize = 0;
+  CXxh64 xxh;
+  Xxh64_Init(&xxh);
+  ZstdDec_InitFrame(_dec);
+
+  for (;;)
+  {
+    Byte temp[ZSTD_BLOCK_HEADER_SIZE];
+    RINOK(ReadExact(temp, ZSTD_BLOCK_HEADER_SIZE));
+    const UInt32 blockHeader = GetBlockHeader(temp);
+    const UInt32 srcSize = ZstdBlockHeader_GetContentSize(blockHeader);
+    if (srcSize > ZSTD_BLOCK_SIZE_MAX)
+      return S_FALSE;
+    const Byte *src;
+    RINOK(ReadBlock(src, srcSize));
+
+    if (!wholeFrame && bufSize - pos < ZSTD_BLOCK_SIZE_MAX)
+    {
+      Xxh64_Update(&xxh, buf + flushed, pos - flushed);
+      RINOK(WriteOutput(buf + flushed, pos - flushed));
+      memmove(buf, buf + pos - windowSize, windowSize);
+      pos = windowSize;
+      flushed = pos;
+    }
+
+    size_t len;
+    RINOK(SResToHRESULT(ZstdDec_DecodeBlock(_dec, blockHeader, src, srcSize,
+        buf + pos, bufSize - pos, pos, &len)));
+    pos += len;
+    frameSize += len;
+    if (frameSize > header.ContentSize)
+      return S_FALSE;
+
+    if (pos - flushed >= outStep)
+    {
+      Xxh64_Update(&xxh, buf + flushed, pos - flushed);
+      RINOK(WriteOutput(buf + flushed, pos - flushed));
+      flushed = pos;
+      if (IsOutFinished() && !_finishMode)
+        return S_OK;
+    }
+
+    if (ZstdBlockHeader_IsLast(blockHeader))
+      break;
+  }
+
+  Xxh64_Update(&xxh, buf + flushed, pos - flushed);
+  RINOK(WriteOutput(buf + flushed, pos - flushed));
+
+  if (header.ContentSize != ZSTD_CONTENT_SIZE_UNKNOWN && frameSize != header.ContentSize)
+    return S_FALSE;
+  if (header.ChecksumFlag)
+  {
+    Byte temp[ZSTD_CHECKSUM_SIZE];
+    RINOK(ReadExact(temp, ZSTD_CHECKSUM_SIZE));
+    if (GetUi32(temp) != (UInt32)Xxh64_Digest(&xxh))
+      return S_FALSE;
+  }
+  return S_OK;
+}
+
+
+#ifndef _7ZIP_ST
+
+/*
+  Multi-threaded decoding.
+  Streams written by multi-threaded zstd encoders consist of many independent
+  frames with stored content sizes. Such frames are read completely into jobs;
+  a batch of jobs is decoded in parallel and then written in order.
+  Single-frame streams always go through the streaming decoder.
+*/
+
+static const UInt64 kMtFrameSizeMax = (UInt64)1 << 26;
+
+static SRes DecodeFrameJob(CZstdDec *dec, CFrameJob &job)
+{
+  const Byte *src = job.Packed;
+  const Byte *srcLim = src + job.Packed.GetPos();
+  Byte *dest = job.Unpacked;
+  const size_t destSize = (size_t)job.Header.ContentSize;
+  size_t destPos = 0;
+
+  ZstdDec_InitFrame(dec);
+  for (;;)
+  {
+    // block sizes were validated when the job was read
+    const UInt32 blockHeader = GetBlockHeader(src);
+    const UInt32 srcSize = ZstdBlockHeader_GetContentSize(blockHeader);
+    src += ZSTD_BLOCK_HEADER_SIZE;
+    size_t len;
+    const SRes res = ZstdDec_DecodeBlock(dec, blockHeader, src, srcSize,
+        dest + destPos, destSize - destPos, destPos, &len);
+    if (res != SZ_OK)
+      return res;
+    src += srcSize;
+    destPos += len;
+    if (ZstdBlockHeader_IsLast(blockHeader) || src == srcLim)
+      break;
+  }
+  if (destPos != destSize)
+    return SZ_ERROR_DATA;
+  if (job.Header.ChecksumFlag)
+  {
+    CXxh64 xxh;
+    Xxh64_Init(&xxh);
+    Xxh64_Update(&xxh, dest, destSize);
+    if ((UInt32)Xxh64_Digest(&xxh) != job.Checksum)
+      return SZ_ERROR_CRC;
+  }
+  return SZ_OK;
+}
+
+class CMtDecoder
+{
+  CObjectVector<CFrameJob> &_jobs;
+  NWindows::NSynchronization::CCriticalSection _cs;
+  unsigned _next;
+public:
+  CMtDecoder(CObjectVector<CFrameJob> &jobs): _jobs(jobs), _next(0) {}
+
+  void Run(CZstdDec *dec)
+  {
+    for (;;)
+    {
+      unsigned index;
+      {
+        NWindows::NSynchronization::CCriticalSectionLock lock(_cs);
+        index = _next;
+        if (index == _jobs.Size())
+          return;
+        _next++;
+      }
+      CFrameJob &job = _jobs[index];
+      job.Res = DecodeFrameJob(dec, job);
+    }
+  }
+};
+
+struct CMtWorker
+{
+  CMtDecoder *Mt;
+  CZstdDec *Dec;
+  NWindows::CThread Thread;
+
+  CMtWorker(): Mt(NULL), Dec(NULL) {}
+  ~CMtWorker() { MyFree(Dec); }
+};
+
+static THREAD_FUNC_DECL MtWorkerThread(void *param)
+{
+  CMtWorker *worker = (CMtWorker *)param;
+  worker->Mt->Run(worker->Dec);
+  return 0;
+}
+
+bool CDecoder::CanDecodeFrameMt(const CZstdFrameHeader &header) const
+{
+  if (_numThreads <= 1 || header.ContentSize > kMtFrameSizeMax)
+    return false;
+  // packed and unpacked data of a frame per thread, times two for the batch
+  return header.ContentSize * 4 * _numThreads <= _memUsage;
+}
+
+HRESULT CDecoder::ReadFrameJob(const CZstdFrameHeader &header)
+{
+  CFrameJob &job = _jobs.AddNew();
+  job.Header = header;
+  job.Checksum = 0;
+  job.Res = SZ_OK;
+
+  // Raw blocks bound the packed size of valid data; allow some slack for block headers.
+  const UInt64 packSizeMax = header.ContentSize + (header.ContentSize >> 4) + ((UInt32)1 << 16);
+  for (;;)
+  {
+    Byte temp[ZSTD_BLOCK_HEADER_SIZE];
+    RINOK(ReadExact(temp, ZSTD_BLOCK_HEADER_SIZE));
+    const UInt32 blockHeader = GetBlockHeader(temp);
+    const UInt32 srcSize = ZstdBlockHeader_GetContentSize(blockHeader);
+    if (srcSize > ZSTD_BLOCK_SIZE_MAX)
+      return S_FALSE;
+    if (job.Packed.GetPos() + ZSTD_BLOCK_HEADER_SIZE + srcSize > packSizeMax)
+      return S_FALSE;
+    job.Packed.AddData(temp, ZSTD_BLOCK_HEADER_SIZE);
+    RINOK(ReadExact(job.Packed.GetCurPtrAndGrow(srcSize), srcSize));
+    if (ZstdBlockHeader_IsLast(blockHeader))
+      break;
+  }
+  if (header.ChecksumFlag)
+  {
+    Byte temp[ZSTD_CHECKSUM_SIZE];
+    RINOK(ReadExact(temp, ZSTD_CHECKSUM_SIZE));
+    job.Checksum = GetUi32(temp);
+  }
+
+  job.Unpacked.AllocAtLeast((size_t)header.ContentSize);
+  if (!job.Unpacked.IsAllocated())
+    return E_OUTOFMEMORY;
+  _jobsMemUsage += job.Packed.GetPos() + header.ContentSize;
+  return S_OK;
+}
+
+HRESULT CDecoder::DecodeJobs()
+{
+  if (_jobs.IsEmpty())
+    return S_OK;
+
+  unsigned numThreads = _jobs.Size();
+  if (numThreads > _numThreads)
+    numThreads = _numThreads;
+
+  {
+    CMtDecoder mt(_jobs);
+    CObjectVector<CMtWorker> workers;
+    workers.ClearAndReserve(numThreads);
+    for (unsigned i = 1; i < numThreads; i++)
+    {
+      CMtWorker &worker = workers.AddNewInReserved();
+      worker.Mt = &mt;
+      worker.Dec = (CZstdDec *)MyAlloc(sizeof(CZstdDec));
+      if (!worker.Dec || worker.Thread.Create(MtWorkerThread, &worker) != 0)
+      {
+        // fewer threads are fine: the remaining jobs are picked up by the others
+        workers.DeleteBack();
+        break;
+      }
+    }
+    mt.Run(_dec);
+    FOR_VECTOR (i, workers)
+      workers[i].Thread.Wait();
+  }
+
+  HRESULT res = S_OK;
+  FOR_VECTOR (i, _jobs)
+  {
+    const CFrameJob &job = _jobs[i];
+    if (job.Res != SZ_OK)
+    {
+      res = SResToHRESULT(job.Res);
+      break;
+    }
+    res = WriteOutput(job.Unpacked, (size_t)job.Header.ContentSize);
+    if (res != S_OK)
+      break;
+  }
+  _jobs.Clear();
+  _jobsMemUsage = 0;
+  return res;
+}
+
+#endif
+
+
+HRESULT CDecoder::CodeReal(ISequentialInStream *inStream, ISequentialOutStream *outStream,
+    const UInt64 *inSize, const UInt64 *outSize, ICompressProgressInfo *progress)
+{
+  if (!_dec)
+  {
+    _dec = (CZstdDec *)MyAlloc(sizeof(CZstdDec));
+    if (!_dec)
+      return E_OUTOFMEMORY;
+  }
+  if (!_inBuf)
+  {
+    _inBuf = (Byte *)MyAlloc(_inBufSize);
+    if (!_inBuf)
+      return E_OUTOFMEMORY;
+  }
+  if (!_blockBuf)
+  {
+    _blockBuf = (Byte *)MyAlloc(ZSTD_BLOCK_SIZE_MAX);
+    if (!_blockBuf)
+      return E_OUTOFMEMORY;
+  }
+
+  _inStream = inStream;
+  _inSize = inSize;
+  _inPos = 0;
+  _inLim = 0;
+  _inEnd = false;
+  _inProcessed = 0;
+  _inStreamRead = 0;
+  _outStream = outStream;
+  _progress = progress;
+  _outWritten = 0;
+  _outSizeDefined = (outSize != NULL);
+  _outSize = outSize ? *outSize : 0;
+
+  for (bool firstFrame = true;; firstFrame = false)
+  {
+    if (IsOutFinished() && !_finishMode)
+      break;
+
+    Byte header[ZSTD_FRAME_HEADER_SIZE_MAX];
+    size_t processed;
+    RINOK(ReadInput(header, 4, processed));
+    if (processed == 0 && !firstFrame)
+      break;
+    if (processed != 4)
+      return S_FALSE;
+
+    const UInt32 magic = GetUi32(header);
+    if (magic >= ZSTD_SKIPPABLE_MAGIC_MIN && magic <= ZSTD_SKIPPABLE_MAGIC_MAX)
+    {
+      RINOK(ReadExact(header + 4, 4));
+      RINOK(SkipInput(GetUi32(header + 4)));
+      continue;
+    }
+    if (magic != ZSTD_FRAME_MAGIC)
+      return S_FALSE;
+
+    RINOK(ReadExact(header + 4, ZSTD_FRAME_HEADER_SIZE_MIN - 4));
+    const unsigned headerSize = ZstdFrameHeader_GetSize(header);
+    RINOK(ReadExact(header + ZSTD_FRAME_HEADER_SIZE_MIN, headerSize - ZSTD_FRAME_HEADER_SIZE_MIN));
+    CZstdFrameHeader frame;
+    RINOK(SResToHRESULT(ZstdFrameHeader_Parse(&frame, header)));
+
+    #ifndef _7ZIP_ST
+    if (CanDecodeFrameMt(frame))
+    {
+      if (_jobs.Size() >= _numThreads * 2
+          || _jobsMemUsage + frame.ContentSize * 2 > _memUsage / 2)
+      {
+        RINOK(DecodeJobs());
+      }
+      RINOK(ReadFrameJob(frame));
+      continue;
+    }
+    RINOK(DecodeJobs());
+    #endif
+
+    RINOK(DecodeFrame(frame));
+  }
+
+  #ifndef _7ZIP_ST
+  RINOK(DecodeJobs());
+  #endif
+
+  if (_outSizeDefined && _outWritten != _outSize)
+    return S_FALSE;
+  return S_OK;
+}
+
+STDMETHODIMP CDecoder::Code(ISequentialInStream *inStream, ISequentialOutStream *outStream,
+    const UInt64 *inSize, const UInt64 *outSize, ICompressProgressInfo *progress)
+{
+  HRESULT res;
+  try { res = CodeReal(inStream, outStream, inSize, outSize, progress); }
+  catch(...) { res = E_OUTOFMEMORY; }
+  #ifndef _7ZIP_ST
+  _jobs.Clear();
+  _jobsMemUsage = 0;
+  #endif
+  return res;
+}
+
+}}
@@ -0,0 +1,122 @@
+// ZstdDecoder.h
+// SevenInstall: Zstandard decoder (7-Zip-zstd method ID)
+
+#ifndef __ZSTD_DECODER_H
+#define __ZSTD_DECODER_H
+
+#include "../../../C/ZstdDec.h"
+
+#include "../../Common/DynamicBuffer.h"
+#include "../../Common/MyBuffer2.h"
+#include "../../Common/MyCom.h"
+#include "../../Common/MyVector.h"
+
+#include "../ICoder.h"
+
+namespace NCompress {
+namespace NZstd {
+
+#ifndef _7ZIP_ST
+
+// A frame with known content size, buffered for parallel decoding
+struct CFrameJob
+{
+  CZstdFrameHeader Header;
+  CByteDynamicBuffer Packed;  // block headers and contents, without checksum
+  CMidBuffer Unpacked;
+  UInt32 Checksum;
+  SRes Res;
+};
+
+#endif
+
+class CDecoder:
+  public ICompressCoder,
+  public ICompressSetDecoderProperties2,
+  public ICompressSetFinishMode,
+  public ICompressGetInStreamProcessedSize,
+
+  #ifndef _7ZIP_ST
+  public ICompressSetCoderMt,
+  public ICompressSetMemLimit,
+  #endif
+
+  public CMyUnknownImp
+{
+  CZstdDec *_dec;
+
+  // input
+  ISequentialInStream *_inStream;
+  Byte *_inBuf;
+  size_t _inBufSize;
+  size_t _inPos;
+  size_t _inLim;
+  bool _inEnd;
+  UInt64 _inProcessed;
+  UInt64 _inStreamRead;
+  const UInt64 *_inSize;
+
+  // output
+  ISequentialOutStream *_outStream;
+  ICompressProgressInfo *_progress;
+  UInt64 _outWritten;
+  UInt64 _outSize;
+  bool _outSizeDefined;
+  bool _finishMode;
+
+  CMidBuffer _window;
+  Byte *_blockBuf;
+
+  HRESULT ReadInput(Byte *dest, size_t size, size_t &processed);
+  HRESULT ReadExact(Byte *dest, size_t size);
+  HRESULT ReadBlock(const Byte *&data, size_t size);
+  HRESULT SkipInput(UInt64 size);
+  HRESULT WriteOutput(const Byte *data, size_t size);
+  bool IsOutFinished() const { return _outSizeDefined && _outWritten >= _outSize; }
+
+  HRESULT DecodeFrame(const CZstdFrameHeader &header);
+
+  #ifndef _7ZIP_ST
+  UInt32 _numThreads;
+  UInt64 _memUsage;
+  CObjectVector<CFrameJob> _jobs;
+  UInt64 _jobsMemUsage;
+
+  bool CanDecodeFrameMt(const CZstdFrameHeader &header) const;
+  HRESULT ReadFrameJob(const CZstdFrameHeader &header);
+  HRESULT DecodeJobs();
+public:
+  STDMETHOD(SetNumberOfThreads)(UInt32 numThreads);
+  STDMETHOD(SetMemLimit)(UInt64 memUsage);
+  #endif
+
+  HRESULT CodeReal(ISequentialInStream *inStream, ISequentialOutStream *outStream,
+      const UInt64 *inSize, const UInt64 *outSize, ICompressProgressInfo *progress);
+
+public:
+  MY_QUERYINTERFACE_BEGIN2(ICompressCoder)
+  MY_QUERYINTERFACE_ENTRY(ICompressSetDecoderProperties2)
+  MY_QUERYINTERFACE_ENTRY(ICompressSetFinishMode)
+  MY_QUERYINTERFACE_ENTRY(ICompressGetInStreamProcessedSize)
+
+  #ifndef _7ZIP_ST
+  MY_QUERYINTERFACE_ENTRY(ICompressSetCoderMt)
+  MY_QUERYINTERFACE_ENTRY(ICompressSetMemLimit)
+  #endif
+
+  MY_QUERYINTERFACE_END
+  MY_ADDREF_RELEASE
+
+  STDMETHOD(Code)(ISequentialInStream *inStream, ISequentialOutStream *outStream,
+      const UInt64 *inSize, const UInt64 *outSize, ICompressProgressInfo *progress);
+  STDMETHOD(SetDecoderProperties2)(const Byte *data, UInt32 size);
+  STDMETHOD(SetFinishMode)(UInt32 finishMode);
+  STDMETHOD(GetInStreamProcessedSize)(UInt64 *value);
+
+  CDecoder();
+  virtual ~CDecoder();
+};
+
+}}
+
+#endif
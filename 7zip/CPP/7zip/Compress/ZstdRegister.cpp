@@ -0,0 +1,17 @@
+// ZstdRegister.cpp
+// SevenInstall: Zstandard decoder (7-Zip-zstd method ID)
+
+#include "StdAfx.h"
+
+#include "../Common/RegisterCodec.h"
+
+#include "ZstdDecoder.h"
+
+namespace NCompress {
+namespace NZstd {
+
+REGISTER_CODEC_CREATE(CreateDec, CDecoder)
+
+REGISTER_CODEC_2(ZSTD, CreateDec, NULL, 0x4F71101, "ZSTD")
+
+}}
@@ -124,4 +124,12 @@ STREAM_INTERFACE(IStreamGetProps2, 0x09)
   STDMETHOD(GetProps2)(CStreamFileProps *props) PURE;
 };
 
+#ifdef _WIN32
+// SevenInstall: access to the file behind a stream, e.g. to map it into memory
+STREAM_INTERFACE(IStreamGetFileHandle, 0x0A)
+{
+  STDMETHOD(GetFileHandle)(HANDLE *handle) PURE;
+};
+#endif
+
 #endif
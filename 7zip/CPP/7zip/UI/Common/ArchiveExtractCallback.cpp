@@ -14,6 +14,7 @@
 
 #include "../../../Common/ComTry.h"
 #include "../../../Common/IntToString.h"
+#include "../../../Common/IoPolicy.h"
 #include "../../../Common/StringConvert.h"
 #include "../../../Common/Wildcard.h"
 
@@ -24,6 +25,8 @@
 #include "../../../Windows/PropVariant.h"
 #include "../../../Windows/PropVariantConv.h"
 
+#include "../../../../../Trace.hpp" // SevenInstall: timer for extraction timings
+
 #if defined(_WIN32) && !defined(UNDER_CE)  && !defined(_SFX)
 #define _USE_SECURITY_CODE
 #include "../../../Windows/SecurityUtils.h"
@@ -49,6 +52,7 @@ static const char * const kCantCreateHardLink = "Can not create hard link";
 static const char * const kCantCreateSymLink = "Can not create symbolic link";
 static const char * const kCantOpenOutFile = "Can not open output file";
 static const char * const kCantSetFileLen = "Can not set length for output file";
+static const char * const kCantUnmapOutFile = "Can not unmap output file";
 
 
 #ifndef _SFX
@@ -181,12 +185,57 @@ HRESULT CArchiveExtractCallback::PrepareHardLinks(const CRecordVector<UInt32> *r
 
 #endif
 
+void CExtractTimings::CHistogram::Clear()
+{
+  for (unsigned i = 0; i < kNumBuckets; i++)
+    Counts[i] = 0;
+  Num = 0;
+  Sum_us = 0;
+  Max_us = 0;
+}
+
+void CExtractTimings::CHistogram::Add(UInt64 us)
+{
+  unsigned bucket = 0;
+  while (bucket < kNumBuckets - 1 && (us >> (bucket + 1)) != 0)
+    bucket++;
+  Counts[bucket]++;
+  Num++;
+  Sum_us += us;
+  if (us > Max_us)
+    Max_us = us;
+}
+
+void CExtractTimings::BeginFolder(UInt32 index, UInt64 packSize)
+{
+  EndFolder();
+  CFolder folder;
+  folder.Index = index;
+  folder.NumFiles = 0;
+  folder.PackSize = packSize;
+  folder.UnpackSize = 0;
+  folder.Time_us = 0;
+  Folders.Add(folder);
+  CurFolderDefined = true;
+  CurFolderStart = Trace::GetTicks();
+}
+
+void CExtractTimings::EndFolder()
+{
+  if (!CurFolderDefined)
+    return;
+  Folders.Back().Time_us = Trace::TicksToMicroseconds(Trace::GetTicks() - CurFolderStart);
+  CurFolderDefined = false;
+}
+
+
 CArchiveExtractCallback::CArchiveExtractCallback():
     _arc(NULL),
     WriteCTime(true),
     WriteATime(true),
     WriteMTime(true),
-    _multiArchives(false)
+    _multiArchives(false),
+    Timings(NULL)
 {
   LocalProgressSpec = new CLocalProgress();
   _localProgress = LocalProgressSpec;
@@ -657,6 +706,22 @@ STDMETHODIMP CArchiveExtractCallback::GetStream(UInt32 index, ISequentialOutStre
 
   RINOK(_arc->GetItem(index, _item));
 
+  if (Timings)
+  {
+    NCOM::CPropVariant prop;
+    RINOK(archive->GetProperty(index, kpidBlock, &prop));
+    if (prop.vt == VT_UI4
+        && (!Timings->CurFolderDefined || Timings->Folders.Back().Index != prop.ulVal))
+    {
+      UInt32 folderIndex = prop.ulVal;
+      UInt64 packSize = 0;
+      prop.Clear();
+      RINOK(archive->GetProperty(index, kpidPackSize, &prop));
+      ConvertPropVariantToUInt64(prop, packSize);
+      Timings->BeginFolder(folderIndex, packSize);
+    }
+  }
+
   {
     NCOM::CPropVariant prop;
     RINOK(archive->GetProperty(index, kpidPosition, &prop));
@@ -1114,6 +1179,7 @@ if (askExtractMode == NArchive::NExtract::NAskMode::kExtract && !_testMode)
     if (fileInfo.Find(fullProcessedPath))
     {
       bool doRename = false;
+      bool doReplace = false;
       switch (_overwriteMode)
       {
         case NExtract::NOverwriteMode::kSkip:
@@ -1139,6 +1205,7 @@ if (askExtractMode == NArchive::NExtract::NAskMode::kExtract && !_testMode)
             case NOverwriteAnswer::kYesToAll: _overwriteMode = NExtract::NOverwriteMode::kOverwrite; break;
             case NOverwriteAnswer::kRename: doRename = true; break;
             case NOverwriteAnswer::kAutoRename: _overwriteMode = NExtract::NOverwriteMode::kRename; break;
+            case NOverwriteAnswer::kReplace: doReplace = true; break; // SevenInstall
             default:
               return E_FAIL;
           }
@@ -1181,7 +1248,8 @@ if (askExtractMode == NArchive::NExtract::NAskMode::kExtract && !_testMode)
         }
         else
         {
-          bool needDelete = true;
+          // SevenInstall: CREATE_ALWAYS truncates the file, if it may be replaced in place
+          bool needDelete = !doReplace;
           if (needDelete)
           {
             if (NFind::DoesFileExist(fullProcessedPath))
@@ -1356,9 +1424,17 @@ if (askExtractMode == NArchive::NExtract::NAskMode::kExtract && !_testMode)
         
         if (needWriteFile)
         {
+          UInt64 createStart = Timings ? Trace::GetTicks() : 0;
           _outFileStreamSpec = new COutFileStream;
           CMyComPtr<ISequentialOutStream> outStreamLoc2(_outFileStreamSpec);
-          if (!_outFileStreamSpec->Open(fullProcessedPath, _isSplit ? OPEN_ALWAYS: CREATE_ALWAYS))
+          _outFileStreamSpec->MeasureWriteTime = (Timings != NULL);
+          _outFileStreamSpec->Sparse = g_IoPolicy.SparseOutput; // SevenInstall
+          // SevenInstall: large files are written through a mapping, which needs the final length
+          const bool mapOutput = (g_IoPolicy.MapOutputMinSize != 0 && !g_IoPolicy.SparseOutput
+              && !_isSplit && _curSizeDefined && _curSize >= g_IoPolicy.MapOutputMinSize);
+          if (!(mapOutput ?
+              _outFileStreamSpec->OpenForMapping(fullProcessedPath, CREATE_ALWAYS) :
+              _outFileStreamSpec->Open(fullProcessedPath, _isSplit ? OPEN_ALWAYS: CREATE_ALWAYS)))
           {
             // if (::GetLastError() != ERROR_FILE_EXISTS || !isSplit)
             {
@@ -1367,7 +1443,9 @@ if (askExtractMode == NArchive::NExtract::NAskMode::kExtract && !_testMode)
             }
           }
 
-          if (_ntOptions.PreAllocateOutFile && !_isSplit && _curSizeDefined && _curSize > (1 << 12))
+          // SevenInstall: minimum size from I/O policy
+          if ((_ntOptions.PreAllocateOutFile && !_isSplit && _curSizeDefined && _curSize > g_IoPolicy.PreAllocateMinSize)
+              || mapOutput)
           {
             // UInt64 ticks = GetCpuTicks();
             bool res = _outFileStreamSpec->File.SetLength(_curSize);
@@ -1401,12 +1479,17 @@ if (askExtractMode == NArchive::NExtract::NAskMode::kExtract && !_testMode)
             {
               RINOK(SendMessageError_with_LastError("Can not seek to begin of file", fullProcessedPath));
             }
+
+            // SevenInstall: if the file can't be mapped, it's written as usual
+            if (mapOutput && _fileLengthWasSet && res)
+              _outFileStreamSpec->MapOutput(_curSize);
           }
 
           //#ifdef SUPPORT_ALT_STREAMS
           if (isRenamed /*&& !_item.IsAltStream*/)
           {
             CIndexToPathPair pair(index, fullProcessedPath);
+            pair.ItemPath = _item.Path;
             unsigned oldSize = _renamedFiles.Size();
             unsigned insertIndex = _renamedFiles.AddToUniqueSorted(pair);
             if (oldSize == _renamedFiles.Size())
@@ -1418,6 +1501,9 @@ if (askExtractMode == NArchive::NExtract::NAskMode::kExtract && !_testMode)
           {
             RINOK(_outFileStreamSpec->Seek(_position, STREAM_SEEK_SET, NULL));
           }
+
+          if (Timings)
+            Timings->Create.Add(Trace::TicksToMicroseconds(Trace::GetTicks() - createStart));
          
           _outFileStream = outStreamLoc2;
         }
@@ -1506,6 +1592,15 @@ HRESULT CArchiveExtractCallback::CloseFile()
     return S_OK;
   
   HRESULT hres = S_OK;
+  UInt64 closeStart = Timings ? Trace::GetTicks() : 0;
+  // SevenInstall: unmap before changing the length or the times
+  if (_outFileStreamSpec->FinishMapping() != S_OK)
+    hres = SendMessageError_with_LastError(kCantUnmapOutFile, us2fs(_item.Path));
+  // SevenInstall: a hole at the end must be done before setting the times
+  if (_outFileStreamSpec->FinishSparse() != S_OK)
+    hres = SendMessageError_with_LastError(kCantSetFileLen, us2fs(_item.Path));
+  SparseSkipped += _outFileStreamSpec->SparseSkipped;
+  SparseSaved += _outFileStreamSpec->SparseSaved;
   _outFileStreamSpec->SetTime(
       (WriteCTime && _fi.CTimeDefined) ? &_fi.CTime : NULL,
       (WriteATime && _fi.ATimeDefined) ? &_fi.ATime : NULL,
@@ -1522,6 +1617,17 @@ HRESULT CArchiveExtractCallback::CloseFile()
   _curSize = processedSize;
   _curSizeDefined = true;
   RINOK(_outFileStreamSpec->Close());
+  if (Timings)
+  {
+    Timings->Close.Add(Trace::TicksToMicroseconds(Trace::GetTicks() - closeStart));
+    Timings->Write.Add(Trace::TicksToMicroseconds(_outFileStreamSpec->WriteTicks));
+    if (Timings->CurFolderDefined)
+    {
+      CExtractTimings::CFolder &folder = Timings->Folders.Back();
+      folder.NumFiles++;
+      folder.UnpackSize += processedSize;
+    }
+  }
   _outFileStream.Release();
   return hres;
 }
@@ -1709,6 +1815,8 @@ HRESULT CArchiveExtractCallback::SetDirsTimes()
 HRESULT CArchiveExtractCallback::CloseArc()
 {
   HRESULT res = CloseFile();
+  if (Timings)
+    Timings->EndFolder();
   HRESULT res2 = SetDirsTimes();
   if (res == S_OK)
     res = res2;
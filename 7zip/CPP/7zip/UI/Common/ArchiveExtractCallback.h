@@ -139,6 +139,7 @@ struct CIndexToPathPair
 {
   UInt32 Index;
   FString Path;
+  UString ItemPath; // SevenInstall: sequential archives can't be asked for item properties afterwards
 
   CIndexToPathPair(UInt32 index): Index(index) {}
   CIndexToPathPair(UInt32 index, const FString &path): Index(index), Path(path) {}
@@ -170,6 +171,48 @@ struct CDirPathTime
 
 
 
+// Timing statistics for extracted files. Gathered if CArchiveExtractCallback::Timings is set.
+struct CExtractTimings
+{
+  // Histogram of durations; bucket i counts durations of [2^i, 2^(i+1)) microseconds
+  struct CHistogram
+  {
+    enum { kNumBuckets = 32 };
+    UInt64 Counts[kNumBuckets];
+    UInt64 Num;
+    UInt64 Sum_us;
+    UInt64 Max_us;
+
+    CHistogram() { Clear(); }
+    void Clear();
+    void Add(UInt64 us);
+  };
+
+  struct CFolder
+  {
+    UInt32 Index;
+    UInt32 NumFiles;
+    UInt64 PackSize;
+    UInt64 UnpackSize;
+    UInt64 Time_us;
+  };
+
+  CHistogram Create;
+  CHistogram Write;
+  CHistogram Close;
+  CRecordVector<CFolder> Folders;
+
+  // Folder items are currently extracted from
+  bool CurFolderDefined;
+  UInt64 CurFolderStart;
+
+  CExtractTimings(): CurFolderDefined(false), CurFolderStart(0) {}
+
+  void BeginFolder(UInt32 index, UInt64 packSize);
+  void EndFolder();
+};
+
+
 class CArchiveExtractCallback:
   public IArchiveExtractCallback,
   public IArchiveExtractCallbackMessage,
@@ -283,6 +326,9 @@ public:
   UInt64 NumAltStreams;
   UInt64 UnpackSize;
   UInt64 AltStreams_UnpackSize;
+  // SevenInstall: sparse output statistics, see COutFileStream::Sparse
+  UInt64 SparseSkipped;
+  UInt64 SparseSaved;
   
   MY_UNKNOWN_IMP3(IArchiveExtractCallbackMessage, ICryptoGetTextPassword, ICompressProgressInfo)
 
@@ -305,6 +351,7 @@ public:
     _overwriteMode = overwriteMode;
     _keepAndReplaceEmptyDirPrefixes = keepAndReplaceEmptyDirPrefixes;
     NumFolders = NumFiles = NumAltStreams = UnpackSize = AltStreams_UnpackSize = 0;
+    SparseSkipped = SparseSaved = 0;
   }
 
   #ifndef _SFX
@@ -351,6 +398,8 @@ public:
   CObjectVector<CIndexToPathPair> _renamedFiles;
   //#endif
 
+  CExtractTimings *Timings;
+
   // call it after Init()
 
   #ifndef _SFX
@@ -20,7 +20,9 @@ namespace NOverwriteAnswer
     kNoToAll,
     kAutoRename,
     kRename,
-    kCancel
+    kCancel,
+    // SevenInstall: overwrite the existing file in place, without deleting it first
+    kReplace
   };
 }
 
@@ -12,6 +12,7 @@
 
 #include "../../../Common/ComTry.h"
 #include "../../../Common/IntToString.h"
+#include "../../../Common/IoPolicy.h"
 #include "../../../Common/StringConvert.h"
 #include "../../../Common/StringToInt.h"
 #include "../../../Common/Wildcard.h"
@@ -2972,15 +2973,23 @@ HRESULT CArc::OpenStreamOrFile(COpenOptions &op)
   
   if (op.stdInMode)
   {
-    seqStream = new CStdInFileStream;
-    op.seqStream = seqStream;
+    // SevenInstall: keep a sequential stream given by the caller (streaming install)
+    if (!op.seqStream)
+    {
+      seqStream = new CStdInFileStream;
+      op.seqStream = seqStream;
+    }
   }
   else if (!op.stream)
   {
     fileStreamSpec = new CInFileStream;
     fileStream = fileStreamSpec;
     Path = filePath;
-    if (!fileStreamSpec->Open(us2fs(Path)))
+    // SevenInstall: pass sequential access hint, if enabled
+    bool opened = g_IoPolicy.SequentialScan ?
+        fileStreamSpec->OpenSequential(us2fs(Path)) :
+        fileStreamSpec->Open(us2fs(Path));
+    if (!opened)
     {
       return GetLastError();
     }
@@ -2989,6 +2998,13 @@ HRESULT CArc::OpenStreamOrFile(COpenOptions &op)
     IgnoreSplit = true;
     #endif
   }
+  #ifdef _SFX
+  else if (op.streamIsFile)
+  {
+    Path = filePath;
+    IgnoreSplit = true;
+  }
+  #endif
 
   /*
   if (callback)
@@ -3004,8 +3020,9 @@ HRESULT CArc::OpenStreamOrFile(COpenOptions &op)
   
   #ifdef _SFX
   
+  // SevenInstall: also look for the split archive if the caller opened the file
   if (res != S_FALSE
-      || !fileStreamSpec
+      || (!fileStreamSpec && !op.streamIsFile)
       || !op.callbackSpec
       || NonOpen_ErrorInfo.IsArc_After_NonOpen())
     return res;
@@ -3033,6 +3050,11 @@ HRESULT CArc::OpenStreamOrFile(COpenOptions &op)
         }
         if (isOk)
         {
+          if (!fileStreamSpec)
+          {
+            fileStreamSpec = new CInFileStream;
+            fileStream = fileStreamSpec;
+          }
           if (fileStreamSpec->Open(us2fs(Path)))
           {
             op.stream = fileStream;
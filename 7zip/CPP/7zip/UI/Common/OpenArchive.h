@@ -127,6 +127,8 @@ struct COpenOptions
 
   bool stdInMode;
   UString filePath;
+  // SevenInstall: 'stream' reads all of 'filePath' (e.g. read ahead), so treat it like an opened file
+  bool streamIsFile;
 
   COpenOptions():
       codecs(NULL),
@@ -136,7 +138,8 @@ struct COpenOptions
       seqStream(NULL),
       callback(NULL),
       callbackSpec(NULL),
-      stdInMode(false)
+      stdInMode(false),
+      streamIsFile(false)
     {}
 
 };
@@ -0,0 +1,48 @@
+// Common/IoPolicy.cpp
+
+#include "StdAfx.h"
+
+#include "IoPolicy.h"
+
+CIoPolicy g_IoPolicy;
+
+static const UInt32 kBufSizeMin = 1 << 16;
+static const UInt32 kBufSizeMax = 1 << 26;
+
+// ReadFile()/WriteFile() on network files fail with 64 MB or more,
+// and some Windows versions have problems with 32 MB (maybe also 16 MB)
+static const UInt32 kFileChunkSizeMax = 1 << 22;
+
+CIoPolicy::CIoPolicy():
+    SequentialScan(true),
+    ReadAheadDepth(0),
+    MapStoredData(true),
+    PreAllocate(
+      #ifdef _WIN32
+        true
+      #else
+        false
+      #endif
+      ),
+    PreAllocateMinSize(1 << 12),
+    OverwriteInPlace(true),
+    SparseOutput(false),
+    MapOutputMinSize(0)
+{
+  SetBufSize(1 << 20);
+}
+
+void CIoPolicy::SetBufSize(UInt32 size)
+{
+  if (size < kBufSizeMin)
+    size = kBufSizeMin;
+  if (size > kBufSizeMax)
+    size = kBufSizeMax;
+  CoderBufSize = size;
+  CopyBufSize = size / 8;
+  if (CopyBufSize < kBufSizeMin)
+    CopyBufSize = kBufSizeMin;
+  FileChunkSizeMax = size * 4;
+  if (FileChunkSizeMax > kFileChunkSizeMax)
+    FileChunkSizeMax = kFileChunkSizeMax;
+}
@@ -0,0 +1,42 @@
+// Common/IoPolicy.h
+// SevenInstall: buffer sizes and access hints used by coders and file streams
+
+#ifndef __COMMON_IO_POLICY_H
+#define __COMMON_IO_POLICY_H
+
+#include "MyTypes.h"
+
+struct CIoPolicy
+{
+  // LZMA/LZMA2 input buffer and output step, filter buffer, PPMd output buffer
+  UInt32 CoderBufSize;
+  // Buffer of the copy coder (stored items)
+  UInt32 CopyBufSize;
+  // Maximum size of a single ReadFile()/WriteFile() call
+  UInt32 FileChunkSizeMax;
+  // Open archives with FILE_FLAG_SEQUENTIAL_SCAN
+  bool SequentialScan;
+  // Number of CoderBufSize blocks of archive data to read ahead on a background thread; 0 to not read ahead
+  UInt32 ReadAheadDepth;
+  // Write stored (Copy method) data from a mapping of the archive
+  bool MapStoredData;
+  // Set the length of output files before writing
+  bool PreAllocate;
+  // Files up to this size are not preallocated
+  UInt64 PreAllocateMinSize;
+  // Truncate and rewrite existing output files instead of deleting them first
+  bool OverwriteInPlace;
+  // Leave runs of zeros in output files as holes (sparse files)
+  bool SparseOutput;
+  // Write output files of at least this size through a file mapping; 0 to never map
+  UInt64 MapOutputMinSize;
+
+  CIoPolicy();
+
+  // Derive all buffer sizes from one base size
+  void SetBufSize(UInt32 size);
+};
+
+extern CIoPolicy g_IoPolicy;
+
+#endif
@@ -6,6 +6,8 @@
 #include "../../C/Alloc.h"
 #endif
 
+#include "../Common/IoPolicy.h"
+
 #include "FileIO.h"
 #include "FileName.h"
 
@@ -330,7 +332,8 @@ bool CInFile::Open(CFSTR fileName)
 // for 32 MB (maybe also for 16 MB).
 // And message can be "Network connection was lost"
 
-static UInt32 kChunkSizeMax = (1 << 22);
+// SevenInstall: chunk size is taken from the I/O policy (default: 4 MB)
+#define kChunkSizeMax (g_IoPolicy.FileChunkSizeMax)
 
 bool CInFile::Read1(void *data, UInt32 size, UInt32 &processedSize) throw()
 {
@@ -383,6 +386,9 @@ bool COutFile::Create(CFSTR fileName, bool createAlways)
 bool COutFile::CreateAlways(CFSTR fileName, DWORD flagsAndAttributes)
   { return Open(fileName, FILE_SHARE_READ, GetCreationDisposition(true), flagsAndAttributes); }
 
+bool COutFile::OpenReadWrite(CFSTR fileName, DWORD creationDisposition)
+  { return CFileBase::Create(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, creationDisposition, FILE_ATTRIBUTE_NORMAL); }
+
 bool COutFile::SetTime(const FILETIME *cTime, const FILETIME *aTime, const FILETIME *mTime) throw()
   { return BOOLToBool(::SetFileTime(_handle, cTime, aTime, mTime)); }
 
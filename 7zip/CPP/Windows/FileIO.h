@@ -93,6 +93,9 @@ public:
     return DeviceIoControlOut(controlCode, outBuffer, outSize, &bytesReturned);
   }
 
+  // SevenInstall
+  HANDLE GetHandle() const { return _handle; }
+
 public:
   #ifdef SUPPORT_DEVICE_FILE
   bool IsDeviceFile;
@@ -198,6 +201,8 @@ public:
   bool Open(CFSTR fileName, DWORD creationDisposition);
   bool Create(CFSTR fileName, bool createAlways);
   bool CreateAlways(CFSTR fileName, DWORD flagsAndAttributes);
+  // SevenInstall: with read access as well, as needed for a writable file mapping
+  bool OpenReadWrite(CFSTR fileName, DWORD creationDisposition);
 
   bool SetTime(const FILETIME *cTime, const FILETIME *aTime, const FILETIME *mTime) throw();
   bool SetMTime(const FILETIME *mTime) throw();
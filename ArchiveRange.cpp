@@ -0,0 +1,90 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "ArchiveRange.hpp"
+
+#include <wchar.h>
+
+#include <Windows.h>
+
+// Parse a decimal or "0x" prefixed hexadecimal number, which must end at 'end'
+static bool ParseNumber (const wchar_t* str, const wchar_t* end, uint64_t& value)
+{
+  unsigned base = 10;
+  if ((end - str > 2) && (str[0] == '0') && ((str[1] == 'x') || (str[1] == 'X')))
+  {
+    base = 16;
+    str += 2;
+  }
+  if (str == end) return false;
+
+  value = 0;
+  for (; str < end; str++)
+  {
+    unsigned digit;
+    if ((*str >= '0') && (*str <= '9'))
+      digit = *str - '0';
+    else if ((base == 16) && (*str >= 'a') && (*str <= 'f'))
+      digit = *str - 'a' + 10;
+    else if ((base == 16) && (*str >= 'A') && (*str <= 'F'))
+      digit = *str - 'A' + 10;
+    else
+      return false;
+    if (value > (UINT64_MAX - digit) / base) return false;
+    value = value * base + digit;
+  }
+  return true;
+}
+
+ArchiveRange ParseArchiveArg (const wchar_t* arg)
+{
+  ArchiveRange range;
+  range.path = arg;
+
+  // '@' is valid in file names, so existing files take precedence
+  if (GetFileAttributesW (arg) != INVALID_FILE_ATTRIBUTES) return range;
+
+  const wchar_t* at = wcsrchr (arg, '@');
+  if (!at || (at == arg)) return range;
+  const wchar_t* colon = wcschr (at, ':');
+  if (!colon) return range;
+  const wchar_t* end = colon + wcslen (colon);
+
+  uint64_t offset, length;
+  if (!ParseNumber (at + 1, colon, offset) || !ParseNumber (colon + 1, end, length))
+    return range;
+  if ((length == 0) || (offset > UINT64_MAX - length)) return range;
+
+  range.path = MyUString (arg, at - arg);
+  range.isRange = true;
+  range.offset = offset;
+  range.length = length;
+  return range;
+}
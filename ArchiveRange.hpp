@@ -0,0 +1,66 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Archive arguments designating a byte range of a file
+ */
+#ifndef SEVENI_ARCHIVERANGE_HPP_
+#define SEVENI_ARCHIVERANGE_HPP_
+
+#include "MyUString.hpp"
+
+#include <stdint.h>
+
+/**
+ * An archive argument, split into file path and byte range.
+ * Archives embedded in a larger file (e.g. a bootstrapper executable) are
+ * given as <tt>&lt;file&gt;\@&lt;offset&gt;:&lt;length&gt;</tt>, so they can
+ * be read in place. Offset and length are decimal, or hexadecimal with a
+ * \c 0x prefix.
+ */
+struct ArchiveRange
+{
+  /// Path of the file containing the archive
+  MyUString path;
+  /// Whether only a part of the file is the archive
+  bool isRange = false;
+  /// Start of the archive in the file
+  uint64_t offset = 0;
+  /// Size of the archive
+  uint64_t length = 0;
+};
+
+/**
+ * Split an archive argument. Arguments naming an existing file, or without
+ * a valid range suffix, are plain paths.
+ */
+ArchiveRange ParseArchiveArg (const wchar_t* arg);
+
+#endif // SEVENI_ARCHIVERANGE_HPP_
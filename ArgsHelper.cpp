@@ -42,7 +42,8 @@ ArgsHelper::ArgsHelper (int argc, const wchar_t* const argv[])
     for (int a = 1; a < argc; a++)
     {
         const wchar_t* arg (argv[a]);
-        if (arg[0] == '-')
+        // A lone "-" stands for standard input
+        if ((arg[0] == '-') && (arg[1] != 0))
         {
             if (_wcsnicmp (arg+1, arg_burn_filehandle, wcslen (arg_burn_filehandle)) == 0)
             {
@@ -59,8 +60,12 @@ ArgsHelper::ArgsHelper (int argc, const wchar_t* const argv[])
             }
             else if (arg[1] == '-')
             {
-                // --long option - no value
-                options[arg] = nullptr;
+                // --long option - optional value, separated by '='
+                auto sep = wcschr (arg + 2, '=');
+                if (sep)
+                    options[MyUString (arg, sep - arg)] = sep + 1;
+                else
+                    options[arg] = nullptr;
             }
             else
             {
@@ -0,0 +1,300 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "ContentStore.hpp"
+
+#include "ArgsHelper.hpp"
+#include "Error.hpp"
+#include "Paths.hpp"
+#include "ProgressReporter.hpp"
+
+#include "7zCrc.h"
+#include "Sha256.h"
+
+#include "Windows/FileDir.h"
+
+#include <algorithm>
+#include <memory>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Windows.h>
+
+// Files smaller than this are not worth a link (they may fit into the MFT record anyway)
+static const uint64_t minStoredSize = 4096;
+// Buffer used to hash file contents
+static const size_t hashBufferSize = 1 << 20;
+
+bool ContentStore::Init (const ArgsHelper& args, const InstallLogLocation& logLocation)
+{
+  const wchar_t* storeArg = nullptr;
+  enabled = args.GetOption (L"--dedup", storeArg);
+  if (enabled && storeArg && (*storeArg == 0))
+  {
+    fprintf (stderr, "Invalid value for --dedup: expected a directory\n");
+    return false;
+  }
+
+  if (storeArg)
+  {
+    storeDir = storeArg;
+    // Strip trailing separators, we append our own
+    while ((storeDir.Len() > 1) && (storeDir.Ptr()[storeDir.Len() - 1] == '\\'))
+      storeDir.DeleteFrom (storeDir.Len() - 1);
+  }
+  else
+  {
+    storeDir = logLocation.GetLogsPath();
+    storeDir += L"\\store";
+  }
+  return true;
+}
+
+void ContentStore::AddFiles (ProgressReporter& progress, const std::vector<MyUString>& files)
+{
+  if (!NWindows::NFile::NDir::CreateComplexDir (storeDir.Ptr()))
+  {
+    fprintf (stderr, "Error creating content store %ls: %ls\n", storeDir.Ptr(),
+             GetErrorString (GetLastError ()).Ptr ());
+    return;
+  }
+
+  progress.SetTotal (files.size ());
+  size_t n = 0;
+  for (const auto& file : files)
+  {
+    uint64_t size = 0;
+    switch (AddFile (file, size))
+    {
+    case AddResult::Skipped:
+      break;
+    case AddResult::Added:
+      ++numAdded;
+      break;
+    case AddResult::Linked:
+      ++numLinked;
+      savedBytes += size;
+      break;
+    }
+    if (progress.SetCompleted (++n) == ProgressReporter::Processing::Cancel)
+      break;
+  }
+
+  printf ("Content store: %zu file(s) linked to existing content (%llu MiB saved), %zu added\n",
+          numLinked, savedBytes >> 20, numAdded);
+}
+
+static void AppendHex (MyUString& str, const uint8_t* data, size_t size)
+{
+  static const wchar_t hexDigits[] = L"0123456789abcdef";
+  wchar_t digits[3] = {};
+  for (size_t i = 0; i < size; i++)
+  {
+    digits[0] = hexDigits[data[i] >> 4];
+    digits[1] = hexDigits[data[i] & 0xf];
+    str += digits;
+  }
+}
+
+// Hash \a size bytes of a file: CRC32 for the key, SHA-256 to tell apart contents with the same key
+static bool HashContent (HANDLE file, uint64_t size, Byte* buffer, UInt32& crc, Byte (&digest)[SHA256_DIGEST_SIZE])
+{
+  crc = CRC_INIT_VAL;
+  CSha256 sha;
+  Sha256_Init (&sha);
+  uint64_t remaining = size;
+  while (remaining > 0)
+  {
+    DWORD bytesRead = 0;
+    if (!ReadFile (file, buffer, static_cast<DWORD> (hashBufferSize), &bytesRead, nullptr) || (bytesRead == 0))
+      break;
+    crc = CrcUpdate (crc, buffer, bytesRead);
+    Sha256_Update (&sha, buffer, bytesRead);
+    remaining -= std::min<uint64_t> (remaining, bytesRead);
+  }
+  if (remaining > 0) return false;
+  crc = CRC_GET_DIGEST (crc);
+  Sha256_Final (&sha, digest);
+  return true;
+}
+
+/* Check that a stored content still matches its key. Entries are shared by
+ * all linked installations, so a product modifying its "own" copy changes
+ * the entry for everyone. */
+static bool VerifyEntry (const MyUString& entry, uint64_t size, UInt32 crc, const Byte (&digest)[SHA256_DIGEST_SIZE], Byte* buffer)
+{
+  HANDLE file = CreateFileW (entry.Ptr(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER entrySize;
+  UInt32 entryCrc = 0;
+  Byte entryDigest[SHA256_DIGEST_SIZE];
+  bool match = GetFileSizeEx (file, &entrySize)
+               && (static_cast<uint64_t> (entrySize.QuadPart) == size)
+               && HashContent (file, size, buffer, entryCrc, entryDigest)
+               && (entryCrc == crc)
+               && (memcmp (entryDigest, digest, sizeof (digest)) == 0);
+  CloseHandle (file);
+  return match;
+}
+
+ContentStore::AddResult ContentStore::AddFile (const MyUString& path, uint64_t& size)
+{
+  HANDLE file = CreateFileW (path.Ptr(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return AddResult::Skipped;
+
+  BY_HANDLE_FILE_INFORMATION info;
+  if (!GetFileInformationByHandle (file, &info)
+      || ((info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+      || (info.nNumberOfLinks > 1))
+  {
+    // Directory, or already linked to somewhere
+    CloseHandle (file);
+    return AddResult::Skipped;
+  }
+  size = (static_cast<uint64_t> (info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+  if (size < minStoredSize)
+  {
+    CloseHandle (file);
+    return AddResult::Skipped;
+  }
+
+  std::unique_ptr<Byte[]> buffer (new Byte[hashBufferSize]);
+  UInt32 crc = 0;
+  Byte digest[SHA256_DIGEST_SIZE];
+  bool hashed = HashContent (file, size, buffer.get(), crc, digest);
+  CloseHandle (file);
+  if (!hashed) return AddResult::Skipped;
+
+  // Layout: <store>\<size>-<crc>\<sha256>
+  wchar_t keyName[32];
+  _snwprintf_s (keyName, _TRUNCATE, L"\\%016llx-%08x\\", size, crc);
+  MyUString entry (storeDir);
+  entry += keyName;
+  MyUString keyDir (entry);
+  AppendHex (entry, digest, sizeof (digest));
+
+  if (GetFileAttributesW (entry.Ptr()) != INVALID_FILE_ATTRIBUTES)
+  {
+    if (VerifyEntry (entry, size, crc, digest, buffer.get()))
+      return ReplaceByLink (path, entry) ? AddResult::Linked : AddResult::Skipped;
+    /* Modified through one of its links: drop it from the store and store
+     * this file instead. Installations linked to it keep their copy. */
+    fprintf (stderr, "Content store entry %ls does not match its content anymore, replacing it\n", entry.Ptr());
+    /* A read-only entry is left alone: clearing the attribute would clear
+     * it for every linked installation as well. */
+    if (!DeleteFileW (entry.Ptr())) return AddResult::Skipped;
+  }
+
+  // New content: the extracted file becomes the stored copy
+  CreateDirectoryW (keyDir.Ptr(), nullptr);
+  if (CreateHardLinkW (entry.Ptr(), path.Ptr(), nullptr)) return AddResult::Added;
+  // Another installer may have stored the same content concurrently
+  if ((GetLastError () == ERROR_ALREADY_EXISTS) && VerifyEntry (entry, size, crc, digest, buffer.get()))
+    return ReplaceByLink (path, entry) ? AddResult::Linked : AddResult::Skipped;
+  return AddResult::Skipped;
+}
+
+bool ContentStore::ReplaceByLink (const MyUString& path, const MyUString& entry)
+{
+  // Link next to the file first, then replace, so the file is never missing
+  MyUString tempPath (path);
+  tempPath += L".7i-link";
+  if (!CreateHardLinkW (tempPath.Ptr(), entry.Ptr(), nullptr)) return false;
+
+  DWORD fileAttr (GetFileAttributesW (path.Ptr()));
+  if ((fileAttr != INVALID_FILE_ATTRIBUTES) && ((fileAttr & FILE_ATTRIBUTE_READONLY) != 0))
+    SetFileAttributesW (path.Ptr(), fileAttr & ~FILE_ATTRIBUTE_READONLY);
+  if (!MoveFileExW (tempPath.Ptr(), path.Ptr(), MOVEFILE_REPLACE_EXISTING))
+  {
+    DeleteFileW (tempPath.Ptr());
+    return false;
+  }
+  return true;
+}
+
+void ContentStore::Prune (ProgressReporter& progress)
+{
+  MyUString wildcard (storeDir);
+  wildcard += L"\\*";
+
+  std::vector<MyUString> keyDirs;
+  WIN32_FIND_DATAW findData;
+  HANDLE findHandle = FindFirstFileExW (wildcard.Ptr(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+  if (findHandle == INVALID_HANDLE_VALUE) return;
+  do
+  {
+    if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) continue;
+    if ((wcscmp (findData.cFileName, L".") == 0) || (wcscmp (findData.cFileName, L"..") == 0)) continue;
+    keyDirs.emplace_back (storeDir + L"\\" + findData.cFileName);
+  } while (FindNextFileW (findHandle, &findData));
+  FindClose (findHandle);
+
+  progress.SetTotal (keyDirs.size ());
+  size_t n = 0;
+  size_t numPruned = 0;
+  for (const auto& keyDir : keyDirs)
+  {
+    wildcard = keyDir;
+    wildcard += L"\\*";
+    findHandle = FindFirstFileExW (wildcard.Ptr(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, 0);
+    if (findHandle != INVALID_HANDLE_VALUE)
+    {
+      do
+      {
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) continue;
+        MyUString entry (keyDir + L"\\" + findData.cFileName);
+        HANDLE file = CreateFileW (entry.Ptr(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                   nullptr, OPEN_EXISTING, 0, nullptr);
+        if (file == INVALID_HANDLE_VALUE) continue;
+        BY_HANDLE_FILE_INFORMATION info;
+        bool unreferenced = GetFileInformationByHandle (file, &info) && (info.nNumberOfLinks <= 1);
+        CloseHandle (file);
+        if (!unreferenced) continue;
+
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_READONLY) != 0)
+          SetFileAttributesW (entry.Ptr(), findData.dwFileAttributes & ~FILE_ATTRIBUTE_READONLY);
+        if (DeleteFileW (entry.Ptr()))
+          ++numPruned;
+        else
+          fprintf (stderr, "Error deleting %ls: %ls\n", entry.Ptr(), GetErrorString (GetLastError ()).Ptr ());
+      } while (FindNextFileW (findHandle, &findData));
+      FindClose (findHandle);
+    }
+    // Fails if there are still contents left, which is fine
+    RemoveDirectoryW (keyDir.Ptr());
+    progress.SetCompleted (++n);
+  }
+
+  if (numPruned > 0)
+    printf ("Content store: %zu unreferenced content(s) removed\n", numPruned);
+}
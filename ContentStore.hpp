@@ -0,0 +1,88 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Content-addressed store for deduplicating installed files
+ */
+#ifndef SEVENI_CONTENTSTORE_HPP_
+#define SEVENI_CONTENTSTORE_HPP_
+
+#include "MyUString.hpp"
+
+#include <stdint.h>
+
+#include <vector>
+
+class ArgsHelper;
+class InstallLogLocation;
+struct ProgressReporter;
+
+/**
+ * Store of installed file contents, shared by all products.
+ * Each distinct content is kept once, keyed by size and CRC32, with a SHA-256
+ * hash confirming a match. With \c --dedup[=<dir>], extracted files are
+ * replaced by hard links to the stored copy. The file system's link count
+ * doubles as the content reference count: removing an installed file drops
+ * a reference, Prune() deletes contents no installation links to anymore.
+ * Stored contents are checked against their key again before another file
+ * is linked to them, as an installation may have modified its linked copy.
+ */
+class ContentStore
+{
+public:
+  /// Parse store options. Prints a message and returns false if an option is invalid.
+  bool Init (const ArgsHelper& args, const InstallLogLocation& logLocation);
+
+  /// Whether extracted files should be added to the store
+  bool IsEnabled () const { return enabled; }
+
+  /**
+   * Add extracted files to the store, replacing them by links to the stored
+   * copy if the content is already present. Files that can't be linked (other
+   * volume, file system without hard links, file in use) are left alone.
+   */
+  void AddFiles (ProgressReporter& progress, const std::vector<MyUString>& files);
+  /// Delete stored contents which are not linked from any installation anymore
+  void Prune (ProgressReporter& progress);
+private:
+  MyUString storeDir;
+  bool enabled = false;
+
+  /// Statistics for the summary message
+  size_t numLinked = 0;
+  size_t numAdded = 0;
+  uint64_t savedBytes = 0;
+
+  enum struct AddResult { Skipped, Added, Linked };
+  AddResult AddFile (const MyUString& path, uint64_t& size);
+  static bool ReplaceByLink (const MyUString& path, const MyUString& entry);
+};
+
+#endif // SEVENI_CONTENTSTORE_HPP_
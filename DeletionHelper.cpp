@@ -30,6 +30,8 @@
 
 #include "DeletionHelper.hpp"
 
+#include "Trace.hpp"
+
 DeletionHelper::DeletionHelper(const ArgsHelper& args)
 {
   const wchar_t* inuseOptions = nullptr;
@@ -61,6 +63,7 @@ DWORD DeletionHelper::FileDelete(const wchar_t* file)
 
 DWORD DeletionHelper::FileDelete(DWORD fileAttr, const wchar_t* file)
 {
+  TraceDeletionScope traceDeletion;
   if ((fileAttr & FILE_ATTRIBUTE_READONLY) != 0) {
     SetFileAttributesW(file, fileAttr & ~FILE_ATTRIBUTE_READONLY);
     // Ignore errors, assume DeleteFile() will fail anyway
@@ -80,6 +83,7 @@ DWORD DeletionHelper::FileDelete(DWORD fileAttr, const wchar_t* file)
 
 DWORD DeletionHelper::DirDelete(const wchar_t* path)
 {
+  TraceDeletionScope traceDeletion;
   DWORD result = ERROR_SUCCESS;
   bool needDelay = false;
   if (delayDirs.find(path) != delayDirs.end()) {
@@ -42,6 +42,7 @@ enum
 
     ecArgsError = __HRESULT_FROM_WIN32(ERROR_BAD_ARGUMENTS),
     ecHasDependencies = __HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED),
+    ecVerifyFailed = __HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT),
     ecException = E_FAIL
 };
 
@@ -9,7 +9,11 @@
 #include "Windows/FileName.h"
 #include "Windows/PropVariant.h"
 
+#include "Common/IoPolicy.h"
+
 #include "7zip/ICoder.h"
+#include "7zip/Common/FileStreams.h"
+#include "7zip/Common/LimitedStreams.h"
 #include "7zip/UI/Common/ExitCode.h"
 #include "7zip/UI/Common/Extract.h"
 #include "7zip/UI/Common/ExtractingFilePath.h"
@@ -21,10 +25,26 @@
 #include "7zip/MyVersion.h"
 
 #include <iostream>
+#include <vector>
 
+#include "ArchiveRange.hpp"
 #include "Error.hpp"
+#include "ExtractCache.hpp"
 #include "ExtractCallback.hpp"
+#include "ExtractJournal.hpp"
+#include "IsSFX.hpp"
+#include "Manifest.hpp"
 #include "OpenCallback.hpp"
+#include "Patch.hpp"
+#include "PatchApply.hpp"
+#include "Paths.hpp"
+#include "PathSet.hpp"
+#include "PreviousInstall.hpp"
+#include "ProgressReporter.hpp"
+#include "ReadAheadStream.hpp"
+#include "ResourceGovernor.hpp"
+#include "StreamInput.hpp"
+#include "Trace.hpp"
 
 using namespace NWindows;
 using namespace NFile;
@@ -33,6 +53,375 @@ using namespace NCOM;
 
 const char extractCopyright[] = "Based on 7zip " MY_VERSION " : Portions " MY_COPYRIGHT " : " MY_DATE;
 
+// An item to be added to the extracted files cache after extraction
+struct CacheCandidate
+{
+  ExtractCache::Key key;
+  FString path;
+};
+
+/* Get the path an item is extracted to, the same way the extraction callback
+ * determines it. Returns S_FALSE if the item is not a plain file. */
+static HRESULT GetItemFilePath(
+    const CArc &arc,
+    UInt32 index,
+    const FString &outDir,
+    FString &path)
+{
+  CReadArcItem item;
+  RINOK(arc.GetItem(index, item));
+  bool isAnti = false;
+  RINOK(arc.IsItemAnti(index, isAnti));
+  if (item.MainIsDir || isAnti)
+    return S_FALSE;
+  #ifdef SUPPORT_ALT_STREAMS
+  if (item.IsAltStream)
+    return S_FALSE;
+  #endif
+
+  UStringVector pathParts (item.PathParts);
+  Correct_FsPath(false, false, pathParts, false);
+  if (pathParts.IsEmpty())
+    return S_FALSE;
+  path = outDir + us2fs(MakePathFromParts(pathParts));
+  return S_OK;
+}
+
+/* Skip items an interrupted earlier attempt has extracted, if the files
+ * still match size, modification time and CRC from the archive. A file is
+ * journaled when it is closed, not when its data reached the disk, and
+ * preallocated files have their final size from the start: after a crash,
+ * only the CRC tells a complete file from a truncated or zero-filled one. */
+static HRESULT ResumeFromJournal(
+    const CArc &arc,
+    const ExtractJournal &journal,
+    const ResourceGovernor &governor,
+    const FString &outDir,
+    CExtractCallback *callback,
+    CRecordVector<UInt32> &indices)
+{
+  PathNormalizer normalizer;
+  CRecordVector<UInt32> remaining;
+  std::vector<MyUString> toHash;
+  std::vector<UInt32> toHashCrc;
+  CRecordVector<UInt32> toHashIndices;
+
+  FOR_VECTOR (i, indices)
+  {
+    UInt32 index = indices[i];
+    remaining.Add(index);
+
+    FString path;
+    HRESULT res = GetItemFilePath(arc, index, outDir, path);
+    RINOK(res);
+    if (res != S_OK)
+      continue;
+    MyUString filename (fs2us(path));
+    normalizer.Normalize (filename);
+    if (!journal.WasExtracted(filename))
+      continue;
+
+    UInt64 size = 0;
+    bool sizeDefined = false;
+    RINOK(arc.GetItemSize(index, size, sizeDefined));
+    FILETIME mTime;
+    bool mTimeDefined = false;
+    RINOK(arc.GetItemMTime(index, mTime, mTimeDefined));
+    CPropVariant crcProp;
+    RINOK(arc.Archive->GetProperty(index, kpidCRC, &crcProp));
+    NFind::CFileInfo fi;
+    if (!fi.Find(path) || fi.IsDir() || !sizeDefined || (fi.Size != size)
+        || (mTimeDefined && (CompareFileTime(&fi.MTime, &mTime) != 0))
+        || (crcProp.vt != VT_UI4))
+      continue;
+
+    remaining.DeleteBack();
+    toHash.emplace_back (std::move (filename));
+    toHashCrc.push_back (crcProp.ulVal);
+    toHashIndices.Add(index);
+  }
+
+  unsigned numResumed = 0;
+  if (!toHash.empty ())
+  {
+    ProgressReporterDummy progress;
+    auto hashes = HashFiles (toHash, governor, progress);
+    for (size_t h = 0; h < hashes.size (); h++)
+    {
+      const auto& hash = hashes[h];
+      if ((hash.error != ERROR_SUCCESS) || hash.isDir || (hash.crc != toHashCrc[h]))
+      {
+        // Incomplete: extract again
+        remaining.Add(toHashIndices[h]);
+        continue;
+      }
+      callback->extractedFiles.emplace_back (std::move (toHash[h]));
+      numResumed++;
+    }
+    // Extraction expects ascending indices
+    remaining.Sort2();
+  }
+
+  if (numResumed > 0)
+    printf("Skipped %u file(s) extracted by an earlier attempt\n", numResumed);
+  indices = remaining;
+  return S_OK;
+}
+
+/* Apply patch items to the installed files. Patch items, and full items of
+ * files that were patched, are removed from indices; the full items of the
+ * other files are the fallback for patches that did not apply. */
+static HRESULT ApplyPatchItems(
+    const CArc &arc,
+    const FString &outDir,
+    CExtractCallback *callback,
+    CRecordVector<UInt32> &indices)
+{
+  PathNormalizer normalizer;
+  IInArchive *archive = arc.Archive;
+  CRecordVector<UInt32> remaining;
+  CRecordVector<UInt32> patchIndices;
+  std::vector<FString> patchTargets;
+
+  FOR_VECTOR (i, indices)
+  {
+    UInt32 index = indices[i];
+    CReadArcItem item;
+    RINOK(arc.GetItem(index, item));
+    if (item.PathParts.IsEmpty() || !item.PathParts[0].IsEqualTo_NoCase(patchItemDir))
+    {
+      remaining.Add(index);
+      continue;
+    }
+    // The patch directory itself is not extracted either
+    if (item.MainIsDir || (item.PathParts.Size() < 2))
+      continue;
+    UStringVector pathParts (item.PathParts);
+    pathParts.Delete(0);
+    Correct_FsPath(false, false, pathParts, false);
+    if (pathParts.IsEmpty())
+      continue;
+    patchIndices.Add(index);
+    patchTargets.push_back(outDir + us2fs(MakePathFromParts(pathParts)));
+  }
+  indices = remaining;
+  if (patchIndices.Size() == 0)
+    return S_OK;
+
+  std::vector<PatchResult> results;
+  RINOK(ApplyPatches(archive, patchIndices, patchTargets, callback, results));
+
+  PathSet patched;
+  PathSet unpatched;
+  unsigned numPatched = 0;
+  for (size_t p = 0; p < results.size(); p++)
+  {
+    MyUString filename (fs2us(patchTargets[p]));
+    normalizer.Normalize (filename);
+    if ((results[p] != PatchResult::Applied) && (results[p] != PatchResult::UpToDate))
+    {
+      unpatched.Insert (filename);
+      continue;
+    }
+
+    // Apply metadata from the archive, as extraction would
+    UInt32 index = patchIndices[p];
+    FILETIME mTime;
+    bool mTimeDefined = false;
+    if ((arc.GetItemMTime(index, mTime, mTimeDefined) == S_OK) && mTimeDefined)
+      SetDirTime(patchTargets[p], NULL, NULL, &mTime);
+    CPropVariant attribProp;
+    if ((archive->GetProperty(index, kpidAttrib, &attribProp) == S_OK) && (attribProp.vt == VT_UI4))
+      SetFileAttrib_PosixHighDetect(patchTargets[p], attribProp.ulVal);
+
+    if (callback->journal) callback->journal->AddFile (filename);
+    patched.Insert (filename);
+    callback->extractedFiles.emplace_back (std::move (filename));
+    numPatched++;
+  }
+
+  remaining.Clear();
+  FOR_VECTOR (i, indices)
+  {
+    UInt32 index = indices[i];
+    FString path;
+    HRESULT res = GetItemFilePath(arc, index, outDir, path);
+    RINOK(res);
+    if (res == S_OK)
+    {
+      MyUString filename (fs2us(path));
+      normalizer.Normalize (filename);
+      if (patched.Contains (filename))
+        continue;
+      unpatched.Erase (filename);
+    }
+    remaining.Add(index);
+  }
+  indices = remaining;
+
+  if (numPatched > 0)
+    printf("Patched %u file(s)\n", numPatched);
+  // Left: patches that did not apply, without a full item to fall back to
+  HRESULT result = S_OK;
+  unpatched.ForEach ([&](const MyUString& path)
+  {
+    UString message (L"No full item to replace the failed patch with: ");
+    message += path.Ptr();
+    if (result == S_OK)
+      result = callback->MessageError (message);
+  });
+  return result;
+}
+
+/* Skip items that would replace a file of the installation being upgraded
+ * with the same contents, going by size and CRC. */
+static HRESULT KeepUnchanged(
+    const CArc &arc,
+    PreviousInstall &previousInstall,
+    const FString &outDir,
+    CExtractCallback *callback,
+    CRecordVector<UInt32> &indices)
+{
+  PathNormalizer normalizer;
+  IInArchive *archive = arc.Archive;
+  std::vector<PreviousInstall::Candidate> candidates;
+  CRecordVector<unsigned> candidatePos;
+
+  FOR_VECTOR (i, indices)
+  {
+    UInt32 index = indices[i];
+    FString path;
+    HRESULT res = GetItemFilePath(arc, index, outDir, path);
+    RINOK(res);
+    if (res != S_OK)
+      continue;
+    UInt64 size = 0;
+    bool sizeDefined = false;
+    RINOK(arc.GetItemSize(index, size, sizeDefined));
+    CPropVariant crcProp;
+    RINOK(archive->GetProperty(index, kpidCRC, &crcProp));
+    if (!sizeDefined || (crcProp.vt != VT_UI4))
+      continue;
+
+    PreviousInstall::Candidate candidate;
+    candidate.path = fs2us(path);
+    normalizer.Normalize (candidate.path);
+    candidate.size = size;
+    candidate.crc = crcProp.ulVal;
+    candidates.emplace_back (std::move (candidate));
+    candidatePos.Add(i);
+  }
+  if (candidates.empty())
+    return S_OK;
+
+  std::vector<bool> unchanged;
+  try
+  {
+    unchanged = previousInstall.Match(candidates);
+  }
+  catch (const HRESULTException& e)
+  {
+    return e.GetHR();
+  }
+
+  CRecordVector<UInt32> remaining;
+  unsigned numKept = 0;
+  UInt64 keptSize = 0;
+  unsigned c = 0;
+  FOR_VECTOR (i, indices)
+  {
+    if ((c < candidatePos.Size()) && (candidatePos[c] == i))
+    {
+      unsigned candidateIndex = c++;
+      if (unchanged[candidateIndex])
+      {
+        auto& filename = candidates[candidateIndex].path;
+        if (callback->journal) callback->journal->AddFile (filename);
+        keptSize += candidates[candidateIndex].size;
+        callback->extractedFiles.emplace_back (std::move (filename));
+        numKept++;
+        continue;
+      }
+    }
+    remaining.Add(indices[i]);
+  }
+
+  if (numKept > 0)
+    printf("Kept %u unchanged file(s) (%llu MiB)\n", numKept, keptSize >> 20);
+  indices = remaining;
+  return S_OK;
+}
+
+/* Restore items that are in the cache, remove them from indices.
+ * Items that may be cached but are not are returned in toCache. */
+static HRESULT RestoreFromCache(
+    const CArc &arc,
+    ExtractCache &cache,
+    const FString &outDir,
+    CExtractCallback *callback,
+    CRecordVector<UInt32> &indices,
+    std::vector<CacheCandidate> &toCache)
+{
+  PathNormalizer normalizer;
+  IInArchive *archive = arc.Archive;
+  CRecordVector<UInt32> remaining;
+  unsigned numRestored = 0;
+  UInt64 restoredSize = 0;
+
+  FOR_VECTOR (i, indices)
+  {
+    UInt32 index = indices[i];
+    remaining.Add(index);
+
+    CacheCandidate candidate;
+    HRESULT res = GetItemFilePath(arc, index, outDir, candidate.path);
+    RINOK(res);
+    if (res != S_OK)
+      continue;
+    UInt64 size = 0;
+    bool sizeDefined = false;
+    RINOK(arc.GetItemSize(index, size, sizeDefined));
+    CPropVariant crcProp;
+    RINOK(archive->GetProperty(index, kpidCRC, &crcProp));
+    // Empty files are not worth it, they don't need decoding anyway
+    if (!sizeDefined || (size == 0) || (crcProp.vt != VT_UI4))
+      continue;
+    candidate.key.size = size;
+    candidate.key.crc = crcProp.ulVal;
+
+    int pathSep = candidate.path.ReverseFind_PathSepar();
+    if (pathSep > 0)
+      CreateComplexDir(candidate.path.Left(pathSep));
+    if (!cache.Restore(candidate.key, candidate.path))
+    {
+      toCache.emplace_back(std::move(candidate));
+      continue;
+    }
+
+    // Apply metadata from the archive, as extraction would
+    FILETIME mTime;
+    bool mTimeDefined = false;
+    if ((arc.GetItemMTime(index, mTime, mTimeDefined) == S_OK) && mTimeDefined)
+      SetDirTime(candidate.path, NULL, NULL, &mTime);
+    CPropVariant attribProp;
+    if ((archive->GetProperty(index, kpidAttrib, &attribProp) == S_OK) && (attribProp.vt == VT_UI4))
+      SetFileAttrib_PosixHighDetect(candidate.path, attribProp.ulVal);
+
+    MyUString filename (fs2us(candidate.path));
+    normalizer.Normalize (filename);
+    if (callback->journal) callback->journal->AddFile (filename);
+    callback->extractedFiles.emplace_back (std::move (filename));
+    remaining.DeleteBack();
+    numRestored++;
+    restoredSize += size;
+  }
+
+  if (numRestored > 0)
+    printf("Restored %u file(s) (%llu MiB) from cache\n", numRestored, restoredSize >> 20);
+  indices = remaining;
+  return S_OK;
+}
+
 static HRESULT DecompressArchive(
     CCodecs *codecs,
     const CArchiveLink &arcLink,
@@ -41,6 +430,9 @@ static HRESULT DecompressArchive(
     bool calcCrc,
     CExtractCallback *callback,
     CArchiveExtractCallback *ecs,
+    bool sequential,
+    ExtractCache *cache,
+    const ResourceGovernor &governor,
     UString &errorMessage)
 {
   const CArc &arc = arcLink.Arcs.Back();
@@ -54,32 +446,36 @@ static HRESULT DecompressArchive(
 
   outDir.Replace(FString("*"), us2fs(Get_Correct_FsFile_Name(replaceName)));
 
-  UInt32 numItems;
-  RINOK(archive->GetNumberOfItems(&numItems));
-
-  #ifdef SUPPORT_ALT_STREAMS
-  CReadArcItem item;
-  #endif
-
-  for (UInt32 i = 0; i < numItems; i++)
+  // Sequential archives don't know their items in advance; all items are extracted
+  if (!sequential)
   {
+    UInt32 numItems;
+    RINOK(archive->GetNumberOfItems(&numItems));
+
     #ifdef SUPPORT_ALT_STREAMS
-    item.IsAltStream = false;
-    if (!options.NtOptions.AltStreams.Val && arc.Ask_AltStream)
-    {
-      RINOK(Archive_IsItem_AltStream(arc.Archive, i, item.IsAltStream));
-    }
-    if (!options.NtOptions.AltStreams.Val && item.IsAltStream)
-      continue;
+    CReadArcItem item;
     #endif
 
-    realIndices.Add(i);
-  }
+    for (UInt32 i = 0; i < numItems; i++)
+    {
+      #ifdef SUPPORT_ALT_STREAMS
+      item.IsAltStream = false;
+      if (!options.NtOptions.AltStreams.Val && arc.Ask_AltStream)
+      {
+        RINOK(Archive_IsItem_AltStream(arc.Archive, i, item.IsAltStream));
+      }
+      if (!options.NtOptions.AltStreams.Val && item.IsAltStream)
+        continue;
+      #endif
 
-  if (realIndices.Size() == 0)
-  {
-    callback->ThereAreNoFiles();
-    return callback->ExtractResult(S_OK);
+      realIndices.Add(i);
+    }
+
+    if (realIndices.Size() == 0)
+    {
+      callback->ThereAreNoFiles();
+      return callback->ExtractResult(S_OK);
+    }
   }
 
   #ifdef _WIN32
@@ -100,6 +496,27 @@ static HRESULT DecompressArchive(
       return res;
     }
 
+  if (callback->journal && callback->journal->IsResuming() && !sequential)
+  {
+    RINOK(ResumeFromJournal(arc, *callback->journal, governor, outDir, callback, realIndices));
+  }
+  if (!sequential)
+  {
+    RINOK(ApplyPatchItems(arc, outDir, callback, realIndices));
+  }
+  if (callback->previousInstall && !sequential)
+  {
+    RINOK(KeepUnchanged(arc, *callback->previousInstall, outDir, callback, realIndices));
+  }
+  std::vector<CacheCandidate> toCache;
+  if (cache && !sequential)
+  {
+    RINOK(RestoreFromCache(arc, *cache, outDir, callback, realIndices, toCache));
+  }
+  // Everything was extracted before, unchanged or cached: no need to touch the archive's data at all
+  if (!sequential && (realIndices.Size() == 0))
+    return callback->ExtractResult(S_OK);
+
   ecs->Init(
       options.NtOptions,
       NULL,
@@ -112,7 +529,7 @@ static HRESULT DecompressArchive(
 
   #ifdef SUPPORT_LINKS
 
-  if (!options.TestMode &&
+  if (!options.TestMode && !sequential &&
       options.NtOptions.HardLinks.Val)
   {
     RINOK(ecs->PrepareHardLinks(&realIndices));
@@ -123,19 +540,37 @@ static HRESULT DecompressArchive(
   HRESULT result;
   Int32 testMode = (options.TestMode && !calcCrc) ? 1: 0;
   CArchiveExtractCallback_Closer ecsCloser(ecs);
-  result = archive->Extract(&realIndices.Front(), realIndices.Size(), testMode, ecs);
+  if (sequential)
+    result = archive->Extract(NULL, (UInt32)(Int32)-1, testMode, ecs);
+  else
+    result = archive->Extract(&realIndices.Front(), realIndices.Size(), testMode, ecs);
   HRESULT res2 = ecsCloser.Close();
   if (result == S_OK)
     result = res2;
 
+  /* Only cache contents of a fully successful extraction, CRCs have been checked then.
+   * With pending renames, some paths still hold the old contents. */
+  if ((result == S_OK) && (callback->NumFileErrors_in_Current == 0) && (ecs->_renamedFiles.Size() == 0))
+  {
+    for (const auto& candidate : toCache)
+      cache->Add(candidate.key, candidate.path);
+  }
+
   // Apply renames requested via MoveFileEx()
   if (!callback->renamesRequested.empty()) {
     for (unsigned int i = 0; i < ecs->_renamedFiles.Size(); i++) {
       const auto& renamePair = ecs->_renamedFiles[i];
-      CPropVariant prop;
-      if (SUCCEEDED(archive->GetProperty(renamePair.Index, kpidPath, &prop))) {
-        UString name;
-        ConvertPropertyToString2(name, prop, kpidPath);
+      UString name;
+      bool haveName = sequential;
+      if (sequential) {
+        // Items of sequential archives can't be revisited
+        name = renamePair.ItemPath;
+      } else {
+        CPropVariant prop;
+        haveName = SUCCEEDED(archive->GetProperty(renamePair.Index, kpidPath, &prop));
+        if (haveName) ConvertPropertyToString2(name, prop, kpidPath);
+      }
+      if (haveName) {
         auto renameReqIt = callback->renamesRequested.find(name);
         if (renameReqIt != callback->renamesRequested.end()) {
           if (!MoveFileExW(fs2us(renamePair.Path).Ptr(), renameReqIt->second, MOVEFILE_DELAY_UNTIL_REBOOT)) {
@@ -165,6 +600,8 @@ static void ExtractOneArchive (
     const CExtractOptions &options,
     IOpenCallbackUI *openCallback,
     CExtractCallback *extractCallback,
+    const ResourceGovernor& governor,
+    ExtractCache *cache,
     #ifndef _SFX
     IHashCalc *hash,
     #endif
@@ -172,14 +609,53 @@ static void ExtractOneArchive (
 {
   UInt64 totalPackSize = 0;
 
+  ArchiveRange range = ParseArchiveArg(arcPath);
+  /* The archive of an SFX with a locator trailer is read as a range, so
+   * opening it doesn't have to search for the signature. */
+  MyUString sfxPath;
+  ArchiveRange sfxRange;
+  if (!range.isRange && IsSFX(sfxPath, &sfxRange) && sfxRange.isRange && (sfxPath == range.path))
+    range = sfxRange;
+
   NFile::NFind::CFileInfo fi;
   fi.Size = 0;
-  const FString &arcPath_f = us2fs(arcPath);
+  const FString &arcPath_f = us2fs(range.path);
   if (!fi.Find(arcPath_f)) THROW_HR(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
   if (fi.IsDir()) THROW_HR(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND/*ERROR_DIRECTORY_NOT_SUPPORTED - doc'ed but not defined*/));
-  totalPackSize = fi.Size;
   UInt64 archiveSize = fi.Size;
 
+  /* Archive embedded in a larger file: read the range in place.
+   * The archive stream is also opened here if it's to be read ahead;
+   * otherwise, opening the archive opens the file. */
+  CMyComPtr<IInStream> inStream;
+  if (range.isRange && ((range.offset > fi.Size) || (range.length > fi.Size - range.offset)))
+  {
+    fprintf(stderr, "%ls: range exceeds the file size (%llu bytes)\n", arcPath.Ptr(), fi.Size);
+    THROW_HR(HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+  }
+  if (range.isRange || (g_IoPolicy.ReadAheadDepth != 0))
+  {
+    CInFileStream *fileStreamSpec = new CInFileStream;
+    CMyComPtr<IInStream> fileStream = fileStreamSpec;
+    bool opened = g_IoPolicy.SequentialScan ?
+        fileStreamSpec->OpenSequential(arcPath_f) :
+        fileStreamSpec->Open(arcPath_f);
+    if (!opened) THROW_HR(HRESULT_FROM_WIN32(GetLastError()));
+    inStream = fileStream;
+    if (g_IoPolicy.ReadAheadDepth != 0)
+      inStream = new ReadAheadInStream(fileStream, g_IoPolicy.ReadAheadDepth, g_IoPolicy.CoderBufSize);
+  }
+  if (range.isRange)
+  {
+    CLimitedInStream *limitedStreamSpec = new CLimitedInStream;
+    CMyComPtr<IInStream> rangeStream = limitedStreamSpec;
+    limitedStreamSpec->SetStream(inStream);
+    CHECK_HR(limitedStreamSpec->InitAndSeek(range.offset, range.length));
+    inStream = rangeStream;
+    archiveSize = range.length;
+  }
+  totalPackSize = archiveSize;
+
   CArchiveExtractCallback *ecs = new CArchiveExtractCallback;
   CMyComPtr<IArchiveExtractCallback> ec(ecs);
   ecs->InitForMulti(false, options.PathMode, options.OverwriteMode, false);
@@ -200,8 +676,10 @@ static void ExtractOneArchive (
   op.types = &types;
   op.excludedFormats = &excludedFormats;
   op.stdInMode = false;
-  op.stream = NULL;
-  op.filePath = arcPath;
+  op.stream = inStream;
+  // A stream that's only read ahead still allows looking for split archives next to an SFX
+  op.streamIsFile = inStream && !range.isRange;
+  op.filePath = range.path;
   HRESULT result = arcLink.Open3(op, openCallback);
   if (result == E_ABORT)
     CHECK_HR(result);
@@ -223,6 +701,8 @@ static void ExtractOneArchive (
   arc.MTimeDefined = !fi.IsDevice;
   arc.MTime = fi.MTime;
 
+  governor.ApplyToArchive(arc.Archive);
+
   bool calcCrc =
       #ifndef _SFX
         (hash != NULL);
@@ -230,17 +710,134 @@ static void ExtractOneArchive (
         false;
       #endif
 
+  if (extractCallback->journal)
+  {
+    uint64_t mTime = (static_cast<uint64_t>(fi.MTime.dwHighDateTime) << 32) | fi.MTime.dwLowDateTime;
+    extractCallback->journal->BeginArchive(archiveSize, mTime);
+  }
+
+  auto trace = GetTrace();
+  CExtractTimings timings;
+  if (trace) ecs->Timings = &timings;
+  uint64_t extractStart = Trace::GetTicks();
+
   result = DecompressArchive(codecs, arcLink,
-      fi.Size + arcLink.VolumesSize,
-      options, calcCrc, extractCallback, ecs, errorMessage);
-  ecs->LocalProgressSpec->InSize += fi.Size + arcLink.VolumesSize;
+      archiveSize + arcLink.VolumesSize,
+      options, calcCrc, extractCallback, ecs, false, cache, governor, errorMessage);
+  ecs->LocalProgressSpec->InSize += archiveSize + arcLink.VolumesSize;
+  ecs->LocalProgressSpec->OutSize = ecs->UnpackSize;
+  extractCallback->SparseSkipped += ecs->SparseSkipped;
+  extractCallback->SparseSaved += ecs->SparseSaved;
+
+  if (trace)
+  {
+    ecs->Timings = nullptr;
+    trace->ArchiveExtracted(arcPath, archiveSize + arcLink.VolumesSize, ecs->UnpackSize,
+                            Trace::TicksToMicroseconds(Trace::GetTicks() - extractStart), timings);
+  }
+
+  CHECK_HR (result);
+}
+
+static int FindTarFormat (CCodecs *codecs)
+{
+  FOR_VECTOR (i, codecs->Formats)
+  {
+    if (StringsAreEqualNoCase_Ascii(codecs->Formats[i].Name, "tar"))
+      return (int)i;
+  }
+  return -1;
+}
+
+/* Streaming extraction: the archive is a (possibly compressed) tarball, read
+ * sequentially from stdin or a growing file. Files are written as the data arrives. */
+static void ExtractOneStream (
+    CCodecs *codecs,
+    const UString& arcPath,
+    const CExtractOptions &options,
+    IOpenCallbackUI *openCallback,
+    CExtractCallback *extractCallback,
+    const ResourceGovernor& governor,
+    UString &errorMessage)
+{
+  int tarFormat = FindTarFormat(codecs);
+  if (tarFormat < 0) THROW_HR(E_NOTIMPL);
+
+  StreamInput input(arcPath, governor);
+
+  CArchiveExtractCallback *ecs = new CArchiveExtractCallback;
+  CMyComPtr<IArchiveExtractCallback> ec(ecs);
+  ecs->InitForMulti(false, options.PathMode, options.OverwriteMode, false);
+
+  CHECK_HR(extractCallback->BeforeOpen(arcPath, options.TestMode));
+
+  CArchiveLink arcLink;
+
+  CObjectVector<COpenType> types;
+  COpenType tarType;
+  tarType.FormatIndex = tarFormat;
+  types.Add(tarType);
+  CIntVector excludedFormats;
+  COpenOptions op;
+  op.codecs = codecs;
+  op.types = &types;
+  op.excludedFormats = &excludedFormats;
+  op.stdInMode = true;
+  op.seqStream = input.GetStream();
+  op.stream = NULL;
+  op.filePath = arcPath;
+  HRESULT result = arcLink.Open3(op, openCallback);
+  if (result == E_ABORT)
+    CHECK_HR(result);
+
+  if (arcLink.NonOpen_ErrorInfo.ErrorFormatIndex >= 0)
+    result = S_FALSE;
+
+  CHECK_HR(extractCallback->OpenResult(codecs, arcLink, arcPath, result));
+  CHECK_HR(result);
+
+  CArc &arc = arcLink.Arcs.Back();
+  arc.MTimeDefined = false;
+
+  // Streams can't be resumed, but files are journaled for rollback
+  if (extractCallback->journal) extractCallback->journal->BeginArchive(0, 0);
+
+  auto trace = GetTrace();
+  CExtractTimings timings;
+  if (trace) ecs->Timings = &timings;
+  uint64_t extractStart = Trace::GetTicks();
+
+  result = DecompressArchive(codecs, arcLink, 0,
+      options, false, extractCallback, ecs, true, nullptr, governor, errorMessage);
   ecs->LocalProgressSpec->OutSize = ecs->UnpackSize;
+  extractCallback->SparseSkipped += ecs->SparseSkipped;
+  extractCallback->SparseSaved += ecs->SparseSaved;
+
+  HRESULT inputResult = input.Finish();
+  if (FAILED(inputResult))
+  {
+    fprintf(stderr, "Error reading %ls (%s): %ls\n", arcPath.Ptr(),
+            input.GetCompression() ? input.GetCompression() : "tar", GetHRESULTString(inputResult).Ptr());
+  }
+
+  if (trace)
+  {
+    ecs->Timings = nullptr;
+    trace->ArchiveExtracted(arcPath, 0, ecs->UnpackSize,
+                            Trace::TicksToMicroseconds(Trace::GetTicks() - extractStart), timings);
+  }
 
   CHECK_HR (result);
+  CHECK_HR (inputResult);
 }
 
 void Extract (ProgressReporter& progress, DeletionHelper& delHelper,
+              const ResourceGovernor& governor,
               const std::vector<const wchar_t*>& archives,
+              bool streamArchives,
+              ExtractCache* cache,
+              ExtractJournal* journal,
+              PreviousInstall* previousInstall,
               const wchar_t* targetDir,
               std::vector<MyUString>& extractedFiles)
 {
@@ -258,6 +855,8 @@ void Extract (ProgressReporter& progress, DeletionHelper& delHelper,
 
   CExtractCallback* ecs = new CExtractCallback (progress, delHelper, extractedFiles, outputDir);
   CMyComPtr<IFolderArchiveExtractCallback> extractCallback = ecs;
+  ecs->journal = journal;
+  ecs->previousInstall = previousInstall;
 
   COpenCallback openCallback;
 
@@ -268,20 +867,35 @@ void Extract (ProgressReporter& progress, DeletionHelper& delHelper,
   eo.OverwriteMode = NExtract::NOverwriteMode::kAsk;
   eo.OutputDir = outputDir;
   eo.YesToAll = false;
+  eo.NtOptions.PreAllocateOutFile = g_IoPolicy.PreAllocate;
 
   for(const wchar_t* archivePath : archives)
   {
     UString errorMessage;
 
-    ExtractOneArchive(
-        codecs,
-        types,
-        archivePath,
-        eo, &openCallback, ecs,
-        #ifndef _SFX
-        nullptr,
-        #endif
-        errorMessage);
+    if (streamArchives || IsStdInArchive(archivePath))
+    {
+      ExtractOneStream(
+          codecs,
+          archivePath,
+          eo, &openCallback, ecs,
+          governor,
+          errorMessage);
+    }
+    else
+    {
+      ExtractOneArchive(
+          codecs,
+          types,
+          archivePath,
+          eo, &openCallback, ecs,
+          governor,
+          cache,
+          #ifndef _SFX
+          nullptr,
+          #endif
+          errorMessage);
+    }
     if (!errorMessage.IsEmpty())
     {
       ecs->MessageError (errorMessage);
@@ -289,6 +903,14 @@ void Extract (ProgressReporter& progress, DeletionHelper& delHelper,
     }
   }
 
+  if (cache) cache->Trim();
+
+  if (g_IoPolicy.SparseOutput)
+  {
+    printf ("Sparse output: %llu bytes not written, %llu bytes of disk space saved\n",
+            ecs->SparseSkipped, ecs->SparseSaved);
+  }
+
   HRESULT extractHR = ecs->GetExtractHR();
   CHECK_HR(extractHR);
 }
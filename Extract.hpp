@@ -44,12 +44,32 @@
 extern const char extractCopyright[];
 
 class DeletionHelper;
+class ExtractCache;
+class ExtractJournal;
+class PreviousInstall;
 struct ProgressReporter;
+class ResourceGovernor;
 
-/// Helper to extract 7-zip archives
+/**
+ * Helper to extract 7-zip archives.
+ * With \a streamArchives, archives are read sequentially as (possibly xz or
+ * zstd compressed) tarballs, even while they're still being written.
+ * An archive named "-" is always streamed from standard input.
+ * If \a cache is given, items are restored from it where possible, and
+ * extracted items are added to it.
+ * If \a journal is given, extracted files are recorded in it, and files
+ * an earlier attempt recorded are skipped.
+ * If \a previousInstall is given, items that match a file it installed are
+ * skipped; the installed file is kept and reported as extracted.
+ */
 void Extract (ProgressReporter& progress,
               DeletionHelper& delHelper,
+              const ResourceGovernor& governor,
               const std::vector<const wchar_t*>& archives,
+              bool streamArchives,
+              ExtractCache* cache,
+              ExtractJournal* journal,
+              PreviousInstall* previousInstall,
               const wchar_t* targetDir,
               std::vector<MyUString>& extractedFiles);
 
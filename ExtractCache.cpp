@@ -0,0 +1,312 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "ExtractCache.hpp"
+
+#include "ArgsHelper.hpp"
+#include "Error.hpp"
+#include "Paths.hpp"
+
+#include "7zCrc.h"
+
+#include "Windows/FileDir.h"
+#include "Windows/PropVariant.h"
+#include "7zip/Archive/Common/HandlerOut.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+
+#include <Windows.h>
+#include <winioctl.h>
+
+// Buffer used to check entry contents
+static const size_t verifyBufferSize = 1 << 20;
+
+#ifndef FSCTL_DUPLICATE_EXTENTS_TO_FILE
+// Block cloning (ReFS); missing from older SDKs
+#define FSCTL_DUPLICATE_EXTENTS_TO_FILE CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 209, METHOD_BUFFERED, FILE_WRITE_DATA)
+
+typedef struct _DUPLICATE_EXTENTS_DATA {
+  HANDLE FileHandle;
+  LARGE_INTEGER SourceFileOffset;
+  LARGE_INTEGER TargetFileOffset;
+  LARGE_INTEGER ByteCount;
+} DUPLICATE_EXTENTS_DATA, *PDUPLICATE_EXTENTS_DATA;
+#endif
+
+bool ExtractCache::Init (const ArgsHelper& args, const InstallLogLocation& logLocation)
+{
+  const wchar_t* cacheArg = nullptr;
+  enabled = args.GetOption (L"--cache", cacheArg);
+  if (!enabled) return true;
+
+  if (cacheArg && (*cacheArg == 0))
+  {
+    fprintf (stderr, "Invalid value for --cache: expected a directory\n");
+    return false;
+  }
+  if (cacheArg)
+  {
+    cacheDir = cacheArg;
+    // Strip trailing separators, we append our own
+    while ((cacheDir.Len() > 1) && (cacheDir.Ptr()[cacheDir.Len() - 1] == '\\'))
+      cacheDir.DeleteFrom (cacheDir.Len() - 1);
+  }
+  else
+  {
+    cacheDir = logLocation.GetLogsPath();
+    cacheDir += L"\\cache";
+  }
+
+  const wchar_t* sizeArg = nullptr;
+  if (args.GetOption (L"--cache-size", sizeArg))
+  {
+    UInt64 value = 0;
+    NWindows::NCOM::CPropVariant emptyProp;
+    if (!sizeArg || !NArchive::ParseSizeString (sizeArg, emptyProp, 0, value) || (value == 0))
+    {
+      fprintf (stderr, "Invalid value for --cache-size: expected a size (e.g. 512m, 10g)\n");
+      return false;
+    }
+    maxSize = value;
+  }
+
+  if (!NWindows::NFile::NDir::CreateComplexDir (cacheDir.Ptr()))
+  {
+    fprintf (stderr, "Error creating cache directory %ls: %ls\n", cacheDir.Ptr(),
+             GetErrorString (GetLastError ()).Ptr ());
+    return false;
+  }
+  return true;
+}
+
+MyUString ExtractCache::GetEntryPath (const Key& key) const
+{
+  wchar_t entryName[32];
+  _snwprintf_s (entryName, _TRUNCATE, L"\\%016llx-%08x", key.size, key.crc);
+  return cacheDir + entryName;
+}
+
+// Mark an entry as recently used
+static void TouchEntry (const wchar_t* path)
+{
+  HANDLE file = CreateFileW (path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             nullptr, OPEN_EXISTING, 0, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return;
+  FILETIME now;
+  GetSystemTimeAsFileTime (&now);
+  SetFileTime (file, nullptr, nullptr, &now);
+  CloseHandle (file);
+}
+
+/* Clone a file's blocks, without copying data. Only works on file systems
+ * supporting block cloning (ReFS), with source and destination on the same volume. */
+static bool CloneFile (const wchar_t* source, const wchar_t* dest)
+{
+  HANDLE sourceFile = CreateFileW (source, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+  if (sourceFile == INVALID_HANDLE_VALUE) return false;
+
+  // Cloned ranges must be cluster aligned; also tells whether the file system supports cloning
+  FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity;
+  DWORD bytesReturned = 0;
+  LARGE_INTEGER size;
+  if (!DeviceIoControl (sourceFile, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0, &integrity, sizeof (integrity), &bytesReturned, nullptr)
+      || (integrity.ClusterSizeInBytes == 0)
+      || !GetFileSizeEx (sourceFile, &size))
+  {
+    CloseHandle (sourceFile);
+    return false;
+  }
+
+  HANDLE destFile = CreateFileW (dest, GENERIC_READ | GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS, 0, nullptr);
+  if (destFile == INVALID_HANDLE_VALUE)
+  {
+    CloseHandle (sourceFile);
+    return false;
+  }
+
+  bool result = false;
+  FILE_END_OF_FILE_INFO endOfFile;
+  endOfFile.EndOfFile = size;
+  if (SetFileInformationByHandle (destFile, FileEndOfFileInfo, &endOfFile, sizeof (endOfFile)))
+  {
+    const uint64_t clusterSize = integrity.ClusterSizeInBytes;
+    DUPLICATE_EXTENTS_DATA duplicate;
+    duplicate.FileHandle = sourceFile;
+    duplicate.SourceFileOffset.QuadPart = 0;
+    duplicate.TargetFileOffset.QuadPart = 0;
+    duplicate.ByteCount.QuadPart = (size.QuadPart + clusterSize - 1) / clusterSize * clusterSize;
+    result = DeviceIoControl (destFile, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &duplicate, sizeof (duplicate),
+                              nullptr, 0, &bytesReturned, nullptr) != FALSE;
+  }
+  if (!result)
+  {
+    // Don't leave a partial file behind
+    FILE_DISPOSITION_INFO disposition;
+    disposition.DeleteFile = TRUE;
+    SetFileInformationByHandle (destFile, FileDispositionInfo, &disposition, sizeof (disposition));
+  }
+  CloseHandle (destFile);
+  CloseHandle (sourceFile);
+  return result;
+}
+
+static bool CloneOrCopyFile (const wchar_t* source, const wchar_t* dest)
+{
+  return CloneFile (source, dest) || CopyFileW (source, dest, FALSE);
+}
+
+// Check an entry's contents against its key; repairs may well be caused by a damaged disk
+static bool VerifyEntry (const wchar_t* path, const ExtractCache::Key& key)
+{
+  HANDLE file = CreateFileW (path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER size;
+  bool match = GetFileSizeEx (file, &size) && (static_cast<uint64_t> (size.QuadPart) == key.size);
+  if (match)
+  {
+    std::unique_ptr<Byte[]> buffer (new Byte[verifyBufferSize]);
+    UInt32 crc = CRC_INIT_VAL;
+    uint64_t remaining = key.size;
+    while (remaining > 0)
+    {
+      DWORD bytesRead = 0;
+      if (!ReadFile (file, buffer.get(), static_cast<DWORD> (verifyBufferSize), &bytesRead, nullptr) || (bytesRead == 0))
+        break;
+      crc = CrcUpdate (crc, buffer.get(), bytesRead);
+      remaining -= std::min<uint64_t> (remaining, bytesRead);
+    }
+    match = (remaining == 0) && (CRC_GET_DIGEST (crc) == key.crc);
+  }
+  CloseHandle (file);
+  return match;
+}
+
+bool ExtractCache::Restore (const Key& key, const wchar_t* destPath)
+{
+  auto entryPath = GetEntryPath (key);
+  if (GetFileAttributesW (entryPath.Ptr()) == INVALID_FILE_ATTRIBUTES) return false;
+  if (!VerifyEntry (entryPath.Ptr(), key))
+  {
+    // Damaged: extract instead, which adds a good copy again
+    fprintf (stderr, "Cache entry %ls is damaged, discarding it\n", entryPath.Ptr());
+    DeleteFileW (entryPath.Ptr());
+    return false;
+  }
+
+  /* Restore next to the destination, then replace it: writing to the existing
+   * file would write through to every other link of it (see ContentStore) */
+  MyUString tempPath (destPath);
+  tempPath += L".sicache~";
+  if (!CloneOrCopyFile (entryPath.Ptr(), tempPath.Ptr())) return false;
+  DWORD destAttr (GetFileAttributesW (destPath));
+  if ((destAttr != INVALID_FILE_ATTRIBUTES) && ((destAttr & FILE_ATTRIBUTE_READONLY) != 0))
+    SetFileAttributesW (destPath, destAttr & ~FILE_ATTRIBUTE_READONLY);
+  if (!MoveFileExW (tempPath.Ptr(), destPath, MOVEFILE_REPLACE_EXISTING))
+  {
+    DeleteFileW (tempPath.Ptr());
+    return false;
+  }
+  TouchEntry (entryPath.Ptr());
+  return true;
+}
+
+void ExtractCache::Add (const Key& key, const wchar_t* path)
+{
+  auto entryPath = GetEntryPath (key);
+  if (GetFileAttributesW (entryPath.Ptr()) != INVALID_FILE_ATTRIBUTES)
+  {
+    TouchEntry (entryPath.Ptr());
+    return;
+  }
+
+  // Copy to a temporary name first, so a cut-short copy is never taken for an entry
+  MyUString tempPath (entryPath);
+  tempPath += L".tmp";
+  if (!CloneOrCopyFile (path, tempPath.Ptr())) return;
+  // Copy may carry over a read-only attribute, which would get in the way of eviction
+  SetFileAttributesW (tempPath.Ptr(), FILE_ATTRIBUTE_NORMAL);
+  if (!MoveFileExW (tempPath.Ptr(), entryPath.Ptr(), MOVEFILE_REPLACE_EXISTING))
+  {
+    DeleteFileW (tempPath.Ptr());
+    return;
+  }
+  TouchEntry (entryPath.Ptr());
+}
+
+void ExtractCache::Trim ()
+{
+  struct Entry
+  {
+    MyUString name;
+    uint64_t size;
+    uint64_t lastUsed;
+  };
+  std::vector<Entry> entries;
+  uint64_t totalSize = 0;
+
+  MyUString wildcard (cacheDir);
+  wildcard += L"\\*";
+  WIN32_FIND_DATAW findData;
+  HANDLE findHandle = FindFirstFileExW (wildcard.Ptr(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+  if (findHandle == INVALID_HANDLE_VALUE) return;
+  do
+  {
+    if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) continue;
+    Entry entry;
+    entry.name = findData.cFileName;
+    entry.size = (static_cast<uint64_t> (findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+    entry.lastUsed = (static_cast<uint64_t> (findData.ftLastWriteTime.dwHighDateTime) << 32) | findData.ftLastWriteTime.dwLowDateTime;
+    totalSize += entry.size;
+    entries.emplace_back (std::move (entry));
+  } while (FindNextFileW (findHandle, &findData));
+  FindClose (findHandle);
+
+  if (totalSize <= maxSize) return;
+
+  std::sort (entries.begin(), entries.end(),
+             [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+  size_t numEvicted = 0;
+  for (const auto& entry : entries)
+  {
+    if (totalSize <= maxSize) break;
+    MyUString path (cacheDir + L"\\" + entry.name);
+    if (DeleteFileW (path.Ptr()))
+    {
+      totalSize -= entry.size;
+      ++numEvicted;
+    }
+  }
+  printf ("Cache: evicted %zu content(s), %llu MiB in use\n", numEvicted, totalSize >> 20);
+}
@@ -0,0 +1,89 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Cache of extracted file contents
+ */
+#ifndef SEVENI_EXTRACTCACHE_HPP_
+#define SEVENI_EXTRACTCACHE_HPP_
+
+#include "MyUString.hpp"
+
+#include <stdint.h>
+
+class ArgsHelper;
+class InstallLogLocation;
+
+/**
+ * Local cache of previously extracted file contents, enabled with
+ * \c --cache[=<dir>]. Contents are keyed by size and CRC32 as recorded in the
+ * archive, so they're found again regardless of the archive or product they
+ * came from. Items found in the cache are cloned (on file systems supporting
+ * block cloning) or copied instead of being decoded; solid folders all
+ * items of which are cached are not decoded at all.
+ * The cache is limited to \c --cache-size bytes, evicting least recently used
+ * contents first.
+ */
+class ExtractCache
+{
+public:
+  /// Parse cache options. Prints a message and returns false if an option is invalid.
+  bool Init (const ArgsHelper& args, const InstallLogLocation& logLocation);
+
+  /// Whether the cache is used
+  bool IsEnabled () const { return enabled; }
+
+  /// Identifies a content
+  struct Key
+  {
+    uint64_t size;
+    uint32_t crc;
+  };
+
+  /**
+   * Restore a cached content to \a destPath, replacing an existing file.
+   * The content is checked against the key first, damaged contents are
+   * discarded. Returns false if the content is not cached or could not be
+   * restored.
+   */
+  bool Restore (const Key& key, const wchar_t* destPath);
+  /// Add an extracted file to the cache
+  void Add (const Key& key, const wchar_t* path);
+  /// Evict least recently used contents until the cache fits its size limit
+  void Trim ();
+private:
+  MyUString cacheDir;
+  uint64_t maxSize = 2ull << 30;
+  bool enabled = false;
+
+  MyUString GetEntryPath (const Key& key) const;
+};
+
+#endif // SEVENI_EXTRACTCACHE_HPP_
@@ -5,10 +5,12 @@
 #include "ExtractCallback.hpp"
 
 #include "DeletionHelper.hpp"
+#include "ExtractJournal.hpp"
 #include "Paths.hpp"
 #include "ProgressReporter.hpp"
 
 #include "Common/IntToString.h"
+#include "Common/IoPolicy.h"
 #include "Common/Wildcard.h"
 
 #include "Windows/FileDir.h"
@@ -130,6 +132,27 @@ static const char * const kCantDeleteOutputDir = "Can not delete output folder";
 static const char * const kDeleteOutputFileAfterReboot = "Deleting output file needs reboot";
 static const char * const kDeleteOutputDirAfterReboot = "Deleting output folder needs reboot";
 
+/* Whether an existing file can be truncated and rewritten in place, which
+ * saves deleting and recreating it. Only for plain files that can be opened
+ * for writing: locked, read-only or hidden files, directories and reparse
+ * points still go through deletion, which handles them. Files with more than
+ * one link (e.g. content store entries) are shared, so they are replaced. */
+static bool CanOverwriteInPlace (const wchar_t* path)
+{
+  HANDLE file = CreateFileW (path, GENERIC_WRITE | FILE_READ_ATTRIBUTES,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_OPEN_REPARSE_POINT, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  const DWORD unsupportedAttr = FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN
+                                | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_REPARSE_POINT;
+  BY_HANDLE_FILE_INFORMATION info;
+  bool result = GetFileInformationByHandle (file, &info)
+                && ((info.dwFileAttributes & unsupportedAttr) == 0)
+                && (info.nNumberOfLinks == 1);
+  CloseHandle (file);
+  return result;
+}
+
 STDMETHODIMP CExtractCallback::AskOverwrite(
     const wchar_t *existName, const FILETIME *existTime, const UInt64 *existSize,
     const wchar_t *newName, const FILETIME *newTime, const UInt64 *newSize,
@@ -140,6 +163,12 @@ STDMETHODIMP CExtractCallback::AskOverwrite(
   /* FIXME: If we'd do some sort of 'rollback' support (ability to
    * 'undo' an extraction of some file), this would be the place */
 
+  if (g_IoPolicy.OverwriteInPlace && CanOverwriteInPlace (existName))
+  {
+    *answer = NOverwriteAnswer::kReplace;
+    return CheckBreak2();
+  }
+
   *answer = NOverwriteAnswer::kYes;
   /* Try to delete the existing file if it already exists.
      Although the 7zip code already tries to do that if we return
@@ -294,7 +323,8 @@ STDMETHODIMP CExtractCallback::SetOperationResult(Int32 opRes, Int32 encrypted)
   if (opRes == NArchive::NExtract::NOperationResult::kOK)
   {
     MyUString filename = (outputDir + _currentName);
-    NormalizePath (filename);
+    normalizer.Normalize (filename);
+    if (journal) journal->AddFile (filename);
     extractedFiles.emplace_back (std::move (filename));
   }
   else
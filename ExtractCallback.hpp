@@ -13,10 +13,13 @@
 #include "7zip/UI/Common/ArchiveExtractCallback.h"
 
 #include "MyUString.hpp"
+#include "Paths.hpp"
 
 #include <vector>
 
 class DeletionHelper;
+class ExtractJournal;
+class PreviousInstall;
 struct IArchiveCallback;
 struct ProgressReporter;
 
@@ -49,6 +52,12 @@ public:
   ProgressReporter& progress;
   DeletionHelper& delHelper;
   std::vector<MyUString>& extractedFiles;
+  // normalizes extracted file names, caching long names of output directories
+  PathNormalizer normalizer;
+  // records extracted files as they complete, if set
+  ExtractJournal* journal = nullptr;
+  // files of the installation being upgraded, if set
+  PreviousInstall* previousInstall = nullptr;
   // map from item name to desired full path
   std::unordered_map<MyUString, MyUString> renamesRequested;
   UInt64 NumTryArcs = 0;
@@ -63,6 +72,9 @@ public:
   UInt64 NumOpenArcWarnings = 0;
   UInt64 NumFileErrors = 0;
   UInt64 NumFileErrors_in_Current = 0;
+  // bytes left as holes of sparse files, and the disk space that saved
+  UInt64 SparseSkipped = 0;
+  UInt64 SparseSaved = 0;
   UString outputDir;
 };
 
@@ -0,0 +1,136 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "ExtractJournal.hpp"
+
+#include "Error.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Marker for the start of an archive's files: ":archive <size> <mtime>"
+static const wchar_t archiveMarker[] = L":archive ";
+
+template<typename Func>
+void ExtractJournal::ForEachEntry (const wchar_t* path, Func func)
+{
+  try
+  {
+    InstalledFilesReader reader (path);
+    ArchiveKey archive (0, 0);
+    MyUString line;
+    while (!(line = reader.GetFileName()).IsEmpty())
+    {
+      if (wcsncmp (line.Ptr(), archiveMarker, _countof (archiveMarker) - 1) == 0)
+      {
+        wchar_t* end = nullptr;
+        archive.first = _wcstoui64 (line.Ptr() + _countof (archiveMarker) - 1, &end, 10);
+        archive.second = _wcstoui64 (end, nullptr, 16);
+        continue;
+      }
+      func (archive, line);
+    }
+  }
+  catch (const HRESULTException& e)
+  {
+    // No journal is the normal case
+    if ((e.GetHR() != HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+        && (e.GetHR() != HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND)))
+    {
+      fprintf (stderr, "Error reading journal %ls: %ls\n", path, GetHRESULTString (e.GetHR()).Ptr());
+    }
+  }
+}
+
+ExtractJournal::ExtractJournal (const wchar_t* path) : path (path)
+{
+  size_t numFiles = 0;
+  ForEachEntry (path, [&](const ArchiveKey& archive, const MyUString& file)
+  {
+    if (archive.first == 0) return;
+    previous[archive].Insert (file);
+    ++numFiles;
+  });
+  if (numFiles > 0)
+    printf ("Resuming interrupted install, %zu file(s) extracted before\n", numFiles);
+}
+
+void ExtractJournal::BeginArchive (uint64_t size, uint64_t mTime)
+{
+  if (!writer)
+  {
+    try
+    {
+      writer.reset (new InstalledFilesWriter (path, true));
+    }
+    catch (const HRESULTException& e)
+    {
+      // Install still works, it just can't be resumed
+      fprintf (stderr, "Error creating journal %ls: %ls\n", path.Ptr(), GetHRESULTString (e.GetHR()).Ptr());
+    }
+  }
+
+  ArchiveKey archive (size, mTime);
+  auto previousIt = size != 0 ? previous.find (archive) : previous.end ();
+  currentPrevious = previousIt != previous.end () ? &previousIt->second : nullptr;
+
+  if (writer)
+  {
+    wchar_t marker[64];
+    _snwprintf_s (marker, _TRUNCATE, L"%ls%llu %016llx", archiveMarker, size, mTime);
+    writer->AddEntry (marker);
+  }
+}
+
+bool ExtractJournal::WasExtracted (const MyUString& fullPath) const
+{
+  return currentPrevious && currentPrevious->Contains (fullPath);
+}
+
+void ExtractJournal::AddFile (const MyUString& fullPath)
+{
+  if (writer) writer->AddEntry (fullPath);
+}
+
+void ExtractJournal::Finish ()
+{
+  if (writer)
+    writer->Discard ();
+  else
+    DeleteFileW (path.Ptr());
+  writer.reset ();
+  previous.clear ();
+  currentPrevious = nullptr;
+}
+
+void ExtractJournal::ReadFiles (const wchar_t* path, PathSet& files)
+{
+  ForEachEntry (path, [&](const ArchiveKey&, const MyUString& file) { files.Insert (file); });
+}
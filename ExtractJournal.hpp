@@ -0,0 +1,92 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Journal of extracted files, for resuming interrupted installs
+ */
+#ifndef SEVENI_EXTRACTJOURNAL_HPP_
+#define SEVENI_EXTRACTJOURNAL_HPP_
+
+#include "InstalledFiles.hpp"
+#include "MyUString.hpp"
+#include "PathSet.hpp"
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+
+/**
+ * Journal of the files an install or repair has extracted so far.
+ * Files are recorded as soon as they're complete, grouped by the archive
+ * (identified by size and modification time) they came from.
+ * If an install is interrupted, the next attempt skips files the journal
+ * lists, provided they still match the archive; the journal also serves as
+ * list of files to roll back if the install is abandoned.
+ * The journal is an installed files list, with archive marker lines.
+ */
+class ExtractJournal
+{
+public:
+  /// Open the journal, reading entries left by an earlier, interrupted attempt
+  ExtractJournal (const wchar_t* path);
+
+  /// Whether an earlier attempt left entries
+  bool IsResuming () const { return !previous.empty (); }
+
+  /**
+   * Start recording files of an archive. Archives with size 0 are not
+   * resumable (e.g. streams) and get no earlier entries.
+   */
+  void BeginArchive (uint64_t size, uint64_t mTime);
+  /// Whether a file of the current archive was extracted by an earlier attempt
+  bool WasExtracted (const MyUString& fullPath) const;
+  /// Record a completely extracted file
+  void AddFile (const MyUString& fullPath);
+
+  /// Installation is complete, remove the journal
+  void Finish ();
+
+  /// Add all files listed in the journal at \a path to \a files
+  static void ReadFiles (const wchar_t* path, PathSet& files);
+private:
+  MyUString path;
+  typedef std::pair<uint64_t, uint64_t> ArchiveKey;
+  /// Files extracted by earlier attempts, by archive
+  std::map<ArchiveKey, PathSet> previous;
+  const PathSet* currentPrevious = nullptr;
+  std::unique_ptr<InstalledFilesWriter> writer;
+
+  template<typename Func>
+  static void ForEachEntry (const wchar_t* path, Func func);
+};
+
+#endif // SEVENI_EXTRACTJOURNAL_HPP_
@@ -32,21 +32,29 @@
 
 #include "ArgsHelper.hpp"
 #include "CommonArgs.hpp"
+#include "ContentStore.hpp"
 #include "DeletionHelper.hpp"
 #include "Error.hpp"
 #include "ExitCode.hpp"
 #include "Extract.hpp"
+#include "ExtractCache.hpp"
+#include "ExtractJournal.hpp"
+#include "GUID.hpp"
 #include "InstalledFiles.hpp"
+#include "IoPolicy.hpp"
+#include "Manifest.hpp"
 #include "Paths.hpp"
+#include "PathSet.hpp"
+#include "PreviousInstall.hpp"
 #include "ProgressReporter.hpp"
 #include "Registry.hpp"
 #include "RegistryLocations.hpp"
+#include "ResourceGovernor.hpp"
 
 #include "Windows/FileName.h"
 
 #include <queue>
 #include <memory>
-#include <unordered_set>
 
 // Helper: Sort a std::vector<MyUString>
 template<typename T, typename SortFunc>
@@ -85,14 +93,14 @@ class RemoveHelper
     bool recursive = false;
   };
   std::vector<Dir> directories;
-  std::unordered_set<MyUString> reallyDeleted;
+  PathSet reallyDeleted;
 public:
   RemoveHelper(DeletionHelper& delHelper) : delHelper(delHelper) {}
   ~RemoveHelper();
 
   bool IsRebootRequired() const { return rebootRequired; }
   HRESULT GetHR() const { return IsRebootRequired() ? HRESULT_FROM_WIN32(ERROR_SUCCESS_REBOOT_REQUIRED) : hr; }
-  const std::unordered_set<MyUString>& GetReallyDeleted() const { return reallyDeleted; }
+  const PathSet& GetReallyDeleted() const { return reallyDeleted; }
 
   void ScheduleRemove (const wchar_t* path);
   void FlushDelayed (ProgressReporter& progress);
@@ -194,7 +202,7 @@ void RemoveHelper::ScheduleRemove (const wchar_t* path)
     if (IsErrorFileNotFound(result))
     {
       ++notFoundCounter;
-      reallyDeleted.insert (path);
+      reallyDeleted.Insert (path);
     }
     else if (result != ERROR_SUCCESS)
     {
@@ -204,7 +212,7 @@ void RemoveHelper::ScheduleRemove (const wchar_t* path)
     }
     else
     {
-      reallyDeleted.insert (path);
+      reallyDeleted.Insert (path);
     }
   }
   else if ((fileAttr & FILE_ATTRIBUTE_DIRECTORY) != 0)
@@ -219,10 +227,10 @@ void RemoveHelper::ScheduleRemove (const wchar_t* path)
     if (IsErrorFileNotFound(result))
     {
       ++notFoundCounter;
-      reallyDeleted.insert (path);
+      reallyDeleted.Insert (path);
     } else if (result == ERROR_SUCCESS_REBOOT_REQUIRED) {
       rebootRequired = true;
-      reallyDeleted.insert(path);
+      reallyDeleted.Insert (path);
       fprintf(stderr, "Deleting file needs reboot: %ls\n", path);
     }
     else if (result != ERROR_SUCCESS)
@@ -233,7 +241,7 @@ void RemoveHelper::ScheduleRemove (const wchar_t* path)
     }
     else
     {
-      reallyDeleted.insert (path);
+      reallyDeleted.Insert (path);
     }
   }
 }
@@ -260,10 +268,10 @@ void RemoveHelper::FlushDelayed (ProgressReporter& progress)
     if (IsErrorFileNotFound(result))
     {
       ++notFoundCounter;
-      reallyDeleted.insert (dir.path);
+      reallyDeleted.Insert (dir.path);
     } else if (result == ERROR_SUCCESS_REBOOT_REQUIRED) {
       rebootRequired = true;
-      reallyDeleted.insert(dir.path);
+      reallyDeleted.Insert (dir.path);
       fprintf(stderr, "Deleting directory needs reboot: %ls\n", dir.path.Ptr());
     } else if (result != ERROR_SUCCESS)
     {
@@ -273,7 +281,7 @@ void RemoveHelper::FlushDelayed (ProgressReporter& progress)
     }
     else
     {
-      reallyDeleted.insert (dir.path);
+      reallyDeleted.Insert (dir.path);
     }
     progress.SetCompleted (++count);
   }
@@ -317,6 +325,33 @@ static void RegistryDelete (InstallScope installScope, const wchar_t* regPath)
   }
 }
 
+// Copy a registry key with all values and subkeys. Returns false if that failed.
+static bool RegistryCopy (InstallScope installScope, const wchar_t* fromPath, const wchar_t* toPath)
+{
+  try
+  {
+    RegistryKey fromKey (RegistryParent (installScope), fromPath, KEY_READ | KEY_WOW64_64KEY);
+    RegistryKey toKey (RegistryParent (installScope), toPath, KEY_ALL_ACCESS | KEY_WOW64_64KEY, RegistryKey::Create);
+    LSTATUS err (RegCopyTreeW (fromKey, nullptr, toKey));
+    if (err != ERROR_SUCCESS)
+    {
+      fprintf (stderr, "Error copying %ls to %ls in registry: %ls\n", fromPath, toPath, GetErrorString (err).Ptr());
+      return false;
+    }
+  }
+  catch (const HRESULTException& e)
+  {
+    // Nothing to copy
+    if ((e.GetHR() == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+      || (e.GetHR() == HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND)))
+      return true;
+    fprintf (stderr, "Error copying %ls to %ls in registry: %ls\n", fromPath, toPath,
+             GetHRESULTString (e.GetHR()).Ptr());
+    return false;
+  }
+  return true;
+}
+
 static size_t HasDependents (InstallScope installScope, const wchar_t* regPath)
 {
   const REGSAM key_access (KEY_READ | KEY_WOW64_64KEY);
@@ -337,12 +372,13 @@ static size_t HasDependents (InstallScope installScope, const wchar_t* regPath)
 
 static MyUString GetOutputDirectory (const ArgsHelper& args,
                                      const CommonArgs& commonArgs,
+                                     const wchar_t* previousGUID,
                                      Action action,
                                      const wchar_t*& outDirArg)
 {
   /* Output directory:
    * - Install: Prefer command line
-   * - Repair: Prefer previously used directory 
+   * - Repair, Upgrade: Prefer previously used directory 
    * - Remove: Always use previously used directory */
 
   const wchar_t* realOutDirArg = nullptr;
@@ -354,19 +390,20 @@ static MyUString GetOutputDirectory (const ArgsHelper& args,
     if (realOutDirArg) return realOutDirArg;
     break;
   case Action::Repair:
+  case Action::Upgrade:
   case Action::Remove:
     {
       std::exception_ptr readRegException;
       try
       {
-        auto regPath = ReadRegistryOutputDir (commonArgs.GetInstallScope (), commonArgs.GetGUID ());
+        auto regPath = ReadRegistryOutputDir (commonArgs.GetInstallScope (), previousGUID);
         if (!regPath.IsEmpty()) return regPath;
       }
       catch (...)
       {
         readRegException = std::current_exception();
       }
-      if ((action == Action::Repair) && realOutDirArg)
+      if ((action != Action::Remove) && realOutDirArg)
         return realOutDirArg;
       if (readRegException)
         std::rethrow_exception (readRegException);
@@ -385,23 +422,26 @@ static MyUString GetExeDir ()
   return path;
 }
 
-static std::unordered_set<MyUString> ReadPreviousFilesList (const CommonArgs& commonArgs,
-                                                            MyUString& listFilePath,
-                                                            bool silent)
+static PathSet ReadPreviousFilesList (const CommonArgs& commonArgs,
+                                      const wchar_t* previousGUID,
+                                      MyUString& listFilePath,
+                                      bool silent)
 {
-  std::unordered_set<MyUString> list;
+  PathSet list;
 
   std::exception_ptr listException;
   try
   {
-    listFilePath = ReadRegistryListFilePath (commonArgs.GetInstallScope (), commonArgs.GetGUID ());
+    listFilePath = ReadRegistryListFilePath (commonArgs.GetInstallScope (), previousGUID);
     InstalledFilesReader listReader (listFilePath.Ptr ());
 
+    PathNormalizer normalizer;
     MyUString installedFile;
     while (!(installedFile = listReader.GetFileName()).IsEmpty())
     {
-      NormalizePath (installedFile);
-      list.insert (installedFile);
+      // Lists of older installs may contain short (8.3) names
+      normalizer.Normalize (installedFile);
+      list.Insert (installedFile);
     }
   }
   catch (...)
@@ -433,8 +473,8 @@ static std::unordered_set<MyUString> ReadPreviousFilesList (const CommonArgs& co
 
 int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action action)
 {
-  bool doExtract = (action == Action::Install) || (action == Action::Repair);
-  bool doRemove = (action == Action::Remove) || (action == Action::Repair);
+  bool doExtract = (action == Action::Install) || (action == Action::Repair) || (action == Action::Upgrade);
+  bool doRemove = (action == Action::Remove) || (action == Action::Repair) || (action == Action::Upgrade);
 
   /* HRESULT value to return. Updated when a sub-action failed, but other
    * sub-actions could still be performed. */
@@ -446,6 +486,26 @@ int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action action)
     return ecArgsError;
   }
 
+  /* Upgrade: The previous installation is registered under the --from GUID.
+   * Files that did not change are kept, and the previous installation is
+   * unregistered once the new one is registered under the -g GUID. */
+  const wchar_t* previousGUID = commonArgs.GetGUID ();
+  if (action == Action::Upgrade)
+  {
+    if (!args.GetOption (L"--from", previousGUID) || !previousGUID || (wcslen (previousGUID) == 0))
+    {
+      printf ("'--from=<GUID>' argument is required\n");
+      return ecArgsError;
+    }
+    if (!VerifyGUID (previousGUID))
+    {
+      printf ("Not an allowed GUID: '%ls'\n", previousGUID);
+      return ecArgsError;
+    }
+  }
+  // Upgrading to the same GUID is a repair that keeps unchanged files
+  bool handOver = (action == Action::Upgrade) && (_wcsicmp (previousGUID, commonArgs.GetGUID ()) != 0);
+
   std::vector<const wchar_t*> archives;
 
   InstallLogLocation logLocation;
@@ -453,19 +513,52 @@ int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action action)
   {
     return ecArgsError;
   }
+  InstallLogLocation previousLogLocation;
+  if (!previousLogLocation.Init (commonArgs, previousGUID))
+  {
+    return ecArgsError;
+  }
+
+  ResourceGovernor governor;
+  if (!governor.Init (args))
+  {
+    return ecArgsError;
+  }
+
+  IoPolicy ioPolicy;
+  if (!ioPolicy.Init (args))
+  {
+    return ecArgsError;
+  }
+
+  ContentStore contentStore;
+  if (!contentStore.Init (args, logLocation))
+  {
+    return ecArgsError;
+  }
+
+  ExtractCache extractCache;
+  if (doExtract && !extractCache.Init (args, logLocation))
+  {
+    return ecArgsError;
+  }
 
   auto progressOutput = GetDefaultProgress (pipe);
   auto delHelper = DeletionHelper(args);
 
   ProgressReporterMultiStep actionProgress (*progressOutput);
-  auto progPhaseRegistryDelete = actionProgress.AddPhase (doRemove ? 1 : 0);
-  auto progPhaseReadFilesLists = actionProgress.AddPhase (doRemove ? 2 : 0);
-  auto progPhaseExtract = actionProgress.AddPhase (doExtract ? 100 : 0);
-  auto progPhaseRemoveFiles = actionProgress.AddPhase (doRemove ? 100 : 0);
-  auto progPhaseRemoveFlush = actionProgress.AddPhase (doRemove ? 5 : 0);
-  auto progPhaseRemoveCleanup = actionProgress.AddPhase (doRemove ? 1 : 0);
-  auto progPhaseWriteList = actionProgress.AddPhase (doExtract ? 1 : 0);
-  auto progPhaseFinish = actionProgress.AddPhase (doExtract ? 1 : 0);
+  auto progPhaseRegistryDelete = actionProgress.AddPhase (doRemove ? 1 : 0, "registry_delete");
+  auto progPhaseReadFilesLists = actionProgress.AddPhase (doRemove ? 2 : 0, "read_lists");
+  auto progPhaseExtract = actionProgress.AddPhase (doExtract ? 100 : 0, "extract");
+  auto progPhaseDedup = actionProgress.AddPhase (doExtract && contentStore.IsEnabled() ? 10 : 0, "dedup");
+  auto progPhaseRemoveFiles = actionProgress.AddPhase (doRemove ? 100 : 0, "remove_files");
+  auto progPhaseRemoveFlush = actionProgress.AddPhase (doRemove ? 5 : 0, "remove_flush");
+  auto progPhaseRemoveCleanup = actionProgress.AddPhase (doRemove ? 1 : 0, "remove_cleanup");
+  auto progPhaseStorePrune = actionProgress.AddPhase (doRemove ? 1 : 0, "store_prune");
+  auto progPhaseWriteList = actionProgress.AddPhase (doExtract ? 1 : 0, "write_list");
+  bool writeManifest = doExtract && args.GetOption (L"--manifest");
+  auto progPhaseManifest = actionProgress.AddPhase (writeManifest ? 20 : 0, "manifest");
+  auto progPhaseFinish = actionProgress.AddPhase (doExtract ? 1 : 0, "finish");
 
   archives = commonArgs.GetArchives ();
 
@@ -475,7 +568,7 @@ int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action action)
     MyUString outputDir;
     try
     {
-      outputDir = GetOutputDirectory (args, commonArgs, action, outDirArg);
+      outputDir = GetOutputDirectory (args, commonArgs, previousGUID, action, outDirArg);
       if (outputDir.IsEmpty ())
       {
         if (action == Action::Install)
@@ -540,44 +633,68 @@ int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action action)
 
     // Grab previous files list
     MyUString listFilePath;
-    auto previousFiles = ReadPreviousFilesList (commonArgs, listFilePath, action == Action::Install);
+    auto previousFiles = ReadPreviousFilesList (commonArgs, previousGUID, listFilePath, action == Action::Install);
+    // Files of an interrupted install are ours as well
+    ExtractJournal::ReadFiles (logLocation.GetJournalFilename().Ptr(), previousFiles);
+    if (handOver)
+      ExtractJournal::ReadFiles (previousLogLocation.GetJournalFilename().Ptr(), previousFiles);
     progReadFilesLists.SetCompleted (2);
 
     // Extract new files (Install/Repair)
     std::vector<MyUString> extractedFiles;
+    std::optional<ExtractJournal> journal;
+    std::optional<PreviousInstall> previousInstall;
+    bool extractComplete = false;
     if (doExtract)
     {
+      journal.emplace (logLocation.GetJournalFilename().Ptr());
+      if (action == Action::Upgrade)
+        previousInstall.emplace (previousFiles, previousLogLocation.GetManifestFilename().Ptr(), governor);
       try
       {
-        Extract(actionProgress.GetPhase(progPhaseExtract), delHelper, archives, outDirArg ? outDirArg : outputDir.Ptr(),
+        ioPolicy.Apply (archives, outDirArg ? outDirArg : outputDir.Ptr());
+        bool streamArchives = args.GetOption (L"--stream");
+        Extract(actionProgress.GetPhase(progPhaseExtract), delHelper, governor, archives, streamArchives,
+                extractCache.IsEnabled() ? &extractCache : nullptr,
+                &*journal,
+                previousInstall ? &*previousInstall : nullptr,
+                outDirArg ? outDirArg : outputDir.Ptr(),
                 extractedFiles);
+        extractComplete = true;
       }
       catch(const HRESULTException& e)
       {
         actionHR = e.GetHR();
+        // Files waiting for a reboot are complete as far as we're concerned
+        extractComplete = (actionHR == HRESULT_FROM_WIN32(ERROR_SUCCESS_REBOOT_REQUIRED));
       }
+
+      // Files that were extracted are fine to share, even if others failed
+      if (contentStore.IsEnabled())
+        contentStore.AddFiles (actionProgress.GetPhase (progPhaseDedup), extractedFiles);
     }
 
-    // Remove previous files (Remove/Repair)
-    if (doRemove)
+    /* Remove previous files (Remove/Repair/Upgrade).
+     * A failed upgrade leaves the previous installation alone; it can be retried. */
+    if (doRemove && ((action != Action::Upgrade) || extractComplete))
     {
       auto& progRemoveFiles = actionProgress.GetPhase (progPhaseRemoveFiles);
 
       // ...but exclude those just extracted
       for (const auto& extracted : extractedFiles)
       {
-        previousFiles.erase (extracted);
+        previousFiles.Erase (extracted);
       }
 
-      progRemoveFiles.SetTotal (previousFiles.size());
+      progRemoveFiles.SetTotal (previousFiles.Size());
       auto removeHelper = RemoveHelper(delHelper);
       size_t n = 0;
-      for (const auto& removeFile : previousFiles)
+      previousFiles.ForEach ([&](const MyUString& removeFile)
       {
         if (!filesCounter || (filesCounter->DecFileRef (removeFile) == 0))
           removeHelper.ScheduleRemove (removeFile.Ptr());
         progRemoveFiles.SetCompleted (++n);
-      }
+      });
 
       auto& progRemoveFlush = actionProgress.GetPhase (progPhaseRemoveFlush);
       // Remove old directory, either for Remove action, or a 'move' repair
@@ -595,29 +712,41 @@ int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action action)
 
       auto& progRemoveCleanup = actionProgress.GetPhase (progPhaseRemoveCleanup);
       progRemoveCleanup.SetTotal (2);
-      for (const auto& deleted_file : removeHelper.GetReallyDeleted())
+      removeHelper.GetReallyDeleted().ForEach ([&](const MyUString& deleted_file)
       {
-        previousFiles.erase (deleted_file);
-      }
-      // Remove previous list file
-      if (!listFilePath.IsEmpty())
+        previousFiles.Erase (deleted_file);
+      });
+      // Remove previous list file (Upgrade: after the new installation is registered)
+      if (!listFilePath.IsEmpty() && !handOver)
         delHelper.FileDelete(listFilePath.Ptr());
+      // Previous manifest is outdated now
+      delHelper.FileDelete(logLocation.GetManifestFilename().Ptr());
+      // Files of an interrupted install were removed as well
+      if (action == Action::Remove)
+        delHelper.FileDelete(logLocation.GetJournalFilename().Ptr());
       progRemoveCleanup.SetCompleted (1);
 
       // Remove registry entry
+      if (!handOver)
       {
         MyUString keyPathUninstall (regPathUninstallInfo);
         keyPathUninstall += commonArgs.GetGUID();
         RegistryDelete (commonArgs.GetInstallScope(), keyPathUninstall.Ptr());
       }
       progRemoveCleanup.SetCompleted (2);
+
+      // Contents only the removed files were linked to are unreferenced now
+      contentStore.Prune (actionProgress.GetPhase (progPhaseStorePrune));
     }
 
     // Write new files list (Install/Repair)
     if (doExtract)
     {
-      std::unordered_set<MyUString> allFiles (extractedFiles.begin(), extractedFiles.end());
-      allFiles.insert (previousFiles.begin(), previousFiles.end());
+      PathSet allFiles (std::move (previousFiles));
+      for (const auto& extracted : extractedFiles)
+      {
+        allFiles.Insert (extracted);
+      }
 
       // Add artifacts files, if given
       const wchar_t* artifactsFile;
@@ -631,12 +760,13 @@ int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action action)
           NWindows::NFile::NName::NormalizeDirPathPrefix (outDir);
           InstalledFilesReader artifactsReader (artifactsFileFull);
 
+          PathNormalizer normalizer;
           MyUString artifactFile;
           while (!(artifactFile = artifactsReader.GetFileName()).IsEmpty())
           {
             artifactFile = outDir + artifactFile;
-            NormalizePath (artifactFile);
-            allFiles.insert (artifactFile);
+            normalizer.Normalize (artifactFile);
+            allFiles.Insert (artifactFile);
           }
         }
         catch (const HRESULTException& e)
@@ -656,26 +786,81 @@ int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action action)
         auto& progWriteList = actionProgress.GetPhase (progPhaseWriteList);
         progWriteList.SetTotal (1);
 
-        // Add output dir to list so it'll get deleted on uninstall
-        std::vector<MyUString> allFiles_v (allFiles.begin(), allFiles.end());
-        SortVec (allFiles_v,
-          [](const MyUString& a, const MyUString& b)
-          {
-            return wmemcmp (a.Ptr (), b.Ptr (), std::min (a.Len (), b.Len ()) + 1);
-          });
-        listWriter.AddEntries (allFiles_v);
+        // Set iterates in sorted order
+        allFiles.ForEach ([&](const MyUString& file) { listWriter.AddEntry (file); });
 
         // Write registry entries
         auto& progFinish = actionProgress.GetPhase (progPhaseFinish);
         progFinish.SetTotal (1);
         WriteToRegistry (commonArgs.GetInstallScope (), commonArgs.GetGUID (), listWriter.GetLogFileName(), outputDir.Ptr());
         progFinish.SetCompleted (1);
+
+        // Nothing to resume anymore
+        if (extractComplete) journal->Finish ();
       }
       catch(...)
       {
         listWriter.Discard ();
         throw;
       }
+
+      /* Read back what was extracted, recording the state for 'verify'.
+       * Files that can't be read back fail the install. */
+      if (writeManifest)
+      {
+        // Files kept by an upgrade are known already
+        std::vector<FileHash> hashes (extractedFiles.size());
+        std::vector<MyUString> toHash;
+        std::vector<size_t> toHashIndex;
+        for (size_t i = 0; i < extractedFiles.size(); i++)
+        {
+          const FileHash* keptHash = previousInstall ? previousInstall->GetKeptHash (extractedFiles[i]) : nullptr;
+          if (keptHash)
+          {
+            hashes[i] = *keptHash;
+          }
+          else
+          {
+            toHash.push_back (extractedFiles[i]);
+            toHashIndex.push_back (i);
+          }
+        }
+        auto newHashes = HashFiles (toHash, governor, actionProgress.GetPhase (progPhaseManifest));
+        for (size_t h = 0; h < newHashes.size(); h++)
+          hashes[toHashIndex[h]] = newHashes[h];
+        for (size_t i = 0; i < hashes.size(); i++)
+        {
+          if (hashes[i].error != ERROR_SUCCESS)
+          {
+            fprintf (stderr, "Error reading back %ls: %ls\n", extractedFiles[i].Ptr(),
+                     GetErrorString (hashes[i].error).Ptr());
+            UpdateHR (actionHR, HRESULT_FROM_WIN32(hashes[i].error));
+          }
+        }
+        WriteManifest (logLocation.GetManifestFilename().Ptr(), extractedFiles, hashes);
+      }
+
+      /* Upgrade: Until here, both installations are registered, and the
+       * reference counts keep shared files. Now dependents move over to the
+       * new installation, and the previous one is unregistered. */
+      if (handOver && extractComplete)
+      {
+        MyUString keyPathPreviousDependencies (regPathDependencyInfo);
+        keyPathPreviousDependencies += previousGUID;
+        MyUString keyPathDependencies (regPathDependencyInfo);
+        keyPathDependencies += commonArgs.GetGUID();
+        if (RegistryCopy (commonArgs.GetInstallScope(), keyPathPreviousDependencies.Ptr(), keyPathDependencies.Ptr()))
+          RegistryDelete (commonArgs.GetInstallScope(), keyPathPreviousDependencies.Ptr());
+
+        MyUString keyPathPreviousUninstall (regPathUninstallInfo);
+        keyPathPreviousUninstall += previousGUID;
+        RegistryDelete (commonArgs.GetInstallScope(), keyPathPreviousUninstall.Ptr());
+        if (!listFilePath.IsEmpty())
+          delHelper.FileDelete(listFilePath.Ptr());
+        delHelper.FileDelete(previousLogLocation.GetManifestFilename().Ptr());
+        // Files of an interrupted previous install are the new installation's now
+        delHelper.FileDelete(previousLogLocation.GetJournalFilename().Ptr());
+      }
     }
   }
   catch (const HRESULTException& e)
@@ -41,7 +41,8 @@ enum struct Action
 {
   Install,
   Remove,
-  Repair
+  Repair,
+  Upgrade
 };
 
 int DoInstallRemove (const ArgsHelper& args, BurnPipe& pipe, Action actions);
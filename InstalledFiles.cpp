@@ -38,14 +38,20 @@
 
 static const wchar_t logHeader[] = L"; SevenInstall";
 
-InstalledFilesWriter::InstalledFilesWriter (const wchar_t* filename)
+InstalledFilesWriter::InstalledFilesWriter (const wchar_t* filename, bool append)
   : file (INVALID_HANDLE_VALUE), logFileName (filename)
 {
-  file = CreateFileW (logFileName, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  file = CreateFileW (logFileName, GENERIC_WRITE, 0, nullptr, append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
   if (file == INVALID_HANDLE_VALUE)
   {
     THROW_HR(HRESULT_FROM_WIN32(GetLastError()));
   }
+  LARGE_INTEGER size = { 0, 0 };
+  if (append && GetFileSizeEx (file, &size) && (size.QuadPart > 0))
+  {
+    LARGE_INTEGER li_null = { 0, 0 };
+    SetFilePointerEx (file, li_null, nullptr, FILE_END);
+  }
   else
   {
     Hprintf (file, "%ls\n", logHeader);
@@ -214,15 +220,17 @@ InstalledFilesCounter::InstalledFilesCounter (const wchar_t* listsDir)
 
 unsigned int InstalledFilesCounter::IncFileRef (const MyUString& path)
 {
-  return ++(files_refs.try_emplace (path, 0).first->second);
+  auto node = files.Intern (path.Ptr (), path.Len ());
+  if (node >= files_refs.size ()) files_refs.resize (files.NumNodes (), 0);
+  return ++files_refs[node];
 }
 
 unsigned int InstalledFilesCounter::DecFileRef (const MyUString& path)
 {
-  auto it = files_refs.find (path);
-  if (it == files_refs.end ()) return 0;
-  if (it->second == 0) return 0;
-  return --(it->second);
+  auto node = files.Find (path.Ptr (), path.Len ());
+  if ((node == PathTrie::noNode) || (node >= files_refs.size ())) return 0;
+  if (files_refs[node] == 0) return 0;
+  return --files_refs[node];
 }
 
 void InstalledFilesCounter::ReadLogFile (const wchar_t* path)
@@ -230,10 +238,12 @@ void InstalledFilesCounter::ReadLogFile (const wchar_t* path)
   try
   {
     InstalledFilesReader reader (path);
+    PathNormalizer normalizer;
     MyUString filename;
     while (!(filename = reader.GetFileName()).IsEmpty())
     {
-      NormalizePath (filename);
+      // Lists of older installs may contain short (8.3) names
+      normalizer.Normalize (filename);
       IncFileRef (filename);
     }
   }
@@ -36,9 +36,12 @@
 #define __7I_INSTALLEDFILES_HPP__
 
 #include "MyUString.hpp"
+#include "PathSet.hpp"
 
 #include <stdio.h>
 
+#include <vector>
+
 #include <Windows.h>
 
 /// Write an installed files list.
@@ -49,19 +52,16 @@ class InstalledFilesWriter
 
   void PrintFile (const MyUString& filename);
 public:
-  InstalledFilesWriter (const wchar_t* filename);
+  /// Create a list. With \a append, entries are added to an existing list.
+  InstalledFilesWriter (const wchar_t* filename, bool append = false);
   ~InstalledFilesWriter ();
 
   const wchar_t* GetLogFileName() const { return logFileName; }
 
-  template<typename Container>
-  void AddEntries (const Container& fullPaths)
+  void AddEntry (const MyUString& fullPath)
   {
     if (file != INVALID_HANDLE_VALUE)
-    {
-      for (const MyUString& fullPath : fullPaths)
-        PrintFile (fullPath);
-    }
+      PrintFile (fullPath);
   }
   /// Remove the list that has been written
   void Discard ();
@@ -96,7 +96,9 @@ public:
   unsigned int IncFileRef (const MyUString& path);
   unsigned int DecFileRef (const MyUString& path);
 private:
-  std::unordered_map<MyUString, unsigned int> files_refs;
+  PathTrie files;
+  /// Reference counts, indexed by node ID
+  std::vector<unsigned int> files_refs;
 
   void ReadLogFile (const wchar_t* path);
 };
@@ -0,0 +1,261 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "IoPolicy.hpp"
+
+#include "ArchiveRange.hpp"
+#include "ArgsHelper.hpp"
+#include "StreamInput.hpp"
+
+#include "Common/Common.h"
+#include "Common/IoPolicy.h"
+#include "Windows/PropVariant.h"
+#include "7zip/Archive/Common/HandlerOut.h"
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <wchar.h>
+
+#include <Windows.h>
+#include <winioctl.h>
+
+/* Buffer sizes per profile. Seek-bound disks benefit from larger buffers,
+ * as reading the archive and writing output files compete for the head. */
+static const uint32_t bufferSizeDefault = 1 << 20;
+static const uint32_t bufferSizeHDD = 4 << 20;
+/* Network shares: Writes of 64MB or more fail with some Windows versions,
+ * and there have been problems with smaller sizes as well, so stay with the
+ * default chunk size. */
+static const uint32_t bufferSizeNetwork = 1 << 20;
+/* Files from this size on are written through a file mapping: copying into
+ * the mapped view saves a WriteFile() call per decoder output chunk. For
+ * smaller files, setting up the mapping costs more than it saves. */
+static const uint64_t mapOutputMinSizeDefault = 64 << 20;
+/* Buffers of archive data read ahead from devices with high latency. One
+ * buffer is being decoded while the others are read, so a disk or network
+ * hiccup doesn't stall the decoder right away. */
+static const int readAheadDefault = 3;
+static const int readAheadMax = 8;
+
+bool IoPolicy::Init (const ArgsHelper& args)
+{
+  const wchar_t* profileArg = nullptr;
+  if (args.GetOption (L"--io-profile", profileArg))
+  {
+    if (profileArg && (_wcsicmp (profileArg, L"auto") == 0))
+      profile = Profile::Auto;
+    else if (profileArg && (_wcsicmp (profileArg, L"ssd") == 0))
+      profile = Profile::SSD;
+    else if (profileArg && (_wcsicmp (profileArg, L"hdd") == 0))
+      profile = Profile::HDD;
+    else if (profileArg && (_wcsicmp (profileArg, L"network") == 0))
+      profile = Profile::Network;
+    else
+    {
+      fprintf (stderr, "Invalid value for --io-profile: expected auto, ssd, hdd or network\n");
+      return false;
+    }
+  }
+
+  const wchar_t* bufferArg = nullptr;
+  if (args.GetOption (L"--io-buffer", bufferArg))
+  {
+    UInt64 value = 0;
+    NWindows::NCOM::CPropVariant emptyProp;
+    // Percentages make no sense here, so pass a "RAM size" of 0
+    if (!bufferArg || !NArchive::ParseSizeString (bufferArg, emptyProp, 0, value)
+        || (value < (64 << 10)) || (value > (64 << 20)))
+    {
+      fprintf (stderr, "Invalid value for --io-buffer: expected a size between 64k and 64m\n");
+      return false;
+    }
+    bufferSize = static_cast<uint32_t> (value);
+  }
+
+  noPreallocate = args.GetOption (L"--no-preallocate");
+  sparse = args.GetOption (L"--sparse");
+
+  const wchar_t* readAheadArg = nullptr;
+  if (args.GetOption (L"--read-ahead", readAheadArg))
+  {
+    wchar_t* end = nullptr;
+    long value = readAheadArg ? wcstol (readAheadArg, &end, 10) : -1;
+    if (!readAheadArg || (end == readAheadArg) || (*end != 0) || (value < 0) || (value > readAheadMax))
+    {
+      fprintf (stderr, "Invalid value for --read-ahead: expected a number between 0 and %d\n", readAheadMax);
+      return false;
+    }
+    readAhead = static_cast<int> (value);
+  }
+
+  const wchar_t* mapOutputArg = nullptr;
+  if (args.GetOption (L"--map-output", mapOutputArg))
+  {
+    UInt64 value = 0;
+    NWindows::NCOM::CPropVariant emptyProp;
+    if (mapOutputArg && (_wcsicmp (mapOutputArg, L"off") == 0))
+      noMapOutput = true;
+    else if (!mapOutputArg || !NArchive::ParseSizeString (mapOutputArg, emptyProp, 0, value)
+        || (value < (1 << 20)))
+    {
+      fprintf (stderr, "Invalid value for --map-output: expected off or a size of at least 1m\n");
+      return false;
+    }
+    mapOutputMinSize = value;
+  }
+
+  const wchar_t* overwriteArg = nullptr;
+  if (args.GetOption (L"--overwrite", overwriteArg))
+  {
+    if (overwriteArg && (_wcsicmp (overwriteArg, L"in-place") == 0))
+      overwriteInPlace = true;
+    else if (overwriteArg && (_wcsicmp (overwriteArg, L"delete") == 0))
+      overwriteInPlace = false;
+    else
+    {
+      fprintf (stderr, "Invalid value for --overwrite: expected in-place or delete\n");
+      return false;
+    }
+  }
+  return true;
+}
+
+void IoPolicy::Apply (const std::vector<const wchar_t*>& archives, const wchar_t* targetDir) const
+{
+  Profile readProfile = profile;
+  Profile writeProfile = profile;
+  bool slowExtend = false;
+  if (profile == Profile::Auto)
+  {
+    // Reading: the "slowest" device any archive is on decides
+    readProfile = Profile::SSD;
+    for (const wchar_t* archive : archives)
+    {
+      if (IsStdInArchive (archive)) continue;
+      Profile archiveProfile = QueryVolume (ParseArchiveArg (archive).path.Ptr()).profile;
+      if (archiveProfile != Profile::SSD) readProfile = archiveProfile;
+    }
+  }
+  if (targetDir)
+  {
+    VolumeInfo targetInfo = QueryVolume (targetDir);
+    if (profile == Profile::Auto) writeProfile = targetInfo.profile;
+    slowExtend = targetInfo.slowExtend;
+  }
+
+  uint32_t newBufferSize = bufferSize;
+  if (newBufferSize == 0)
+  {
+    if ((readProfile == Profile::HDD) || (writeProfile == Profile::HDD))
+      newBufferSize = bufferSizeHDD;
+    else if ((readProfile == Profile::Network) || (writeProfile == Profile::Network))
+      newBufferSize = bufferSizeNetwork;
+    else
+      newBufferSize = bufferSizeDefault;
+  }
+  g_IoPolicy.SetBufSize (newBufferSize);
+  /* Reading ahead pays off where each read has a noticeable latency.
+   * SSDs answer fast enough for the decoder's own buffering. */
+  if (readAhead >= 0)
+    g_IoPolicy.ReadAheadDepth = readAhead;
+  else
+    g_IoPolicy.ReadAheadDepth = (readProfile != Profile::SSD) ? readAheadDefault : 0;
+  /* Reading mapped memory turns I/O errors into exceptions, and page faults
+   * on network files are slow. */
+  g_IoPolicy.MapStoredData = (readProfile != Profile::Network);
+
+  /* Known slow paths for preallocation:
+   * - FAT: Setting the length zero-fills the file, so every byte is written twice.
+   * - Network shares: Setting the length can be slow or even time out.
+   * Preallocating small files is not worth the extra calls. */
+  g_IoPolicy.PreAllocate = !noPreallocate && !slowExtend && (writeProfile != Profile::Network);
+  g_IoPolicy.PreAllocateMinSize = 1 << 12;
+  g_IoPolicy.OverwriteInPlace = overwriteInPlace;
+  g_IoPolicy.SparseOutput = sparse;
+  /* Mapped output needs preallocation, and is left out where that is slow.
+   * Writing mapped pages to network files is slow as well, and an I/O error
+   * while writing to the mapping is only reported as an exception. */
+  if (noMapOutput || slowExtend || (writeProfile == Profile::Network))
+    g_IoPolicy.MapOutputMinSize = 0;
+  else
+    g_IoPolicy.MapOutputMinSize = (mapOutputMinSize != 0) ? mapOutputMinSize : mapOutputMinSizeDefault;
+}
+
+IoPolicy::VolumeInfo IoPolicy::QueryVolume (const wchar_t* path)
+{
+  VolumeInfo info;
+
+  // Also works for paths that don't exist yet
+  std::vector<wchar_t> volumePath (std::max<size_t> (wcslen (path) + 1, MAX_PATH));
+  if (!GetVolumePathNameW (path, volumePath.data(), static_cast<DWORD> (volumePath.size())))
+    return info;
+
+  if (GetDriveTypeW (volumePath.data()) == DRIVE_REMOTE)
+  {
+    info.profile = Profile::Network;
+    return info;
+  }
+
+  wchar_t fsName[MAX_PATH + 1];
+  if (GetVolumeInformationW (volumePath.data(), nullptr, 0, nullptr, nullptr, nullptr, fsName, MAX_PATH + 1))
+  {
+    info.slowExtend = (_wcsnicmp (fsName, L"FAT", 3) == 0);
+  }
+
+  wchar_t volumeName[MAX_PATH];
+  if (!GetVolumeNameForVolumeMountPointW (volumePath.data(), volumeName, MAX_PATH))
+    return info;
+  // Open volume device itself, not the root directory
+  size_t volumeNameLen = wcslen (volumeName);
+  if ((volumeNameLen > 0) && (volumeName[volumeNameLen - 1] == '\\'))
+    volumeName[volumeNameLen - 1] = 0;
+  HANDLE hVolume = CreateFileW (volumeName, 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                OPEN_EXISTING, 0, nullptr);
+  if (hVolume == INVALID_HANDLE_VALUE)
+  {
+    // Can't tell, assume no seek penalty
+    return info;
+  }
+  STORAGE_PROPERTY_QUERY query = {};
+  query.PropertyId = StorageDeviceSeekPenaltyProperty;
+  query.QueryType = PropertyStandardQuery;
+  DEVICE_SEEK_PENALTY_DESCRIPTOR seekPenalty = {};
+  DWORD bytesReturned = 0;
+  if (DeviceIoControl (hVolume, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof (query),
+                       &seekPenalty, sizeof (seekPenalty), &bytesReturned, nullptr)
+      && (bytesReturned >= sizeof (seekPenalty))
+      && seekPenalty.IncursSeekPenalty)
+  {
+    info.profile = Profile::HDD;
+  }
+  CloseHandle (hVolume);
+  return info;
+}
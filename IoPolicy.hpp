@@ -0,0 +1,90 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * I/O buffer sizes and access hints
+ */
+#ifndef SEVENI_IOPOLICY_HPP_
+#define SEVENI_IOPOLICY_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+class ArgsHelper;
+
+/**
+ * Chooses buffer sizes, access hints and file preallocation for extraction.
+ * Settings depend on the kind of device archives and the target directory
+ * are on; the \c --io-profile, \c --io-buffer and \c --no-preallocate options
+ * override the detection. \c --overwrite picks how existing files are replaced,
+ * \c --sparse leaves runs of zeros in output files as holes, \c --map-output
+ * sets the size from which files are written through a file mapping,
+ * \c --read-ahead the number of buffers of archive data read in advance.
+ */
+class IoPolicy
+{
+public:
+  enum struct Profile { Auto, SSD, HDD, Network };
+
+  /// Parse I/O options. Prints a message and returns false if an option is invalid.
+  bool Init (const ArgsHelper& args);
+
+  /**
+   * Pick settings for extracting the given archives to the target directory.
+   * Settings take effect for all archives opened and files written afterwards.
+   */
+  void Apply (const std::vector<const wchar_t*>& archives, const wchar_t* targetDir) const;
+private:
+  Profile profile = Profile::Auto;
+  /// Explicitly given buffer size, 0 if none
+  uint32_t bufferSize = 0;
+  bool noPreallocate = false;
+  /// Whether existing files are rewritten in place instead of deleted first
+  bool overwriteInPlace = true;
+  bool sparse = false;
+  /// Explicitly given minimum size for mapped output, 0 if none
+  uint64_t mapOutputMinSize = 0;
+  /// Whether mapped output was turned off
+  bool noMapOutput = false;
+  /// Explicitly given read-ahead depth, -1 if none
+  int readAhead = -1;
+
+  /// Information about the volume a path is on
+  struct VolumeInfo
+  {
+    Profile profile = Profile::SSD;
+    /// Whether the file system has no cheap way to extend files (FAT)
+    bool slowExtend = false;
+  };
+  static VolumeInfo QueryVolume (const wchar_t* path);
+};
+
+#endif // SEVENI_IOPOLICY_HPP_
@@ -31,6 +31,7 @@
 #include "IsSFX.hpp"
 
 #include "Paths.hpp"
+#include "SfxLocator.hpp"
 
 #include "7z.h"
 #include "7zCrc.h"
@@ -84,29 +85,77 @@ static bool FindSignature (HANDLE file, uint64_t& resPos)
   }
 }
 
+static bool SeekTo (HANDLE file, uint64_t pos)
+{
+  LARGE_INTEGER li;
+  li.QuadPart = static_cast<LONGLONG> (pos);
+  return SetFilePointerEx (file, li, nullptr, FILE_BEGIN) != 0;
+}
+
+static bool ReadAt (HANDLE file, uint64_t pos, void* data, DWORD size)
+{
+  DWORD bytesRead = 0;
+  return SeekTo (file, pos)
+    && ReadFile (file, data, size, &bytesRead, nullptr)
+    && (bytesRead == size);
+}
+
+// Check for a locator trailer, which saves searching for the archive signature
+static bool FindLocator (HANDLE file, SfxLocator& locator)
+{
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx (file, &fileSize) || (fileSize.QuadPart < static_cast<LONGLONG> (SfxLocator::size)))
+    return false;
+
+  uint8_t data[SfxLocator::size];
+  if (!ReadAt (file, fileSize.QuadPart - SfxLocator::size, data, sizeof (data))) return false;
+  if (!locator.Read (data, fileSize.QuadPart)) return false;
+
+  // Make sure the locator actually points to an archive
+  uint8_t header[k7zStartHeaderSize];
+  if (!ReadAt (file, locator.archiveOffset, header, sizeof (header))) return false;
+  if ((memcmp (header, k7zSignature, k7zSignatureSize) != 0) || (CrcCalc (header + 12, 20) != GetUi32(header + 8)))
+    return false;
+  return true;
+}
+
 static MyUString cached_exe_path;
 static bool cached_sfx_result;
+static bool cached_sfx_locator;
+static SfxLocator cached_locator;
 
-bool IsSFX (MyUString& exePath)
+bool IsSFX (MyUString& exePath, ArchiveRange* payload)
 {
   auto this_exe_path = GetExePath();
 
   if (this_exe_path != cached_exe_path)
   {
     bool sfx_res = false;
+    bool sfx_locator = false;
+    SfxLocator locator;
     HANDLE file = CreateFileW (this_exe_path.Ptr(), GENERIC_READ, FILE_SHARE_READ,
                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
     if (file != INVALID_HANDLE_VALUE)
     {
       uint64_t sig_pos;
-      sfx_res = FindSignature (file, sig_pos);
+      sfx_locator = FindLocator (file, locator);
+      sfx_res = sfx_locator || (SeekTo (file, 0) && FindSignature (file, sig_pos));
       CloseHandle (file);
     }
 
     cached_exe_path = this_exe_path;
     cached_sfx_result = sfx_res;
+    cached_sfx_locator = sfx_locator;
+    cached_locator = locator;
   }
 
   if (cached_sfx_result) exePath = this_exe_path;
+  if (payload && cached_sfx_result && cached_sfx_locator)
+  {
+    payload->path = this_exe_path;
+    payload->isRange = true;
+    payload->offset = cached_locator.archiveOffset;
+    payload->length = cached_locator.archiveSize;
+  }
   return cached_sfx_result;
 }
@@ -34,12 +34,15 @@
 #ifndef __7I_ISSFX_HPP__
 #define __7I_ISSFX_HPP__
 
+#include "ArchiveRange.hpp"
 #include "MyUString.hpp"
 
 /**
  * Check if executable module is an SFX (has attached archive).
  * \param exePath Receives path of executable if it is an SFX.
+ * \param payload Optionally receives the range of the archive, if it is
+ *   followed by a locator trailer (see SfxLocator). Left alone otherwise.
  */
-bool IsSFX (MyUString& exePath);
+bool IsSFX (MyUString& exePath, ArchiveRange* payload = nullptr);
 
 #endif // __7I_ISSFX_HPP__
@@ -30,6 +30,8 @@
 
 #include "LogFile.hpp"
 
+#include "support/printf.hpp"
+
 #include <windows.h>
 
 int InitLogFile (const wchar_t* log_file)
@@ -48,5 +50,8 @@ int InitLogFile (const wchar_t* log_file)
   {
     return HRESULT_FROM_WIN32(GetLastError());
   }
+  // Per-item output can be plenty, so don't write every line individually.
+  // Not fatal if it fails, output will just be unbuffered.
+  BufferHandleOutput (file);
   return 0;
 }
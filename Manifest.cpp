@@ -0,0 +1,254 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "Manifest.hpp"
+
+#include "Error.hpp"
+#include "InstalledFiles.hpp"
+#include "ProgressReporter.hpp"
+#include "ResourceGovernor.hpp"
+
+#include "Windows/Thread.h"
+
+#include "7zCrc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Read size per request; large sequential reads keep the disk streaming
+static const size_t hashBufferSize = 4 << 20;
+
+static void HashFile (const wchar_t* path, FileHash& hash, Byte* buffer)
+{
+  // Backup semantics allow opening directories
+  HANDLE file = CreateFileW (path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    hash.error = GetLastError ();
+    return;
+  }
+
+  BY_HANDLE_FILE_INFORMATION info;
+  if (!GetFileInformationByHandle (file, &info))
+  {
+    hash.error = GetLastError ();
+    CloseHandle (file);
+    return;
+  }
+  hash.size = (static_cast<uint64_t> (info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+  hash.mTime = (static_cast<uint64_t> (info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+  hash.isDir = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+  if (!hash.isDir)
+  {
+    CBlake2sp blake;
+    Blake2sp_Init (&blake);
+    UInt32 crc = CRC_INIT_VAL;
+    while (true)
+    {
+      DWORD bytesRead = 0;
+      if (!ReadFile (file, buffer, static_cast<DWORD> (hashBufferSize), &bytesRead, nullptr))
+      {
+        hash.error = GetLastError ();
+        break;
+      }
+      if (bytesRead == 0) break;
+      Blake2sp_Update (&blake, buffer, bytesRead);
+      crc = CrcUpdate (crc, buffer, bytesRead);
+    }
+    Blake2sp_Final (&blake, hash.digest);
+    hash.crc = CRC_GET_DIGEST (crc);
+  }
+  CloseHandle (file);
+}
+
+namespace
+{
+  /// State shared by the hashing workers
+  struct HashJob
+  {
+    const std::vector<MyUString>& paths;
+    std::vector<FileHash>& hashes;
+    std::atomic<size_t> next { 0 };
+    std::atomic<size_t> done { 0 };
+    std::atomic<bool> cancel { false };
+
+    HashJob (const std::vector<MyUString>& paths, std::vector<FileHash>& hashes)
+      : paths (paths), hashes (hashes) {}
+
+    void Work ()
+    {
+      std::unique_ptr<Byte[]> buffer (new Byte[hashBufferSize]);
+      while (!cancel)
+      {
+        size_t index = next++;
+        if (index >= paths.size ()) break;
+        HashFile (paths[index].Ptr(), hashes[index], buffer.get());
+        ++done;
+      }
+    }
+
+    static THREAD_FUNC_DECL WorkerFunc (void* param)
+    {
+      reinterpret_cast<HashJob*> (param)->Work ();
+      return 0;
+    }
+  };
+} // anonymous namespace
+
+std::vector<FileHash> HashFiles (const std::vector<MyUString>& paths,
+                                 const ResourceGovernor& governor,
+                                 ProgressReporter& progress)
+{
+  std::vector<FileHash> hashes (paths.size ());
+  HashJob job (paths, hashes);
+
+  size_t numWorkers = std::min<size_t> (governor.GetWorkerCount (hashBufferSize), paths.size ());
+  numWorkers = std::min<size_t> (numWorkers, MAXIMUM_WAIT_OBJECTS);
+  std::vector<NWindows::CThread> workers (numWorkers);
+  std::vector<HANDLE> workerHandles;
+  for (auto& worker : workers)
+  {
+    if (worker.Create (HashJob::WorkerFunc, &job) != 0) break;
+    workerHandles.push_back (worker);
+  }
+  // Can't start threads? Do it ourselves.
+  if (workerHandles.empty ())
+  {
+    job.Work ();
+    return hashes;
+  }
+
+  progress.SetTotal (paths.size ());
+  while (WaitForMultipleObjects (static_cast<DWORD> (workerHandles.size ()), workerHandles.data (), TRUE, 100) == WAIT_TIMEOUT)
+  {
+    if (progress.SetCompleted (job.done) == ProgressReporter::Processing::Cancel)
+      job.cancel = true;
+  }
+  progress.SetCompleted (job.done);
+  if (job.cancel) THROW_HR(E_ABORT);
+
+  return hashes;
+}
+
+void WriteManifest (const wchar_t* manifestPath,
+                    const std::vector<MyUString>& paths,
+                    const std::vector<FileHash>& hashes)
+{
+  // A manifest is an installed files list with some fields in front of the path
+  InstalledFilesWriter writer (manifestPath);
+  try
+  {
+    for (size_t i = 0; i < paths.size (); i++)
+    {
+      const auto& hash = hashes[i];
+      if (hash.isDir || (hash.error != ERROR_SUCCESS)) continue;
+
+      // Line format: <digest> <size> <mtime> <crc> <path>
+      wchar_t fields[sizeof (hash.digest) * 2 + 64];
+      for (size_t d = 0; d < sizeof (hash.digest); d++)
+        _snwprintf_s (fields + d * 2, 3, _TRUNCATE, L"%02x", hash.digest[d]);
+      _snwprintf_s (fields + sizeof (hash.digest) * 2, _countof (fields) - sizeof (hash.digest) * 2, _TRUNCATE,
+                    L" %llu %016llx %08x ", hash.size, hash.mTime, hash.crc);
+      MyUString line (fields);
+      line += paths[i];
+      writer.AddEntry (line);
+    }
+  }
+  catch (...)
+  {
+    writer.Discard ();
+    throw;
+  }
+}
+
+static bool ParseHexDigit (wchar_t c, uint8_t& value)
+{
+  if ((c >= '0') && (c <= '9'))
+    value = static_cast<uint8_t> (c - '0');
+  else if ((c >= 'a') && (c <= 'f'))
+    value = static_cast<uint8_t> (c - 'a' + 10);
+  else
+    return false;
+  return true;
+}
+
+static bool ParseManifestLine (const MyUString& line, ManifestEntry& entry)
+{
+  const wchar_t* p = line.Ptr();
+  for (size_t d = 0; d < sizeof (entry.hash.digest); d++)
+  {
+    uint8_t hi, lo;
+    if (!ParseHexDigit (p[0], hi) || !ParseHexDigit (p[1], lo)) return false;
+    entry.hash.digest[d] = static_cast<uint8_t> ((hi << 4) | lo);
+    p += 2;
+  }
+  if (*p++ != ' ') return false;
+
+  wchar_t* end = nullptr;
+  entry.hash.size = _wcstoui64 (p, &end, 10);
+  if ((end == p) || (*end != ' ')) return false;
+  p = end + 1;
+  entry.hash.mTime = _wcstoui64 (p, &end, 16);
+  if ((end == p) || (*end != ' ')) return false;
+  p = end + 1;
+  for (size_t d = 0; d < 8; d++)
+  {
+    uint8_t digit;
+    if (!ParseHexDigit (p[d], digit)) return false;
+    entry.hash.crc = (entry.hash.crc << 4) | digit;
+  }
+  p += 8;
+  if (*p++ != ' ') return false;
+  if (*p == 0) return false;
+
+  entry.path = p;
+  return true;
+}
+
+std::vector<ManifestEntry> ReadManifest (const wchar_t* manifestPath)
+{
+  std::vector<ManifestEntry> entries;
+  InstalledFilesReader reader (manifestPath);
+  MyUString line;
+  while (!(line = reader.GetFileName()).IsEmpty())
+  {
+    ManifestEntry entry;
+    if (ParseManifestLine (line, entry))
+      entries.emplace_back (std::move (entry));
+    else
+      fprintf (stderr, "Ignoring malformed manifest line: %ls\n", line.Ptr());
+  }
+  return entries;
+}
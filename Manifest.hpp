@@ -0,0 +1,87 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Installation manifest: size, modification time and content hash of installed files
+ */
+#ifndef SEVENI_MANIFEST_HPP_
+#define SEVENI_MANIFEST_HPP_
+
+#include "MyUString.hpp"
+
+#include "Blake2.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <Windows.h>
+
+class ResourceGovernor;
+struct ProgressReporter;
+
+/// State of a file, as recorded in the manifest
+struct FileHash
+{
+  /// Error opening or reading the file
+  DWORD error = ERROR_SUCCESS;
+  bool isDir = false;
+  uint64_t size = 0;
+  uint64_t mTime = 0;
+  /// BLAKE2sp digest of the content
+  uint8_t digest[BLAKE2S_DIGEST_SIZE] = {};
+  /// CRC32 of the content, for comparison against archive items
+  uint32_t crc = 0;
+};
+
+/**
+ * Hash files on a pool of worker threads, with large sequential reads.
+ * The number of workers is picked by the resource governor.
+ * Returns a hash for each path, in the same order.
+ */
+std::vector<FileHash> HashFiles (const std::vector<MyUString>& paths,
+                                 const ResourceGovernor& governor,
+                                 ProgressReporter& progress);
+
+/// An entry read from a manifest
+struct ManifestEntry
+{
+  MyUString path;
+  FileHash hash;
+};
+
+/// Write a manifest. Directories and files that could not be hashed are left out.
+void WriteManifest (const wchar_t* manifestPath,
+                    const std::vector<MyUString>& paths,
+                    const std::vector<FileHash>& hashes);
+/// Read a manifest. Throws if it can't be opened.
+std::vector<ManifestEntry> ReadManifest (const wchar_t* manifestPath);
+
+#endif // SEVENI_MANIFEST_HPP_
@@ -0,0 +1,96 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "Patch.hpp"
+
+#include <string.h>
+
+const wchar_t patchItemDir[] = L".sipatch";
+
+static const uint8_t patchSignature[8] = { '7', 'i', 'P', 'a', 't', 'c', 'h', '1' };
+
+static void SetUi32 (uint8_t* p, uint32_t v)
+{
+  for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t> (v >> (i * 8));
+}
+
+static void SetUi64 (uint8_t* p, uint64_t v)
+{
+  for (int i = 0; i < 8; i++) p[i] = static_cast<uint8_t> (v >> (i * 8));
+}
+
+static uint32_t GetUi32 (const uint8_t* p)
+{
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+static uint64_t GetUi64 (const uint8_t* p)
+{
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+void PatchHeader::Write (uint8_t (&data)[size]) const
+{
+  memcpy (data, patchSignature, sizeof (patchSignature));
+  SetUi64 (data + 8, sourceSize);
+  SetUi32 (data + 16, sourceCrc);
+  SetUi64 (data + 20, targetSize);
+  SetUi32 (data + 28, targetCrc);
+}
+
+bool PatchHeader::Read (const uint8_t (&data)[size])
+{
+  if (memcmp (data, patchSignature, sizeof (patchSignature)) != 0) return false;
+  sourceSize = GetUi64 (data + 8);
+  sourceCrc = GetUi32 (data + 16);
+  targetSize = GetUi64 (data + 20);
+  targetCrc = GetUi32 (data + 28);
+  return true;
+}
+
+void PatchInstruction::Write (uint8_t (&data)[size]) const
+{
+  data[0] = op;
+  SetUi64 (data + 1, offset);
+  SetUi64 (data + 9, length);
+}
+
+bool PatchInstruction::Read (const uint8_t (&data)[size])
+{
+  if (data[0] > Add) return false;
+  op = static_cast<Op> (data[0]);
+  offset = GetUi64 (data + 1);
+  length = GetUi64 (data + 9);
+  return true;
+}
@@ -0,0 +1,97 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Binary patch format, shared by the packer and the installer
+ */
+#ifndef SEVENI_PATCH_HPP_
+#define SEVENI_PATCH_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Archive items below this top-level directory are patches: the rest of
+ * the item path is the file the patch applies to. They are never extracted
+ * as files themselves.
+ */
+extern const wchar_t patchItemDir[];
+
+/**
+ * Header of a patch. A patch turns one specific installed file (the source)
+ * into a new version (the target); both are identified by size and CRC32.
+ * The header is followed by instructions (see PatchInstruction).
+ * All values are little endian.
+ */
+struct PatchHeader
+{
+  /// Size of the serialized header
+  static const size_t size = 32;
+
+  uint64_t sourceSize = 0;
+  uint32_t sourceCrc = 0;
+  uint64_t targetSize = 0;
+  uint32_t targetCrc = 0;
+
+  /// Serialize
+  void Write (uint8_t (&data)[size]) const;
+  /// Deserialize. Returns false if \a data is not a patch header.
+  bool Read (const uint8_t (&data)[size]);
+};
+
+/**
+ * Patch instruction, in the style of VCDIFF: the target is built front to
+ * back, from ranges copied from the source and data added by the patch.
+ */
+struct PatchInstruction
+{
+  /// Size of the serialized instruction
+  static const size_t size = 17;
+
+  enum Op : uint8_t
+  {
+    /// Target is complete
+    End = 0,
+    /// Append \a length bytes of the source, starting at \a offset
+    Copy = 1,
+    /// Append the \a length bytes following the instruction
+    Add = 2
+  };
+  Op op = End;
+  uint64_t offset = 0;
+  uint64_t length = 0;
+
+  /// Serialize
+  void Write (uint8_t (&data)[size]) const;
+  /// Deserialize. Returns false on an unknown operation.
+  bool Read (const uint8_t (&data)[size]);
+};
+
+#endif // SEVENI_PATCH_HPP_
@@ -0,0 +1,535 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "PatchApply.hpp"
+
+#include "Error.hpp"
+#include "Patch.hpp"
+
+#include "7zCrc.h"
+
+#include "Common/MyCom.h"
+#include "Windows/FileDir.h"
+#include "Windows/FileFind.h"
+#include "Windows/FileIO.h"
+#include "7zip/Archive/IArchive.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+
+#include <stdio.h>
+
+using namespace NWindows::NFile;
+
+// Buffer size for reading the installed file
+static const UInt32 copyBufferSize = 1 << 20;
+// Suffix of the file a target is rebuilt in
+static const FChar tempSuffix[] = FTEXT(".sipatch~");
+// Suffix a read-only installed file is renamed to while it is replaced
+static const FChar asideSuffix[] = FTEXT(".sipatch-old");
+
+namespace
+{
+  /**
+   * Receives a patch item from the decoder and writes the target it
+   * describes to a temporary file, copying from the installed file as
+   * instructed.
+   */
+  class PatchOutStream : public ISequentialOutStream, public CMyUnknownImp
+  {
+  public:
+    MY_UNKNOWN_IMP1(ISequentialOutStream)
+
+    PatchOutStream (const FString& targetPath);
+    ~PatchOutStream ();
+
+    STDMETHOD(Write)(const void* data, UInt32 size, UInt32* processedSize);
+
+    /**
+     * Verify the target after all patch data was written, and replace the
+     * installed file with it. \a dataOk tells whether decoding succeeded.
+     */
+    PatchResult Finish (bool dataOk);
+    /// Error code for PatchResult::Failed
+    DWORD GetError () const { return error; }
+  private:
+    FString targetPath;
+    FString tempPath;
+    NIO::CInFile source;
+    NIO::COutFile temp;
+    bool tempCreated = false;
+    std::unique_ptr<Byte[]> copyBuffer;
+
+    enum class State { Header, Instruction, AddData, End, Ignore };
+    State state = State::Header;
+    /// Result, if it was decided before the end of the patch data
+    std::optional<PatchResult> outcome;
+    DWORD error = ERROR_SUCCESS;
+
+    Byte headerData[PatchHeader::size];
+    size_t headerFill = 0;
+    PatchHeader header;
+    Byte instructionData[PatchInstruction::size];
+    size_t instructionFill = 0;
+    UInt64 addRemaining = 0;
+    UInt64 written = 0;
+    UInt32 crc = CRC_INIT_VAL;
+
+    void Settle (PatchResult result);
+    void SettleError ();
+    void StartPatch ();
+    void ExecuteInstruction ();
+    bool ComputeSourceCrc (UInt32& sourceCrc);
+    bool WriteTarget (const void* data, UInt32 size);
+    bool CopySource (UInt64 offset, UInt64 length);
+    /// Move the temporary file over the installed file
+    bool ReplaceTarget ();
+  };
+} // anonymous namespace
+
+PatchOutStream::PatchOutStream (const FString& targetPath)
+  : targetPath (targetPath), tempPath (targetPath + tempSuffix),
+    copyBuffer (new Byte[copyBufferSize])
+{
+}
+
+PatchOutStream::~PatchOutStream ()
+{
+  if (tempCreated)
+  {
+    temp.Close ();
+    NDir::DeleteFileAlways (tempPath);
+  }
+}
+
+void PatchOutStream::Settle (PatchResult result)
+{
+  outcome = result;
+  state = State::Ignore;
+}
+
+void PatchOutStream::SettleError ()
+{
+  error = GetLastError ();
+  Settle (PatchResult::Failed);
+}
+
+bool PatchOutStream::ComputeSourceCrc (UInt32& sourceCrc)
+{
+  if (!source.SeekToBegin ()) return false;
+  UInt32 crcValue = CRC_INIT_VAL;
+  for (;;)
+  {
+    UInt32 processed = 0;
+    if (!source.Read (copyBuffer.get(), copyBufferSize, processed)) return false;
+    if (processed == 0) break;
+    crcValue = CrcUpdate (crcValue, copyBuffer.get(), processed);
+  }
+  sourceCrc = CRC_GET_DIGEST (crcValue);
+  return true;
+}
+
+void PatchOutStream::StartPatch ()
+{
+  if (!source.Open (targetPath))
+  {
+    Settle (PatchResult::SourceMismatch);
+    return;
+  }
+  UInt64 size = 0;
+  if (!source.GetLength (size))
+  {
+    SettleError ();
+    return;
+  }
+  // Cheap check first; the CRC needs a full read
+  bool maybeTarget = (size == header.targetSize);
+  bool maybeSource = (size == header.sourceSize);
+  if (!maybeTarget && !maybeSource)
+  {
+    Settle (PatchResult::SourceMismatch);
+    return;
+  }
+  UInt32 sourceCrc = 0;
+  if (!ComputeSourceCrc (sourceCrc))
+  {
+    SettleError ();
+    return;
+  }
+  // A resumed install may have patched the file before
+  if (maybeTarget && (sourceCrc == header.targetCrc))
+  {
+    Settle (PatchResult::UpToDate);
+    return;
+  }
+  if (!maybeSource || (sourceCrc != header.sourceCrc))
+  {
+    Settle (PatchResult::SourceMismatch);
+    return;
+  }
+
+  if (!temp.Create (tempPath, true))
+  {
+    SettleError ();
+    return;
+  }
+  tempCreated = true;
+  state = State::Instruction;
+}
+
+void PatchOutStream::ExecuteInstruction ()
+{
+  PatchInstruction instruction;
+  if (!instruction.Read (instructionData))
+  {
+    Settle (PatchResult::Corrupt);
+    return;
+  }
+  UInt64 targetLeft = header.targetSize - written;
+  switch (instruction.op)
+  {
+  case PatchInstruction::End:
+    state = State::End;
+    break;
+  case PatchInstruction::Copy:
+    if ((instruction.offset > header.sourceSize) || (instruction.length > header.sourceSize - instruction.offset)
+        || (instruction.length > targetLeft))
+      Settle (PatchResult::Corrupt);
+    else if (!CopySource (instruction.offset, instruction.length))
+      SettleError ();
+    break;
+  case PatchInstruction::Add:
+    if (instruction.length > targetLeft)
+      Settle (PatchResult::Corrupt);
+    else if (instruction.length > 0)
+    {
+      addRemaining = instruction.length;
+      state = State::AddData;
+    }
+    break;
+  }
+}
+
+bool PatchOutStream::WriteTarget (const void* data, UInt32 size)
+{
+  UInt32 processed = 0;
+  if (!temp.Write (data, size, processed)) return false;
+  if (processed != size)
+  {
+    SetLastError (ERROR_WRITE_FAULT);
+    return false;
+  }
+  crc = CrcUpdate (crc, data, size);
+  written += size;
+  return true;
+}
+
+bool PatchOutStream::CopySource (UInt64 offset, UInt64 length)
+{
+  UInt64 newPosition = 0;
+  if (!source.Seek (offset, newPosition)) return false;
+  while (length > 0)
+  {
+    UInt32 chunk = static_cast<UInt32> (std::min<UInt64> (length, copyBufferSize));
+    UInt32 processed = 0;
+    if (!source.Read (copyBuffer.get(), chunk, processed)) return false;
+    if (processed != chunk)
+    {
+      // The installed file was checked to be large enough; it changed since
+      SetLastError (ERROR_HANDLE_EOF);
+      return false;
+    }
+    if (!WriteTarget (copyBuffer.get(), chunk)) return false;
+    length -= chunk;
+  }
+  return true;
+}
+
+STDMETHODIMP PatchOutStream::Write (const void* data, UInt32 size, UInt32* processedSize)
+{
+  // Everything is consumed, even if the patch is not applied, so decoding goes on
+  if (processedSize) *processedSize = size;
+  const Byte* p = static_cast<const Byte*> (data);
+  while ((size > 0) && (state != State::Ignore))
+  {
+    switch (state)
+    {
+    case State::Header:
+      {
+        UInt32 n = std::min<UInt32> (size, static_cast<UInt32> (PatchHeader::size - headerFill));
+        memcpy (headerData + headerFill, p, n);
+        headerFill += n;
+        p += n;
+        size -= n;
+        if (headerFill == PatchHeader::size)
+        {
+          if (header.Read (headerData))
+            StartPatch ();
+          else
+            Settle (PatchResult::Corrupt);
+        }
+      }
+      break;
+    case State::Instruction:
+      {
+        UInt32 n = std::min<UInt32> (size, static_cast<UInt32> (PatchInstruction::size - instructionFill));
+        memcpy (instructionData + instructionFill, p, n);
+        instructionFill += n;
+        p += n;
+        size -= n;
+        if (instructionFill == PatchInstruction::size)
+        {
+          instructionFill = 0;
+          ExecuteInstruction ();
+        }
+      }
+      break;
+    case State::AddData:
+      {
+        UInt32 n = static_cast<UInt32> (std::min<UInt64> (size, addRemaining));
+        if (!WriteTarget (p, n))
+        {
+          SettleError ();
+          break;
+        }
+        p += n;
+        size -= n;
+        addRemaining -= n;
+        if (addRemaining == 0) state = State::Instruction;
+      }
+      break;
+    case State::End:
+      // Data after the end
+      Settle (PatchResult::Corrupt);
+      break;
+    case State::Ignore:
+      break;
+    }
+  }
+  return S_OK;
+}
+
+/* Remove a link of a read-only file, leaving the attribute of the file
+ * alone: with --dedup, other installations may link to the same file. */
+static bool DeleteReadOnlyLink (const FString& path)
+{
+  HANDLE file = CreateFileW (fs2us (path), DELETE | FILE_READ_ATTRIBUTES | FILE_WRITE_ATTRIBUTES,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, 0, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  FILE_BASIC_INFO basic;
+  bool result = false;
+  if (GetFileInformationByHandleEx (file, FileBasicInfo, &basic, sizeof (basic)))
+  {
+    // Only a file that is not read-only can be marked for deletion
+    DWORD attrib = basic.FileAttributes;
+    basic.FileAttributes = attrib & ~FILE_ATTRIBUTE_READONLY;
+    if (basic.FileAttributes == 0) basic.FileAttributes = FILE_ATTRIBUTE_NORMAL;
+    if (SetFileInformationByHandle (file, FileBasicInfo, &basic, sizeof (basic)))
+    {
+      FILE_DISPOSITION_INFO disposition;
+      disposition.DeleteFile = TRUE;
+      result = SetFileInformationByHandle (file, FileDispositionInfo, &disposition, sizeof (disposition)) != FALSE;
+      // The file lives on if there are other links: give it its attribute back
+      basic.FileAttributes = attrib;
+      SetFileInformationByHandle (file, FileBasicInfo, &basic, sizeof (basic));
+    }
+  }
+  CloseHandle (file);
+  return result;
+}
+
+bool PatchOutStream::ReplaceTarget ()
+{
+  DWORD attrib = GetFileAttributesW (fs2us (targetPath));
+  if ((attrib == INVALID_FILE_ATTRIBUTES) || ((attrib & FILE_ATTRIBUTE_READONLY) == 0))
+    return MoveFileExW (fs2us (tempPath), fs2us (targetPath), MOVEFILE_REPLACE_EXISTING) != FALSE;
+
+  /* A read-only file can't be replaced, but it can be renamed. Clearing the
+   * attribute instead would clear it for all links of the file.
+   * Attributes from the archive are applied to the new file afterwards. */
+  FString asidePath (targetPath + asideSuffix);
+  if (!MoveFileExW (fs2us (targetPath), fs2us (asidePath), MOVEFILE_REPLACE_EXISTING)) return false;
+  if (!MoveFileExW (fs2us (tempPath), fs2us (targetPath), 0))
+  {
+    DWORD moveError = GetLastError ();
+    MoveFileExW (fs2us (asidePath), fs2us (targetPath), 0);
+    SetLastError (moveError);
+    return false;
+  }
+  // If this fails, the file is left for the next attempt to clean up
+  DeleteReadOnlyLink (asidePath);
+  return true;
+}
+
+PatchResult PatchOutStream::Finish (bool dataOk)
+{
+  PatchResult result;
+  if (outcome)
+    result = *outcome;
+  else if (!dataOk || (state != State::End)
+           || (written != header.targetSize) || (CRC_GET_DIGEST (crc) != header.targetCrc))
+    result = PatchResult::Corrupt;
+  else
+    result = PatchResult::Applied;
+
+  source.Close ();
+  if (tempCreated)
+  {
+    if (!temp.Close () && (result == PatchResult::Applied))
+    {
+      error = GetLastError ();
+      result = PatchResult::Failed;
+    }
+    if (result == PatchResult::Applied)
+    {
+      if (ReplaceTarget ())
+        tempCreated = false;
+      else
+      {
+        error = GetLastError ();
+        result = PatchResult::Failed;
+      }
+    }
+    if (tempCreated)
+    {
+      NDir::DeleteFileAlways (tempPath);
+      tempCreated = false;
+    }
+  }
+  return result;
+}
+
+namespace
+{
+  /// Supplies patch streams to the archive handler
+  class PatchExtractCallback : public IArchiveExtractCallback, public CMyUnknownImp
+  {
+  public:
+    MY_UNKNOWN_IMP1(IArchiveExtractCallback)
+
+    PatchExtractCallback (const CRecordVector<UInt32>& indices,
+                          const std::vector<FString>& targets,
+                          std::vector<PatchResult>& results,
+                          IProgress* progress)
+      : indices (indices), targets (targets), results (results), progress (progress) {}
+
+    INTERFACE_IArchiveExtractCallback(;)
+  private:
+    const CRecordVector<UInt32>& indices;
+    const std::vector<FString>& targets;
+    std::vector<PatchResult>& results;
+    IProgress* progress;
+    PatchOutStream* currentSpec = nullptr;
+    CMyComPtr<ISequentialOutStream> current;
+    unsigned currentPos = 0;
+  };
+} // anonymous namespace
+
+STDMETHODIMP PatchExtractCallback::SetTotal (UInt64 total)
+{
+  return progress ? progress->SetTotal (total) : S_OK;
+}
+
+STDMETHODIMP PatchExtractCallback::SetCompleted (const UInt64* completeValue)
+{
+  return progress ? progress->SetCompleted (completeValue) : S_OK;
+}
+
+STDMETHODIMP PatchExtractCallback::GetStream (UInt32 index, ISequentialOutStream** outStream, Int32 askExtractMode)
+{
+  *outStream = nullptr;
+  currentSpec = nullptr;
+  current.Release ();
+  if (askExtractMode != NArchive::NExtract::NAskMode::kExtract) return S_OK;
+
+  const UInt32* begin = &indices.Front ();
+  const UInt32* end = begin + indices.Size ();
+  const UInt32* it = std::lower_bound (begin, end, index);
+  if ((it == end) || (*it != index)) return S_OK;
+  currentPos = static_cast<unsigned> (it - begin);
+
+  currentSpec = new PatchOutStream (targets[currentPos]);
+  current = currentSpec;
+  *outStream = current;
+  current->AddRef ();
+  return S_OK;
+}
+
+STDMETHODIMP PatchExtractCallback::PrepareOperation (Int32 /*askExtractMode*/)
+{
+  return S_OK;
+}
+
+STDMETHODIMP PatchExtractCallback::SetOperationResult (Int32 opRes)
+{
+  if (!currentSpec) return S_OK;
+  PatchResult result = currentSpec->Finish (opRes == NArchive::NExtract::NOperationResult::kOK);
+  results[currentPos] = result;
+  UString target (fs2us (targets[currentPos]));
+  switch (result)
+  {
+  case PatchResult::Applied:
+  case PatchResult::UpToDate:
+    break;
+  case PatchResult::SourceMismatch:
+    fprintf (stderr, "Patch for %ls does not apply: the installed file is not the patch source\n", target.Ptr());
+    break;
+  case PatchResult::Corrupt:
+    fprintf (stderr, "Patch for %ls is broken\n", target.Ptr());
+    break;
+  case PatchResult::Failed:
+    fprintf (stderr, "Error patching %ls: %ls\n", target.Ptr(), GetErrorString (currentSpec->GetError ()).Ptr());
+    break;
+  }
+  currentSpec = nullptr;
+  current.Release ();
+  return S_OK;
+}
+
+HRESULT ApplyPatches (IInArchive* archive,
+                      const CRecordVector<UInt32>& indices,
+                      const std::vector<FString>& targets,
+                      IProgress* progress,
+                      std::vector<PatchResult>& results)
+{
+  results.assign (indices.Size (), PatchResult::Failed);
+  if (indices.Size () == 0) return S_OK;
+  // Left behind by an attempt that was interrupted while patching
+  for (const auto& target : targets)
+  {
+    NDir::DeleteFileAlways (target + tempSuffix);
+    FString asidePath (target + asideSuffix);
+    if (NFind::DoesFileExist (asidePath)) DeleteReadOnlyLink (asidePath);
+  }
+  PatchExtractCallback* callbackSpec = new PatchExtractCallback (indices, targets, results, progress);
+  CMyComPtr<IArchiveExtractCallback> callback (callbackSpec);
+  return archive->Extract (&indices.Front (), indices.Size (), 0, callback);
+}
@@ -0,0 +1,76 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Applying patch items to installed files
+ */
+#ifndef SEVENI_PATCHAPPLY_HPP_
+#define SEVENI_PATCHAPPLY_HPP_
+
+#include "Common/Common.h"
+#include "Common/MyString.h"
+#include "Common/MyVector.h"
+
+#include <vector>
+
+struct IInArchive;
+struct IProgress;
+
+/// Outcome of applying a patch item
+enum struct PatchResult
+{
+  /// Target was rebuilt from the installed file
+  Applied,
+  /// Installed file is the target already
+  UpToDate,
+  /// Installed file is missing or not the patch source
+  SourceMismatch,
+  /// Patch data is broken, or didn't produce the target
+  Corrupt,
+  /// Reading or writing files failed
+  Failed
+};
+
+/**
+ * Apply the patch items \a indices of \a archive to the files \a targets.
+ * A target is rebuilt from the installed file and the patch into a temporary
+ * file next to it, which then replaces the installed file; the installed
+ * file stays as it is if anything goes wrong. Problems are printed, the
+ * result for each item is returned in \a results. Temporary files left by an
+ * interrupted earlier attempt are removed first.
+ * Progress is reported to \a progress, which may also cancel.
+ */
+HRESULT ApplyPatches (IInArchive* archive,
+                      const CRecordVector<UInt32>& indices,
+                      const std::vector<FString>& targets,
+                      IProgress* progress,
+                      std::vector<PatchResult>& results);
+
+#endif // SEVENI_PATCHAPPLY_HPP_
@@ -0,0 +1,343 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "PathSet.hpp"
+
+#include "Paths.hpp"
+
+#include <algorithm>
+
+// Size of a block in the component string arena
+static const size_t arenaBlockSize = 32 * 1024;
+
+// Case-insensitive hash of a path component (FNV-1a over folded characters)
+static uint32_t HashComponent (const wchar_t* str, size_t len)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++)
+  {
+    hash = (hash ^ FoldPathChar (str[i])) * 16777619u;
+  }
+  return hash;
+}
+
+static bool ComponentEqual (const wchar_t* a, const wchar_t* b, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    if ((a[i] != b[i]) && (FoldPathChar (a[i]) != FoldPathChar (b[i]))) return false;
+  }
+  return true;
+}
+
+static inline uint32_t HashNode (PathTrie::NodeId parent, uint32_t component)
+{
+  uint32_t hash = (parent * 0x9E3779B1u) ^ (component + 0x7F4A7C15u + (parent << 6) + (parent >> 2));
+  return hash ^ (hash >> 15);
+}
+
+PathTrie::PathTrie ()
+{
+  // Root node: no parent, no component
+  nodes.push_back (Node{ noNode, 0 });
+  componentTable.resize (256);
+  nodeTable.resize (256);
+}
+
+const wchar_t* PathTrie::ArenaStore (const wchar_t* str, size_t len)
+{
+  size_t need = len + 1;
+  if (need > arenaBlockFree)
+  {
+    size_t blockSize = std::max (need, arenaBlockSize);
+    arenaBlocks.emplace_back (new wchar_t[blockSize]);
+    arenaPos = arenaBlocks.back ().get ();
+    arenaBlockFree = blockSize;
+  }
+  wchar_t* result = arenaPos;
+  wmemcpy (result, str, len);
+  result[len] = 0;
+  arenaPos += need;
+  arenaBlockFree -= need;
+  return result;
+}
+
+uint32_t PathTrie::FindComponent (const wchar_t* str, size_t len, uint32_t hash) const
+{
+  size_t mask = componentTable.size () - 1;
+  for (size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+  {
+    uint32_t entry = componentTable[slot];
+    if (entry == 0) return static_cast<uint32_t> (-1);
+    const auto& comp = components[entry - 1];
+    if ((comp.hash == hash) && (comp.len == len) && ComponentEqual (comp.str, str, len))
+      return entry - 1;
+  }
+}
+
+uint32_t PathTrie::InternComponent (const wchar_t* str, size_t len)
+{
+  uint32_t hash = HashComponent (str, len);
+  uint32_t index = FindComponent (str, len, hash);
+  if (index != static_cast<uint32_t> (-1)) return index;
+
+  if ((components.size () + 1) * 2 > componentTable.size ()) GrowComponentTable ();
+  index = static_cast<uint32_t> (components.size ());
+  components.push_back (Component{ ArenaStore (str, len), static_cast<uint32_t> (len), hash });
+  size_t mask = componentTable.size () - 1;
+  size_t slot = hash & mask;
+  while (componentTable[slot] != 0) slot = (slot + 1) & mask;
+  componentTable[slot] = index + 1;
+  return index;
+}
+
+void PathTrie::GrowComponentTable ()
+{
+  std::vector<uint32_t> newTable (componentTable.size () * 2);
+  size_t mask = newTable.size () - 1;
+  for (uint32_t i = 0; i < components.size (); i++)
+  {
+    size_t slot = components[i].hash & mask;
+    while (newTable[slot] != 0) slot = (slot + 1) & mask;
+    newTable[slot] = i + 1;
+  }
+  componentTable.swap (newTable);
+}
+
+PathTrie::NodeId PathTrie::FindChild (NodeId parent, uint32_t component) const
+{
+  size_t mask = nodeTable.size () - 1;
+  for (size_t slot = HashNode (parent, component) & mask; ; slot = (slot + 1) & mask)
+  {
+    NodeId entry = nodeTable[slot];
+    if (entry == 0) return noNode;
+    const auto& node = nodes[entry];
+    if ((node.parent == parent) && (node.component == component)) return entry;
+  }
+}
+
+PathTrie::NodeId PathTrie::InternChild (NodeId parent, uint32_t component)
+{
+  NodeId id = FindChild (parent, component);
+  if (id != noNode) return id;
+
+  if (nodes.size () * 2 > nodeTable.size ()) GrowNodeTable ();
+  id = static_cast<NodeId> (nodes.size ());
+  nodes.push_back (Node{ parent, component });
+  size_t mask = nodeTable.size () - 1;
+  size_t slot = HashNode (parent, component) & mask;
+  while (nodeTable[slot] != 0) slot = (slot + 1) & mask;
+  nodeTable[slot] = id;
+  return id;
+}
+
+void PathTrie::GrowNodeTable ()
+{
+  std::vector<NodeId> newTable (nodeTable.size () * 2);
+  size_t mask = newTable.size () - 1;
+  for (NodeId id = 1; id < nodes.size (); id++)
+  {
+    size_t slot = HashNode (nodes[id].parent, nodes[id].component) & mask;
+    while (newTable[slot] != 0) slot = (slot + 1) & mask;
+    newTable[slot] = id;
+  }
+  nodeTable.swap (newTable);
+}
+
+PathTrie::NodeId PathTrie::Find (const wchar_t* path, size_t len) const
+{
+  NodeId node = rootNode;
+  if (len == 0) return node;
+  const wchar_t* end = path + len;
+  const wchar_t* p = path;
+  while (true)
+  {
+    const wchar_t* sep = std::find (p, end, '\\');
+    size_t compLen = sep - p;
+    uint32_t component = FindComponent (p, compLen, HashComponent (p, compLen));
+    if (component == static_cast<uint32_t> (-1)) return noNode;
+    node = FindChild (node, component);
+    if (node == noNode) return noNode;
+    if (sep == end) break;
+    p = sep + 1;
+  }
+  return node;
+}
+
+PathTrie::NodeId PathTrie::Intern (const wchar_t* path, size_t len)
+{
+  NodeId node = rootNode;
+  if (len == 0) return node;
+  const wchar_t* end = path + len;
+  const wchar_t* p = path;
+  while (true)
+  {
+    const wchar_t* sep = std::find (p, end, '\\');
+    node = InternChild (node, InternComponent (p, sep - p));
+    if (sep == end) break;
+    p = sep + 1;
+  }
+  return node;
+}
+
+MyUString PathTrie::GetPath (NodeId node) const
+{
+  if (node == rootNode) return MyUString ();
+
+  size_t len = 0;
+  for (NodeId n = node; n != rootNode; n = nodes[n].parent)
+  {
+    len += components[nodes[n].component].len + 1;
+  }
+  len--; // no separator before first component
+
+  MyUString result;
+  wchar_t* buf = result.GetBuf (static_cast<unsigned> (len));
+  wchar_t* p = buf + len;
+  for (NodeId n = node; ; )
+  {
+    const auto& comp = components[nodes[n].component];
+    p -= comp.len;
+    wmemcpy (p, comp.str, comp.len);
+    n = nodes[n].parent;
+    if (n == rootNode) break;
+    *(--p) = '\\';
+  }
+  result.ReleaseBuf_SetEnd (static_cast<unsigned> (len));
+  return result;
+}
+
+int PathTrie::CompareComponents (uint32_t a, uint32_t b) const
+{
+  const auto& compA = components[a];
+  const auto& compB = components[b];
+  uint32_t minLen = std::min (compA.len, compB.len);
+  for (uint32_t i = 0; i < minLen; i++)
+  {
+    wchar_t ca = FoldPathChar (compA.str[i]);
+    wchar_t cb = FoldPathChar (compB.str[i]);
+    if (ca != cb) return ca < cb ? -1 : 1;
+  }
+  if (compA.len != compB.len) return compA.len < compB.len ? -1 : 1;
+  return 0;
+}
+
+void PathTrie::ForEachSorted (const NodeFilter& filter, const NodeVisitor& visitor) const
+{
+  // Build child lists: children of node n are childList[childStart[n]..childStart[n+1])
+  std::vector<NodeId> childStart (nodes.size () + 1);
+  for (NodeId id = 1; id < nodes.size (); id++)
+  {
+    childStart[nodes[id].parent + 1]++;
+  }
+  for (size_t i = 1; i < childStart.size (); i++)
+  {
+    childStart[i] += childStart[i - 1];
+  }
+  std::vector<NodeId> childList (nodes.size ());
+  {
+    std::vector<NodeId> fillPos (childStart.begin (), childStart.end () - 1);
+    for (NodeId id = 1; id < nodes.size (); id++)
+    {
+      childList[fillPos[nodes[id].parent]++] = id;
+    }
+  }
+  for (size_t n = 0; n < nodes.size (); n++)
+  {
+    std::sort (childList.begin () + childStart[n], childList.begin () + childStart[n + 1],
+               [this](NodeId a, NodeId b)
+               {
+                 return CompareComponents (nodes[a].component, nodes[b].component) < 0;
+               });
+  }
+
+  // Depth-first traversal, maintaining the current path in a buffer
+  struct StackEntry
+  {
+    NodeId next;
+    NodeId end;
+    size_t pathLen;
+  };
+  std::vector<StackEntry> stack;
+  std::vector<wchar_t> pathBuf;
+  if (filter (rootNode)) visitor (rootNode, MyUString ());
+  stack.push_back (StackEntry{ childStart[rootNode], childStart[rootNode + 1], 0 });
+  while (!stack.empty ())
+  {
+    auto& top = stack.back ();
+    if (top.next == top.end)
+    {
+      stack.pop_back ();
+      continue;
+    }
+    NodeId id = childList[top.next++];
+    size_t parentLen = top.pathLen;
+    pathBuf.resize (parentLen);
+    if (nodes[id].parent != rootNode) pathBuf.push_back ('\\');
+    const auto& comp = components[nodes[id].component];
+    pathBuf.insert (pathBuf.end (), comp.str, comp.str + comp.len);
+    if (filter (id)) visitor (id, MyUString (pathBuf.data (), pathBuf.size ()));
+    // Note: 'top' may be invalidated by push_back
+    stack.push_back (StackEntry{ childStart[id], childStart[id + 1], pathBuf.size () });
+  }
+}
+
+//---------------------------------------------------------------------------
+
+bool PathSet::Insert (const MyUString& path)
+{
+  auto node = trie.Intern (path.Ptr (), path.Len ());
+  if (node >= members.size ()) members.resize (trie.NumNodes ());
+  if (members[node]) return false;
+  members[node] = true;
+  ++count;
+  return true;
+}
+
+bool PathSet::Erase (const MyUString& path)
+{
+  auto node = trie.Find (path.Ptr (), path.Len ());
+  if ((node == PathTrie::noNode) || (node >= members.size ()) || !members[node]) return false;
+  members[node] = false;
+  --count;
+  return true;
+}
+
+bool PathSet::Contains (const MyUString& path) const
+{
+  auto node = trie.Find (path.Ptr (), path.Len ());
+  return (node != PathTrie::noNode) && (node < members.size ()) && members[node];
+}
+
+void PathSet::ForEach (const std::function<void (const MyUString&)>& func) const
+{
+  trie.ForEachSorted ([this](PathTrie::NodeId node) { return (node < members.size ()) && members[node]; },
+                      [&func](PathTrie::NodeId, const MyUString& path) { func (path); });
+}
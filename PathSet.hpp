@@ -0,0 +1,142 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Compact storage for large sets of paths
+ */
+#ifndef SEVENI_PATHSET_HPP_
+#define SEVENI_PATHSET_HPP_
+
+#include "MyUString.hpp"
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Path storage, as a tree of path components.
+ * Each distinct component string is stored once, in an arena. Tree nodes
+ * are (parent node, component) pairs, looked up with an open addressing
+ * table, so lookups don't need to allocate.
+ * Components are compared case-insensitively (see FoldPathChar()).
+ */
+class PathTrie
+{
+public:
+  typedef uint32_t NodeId;
+  /// Node ID signalling "no node"
+  static const NodeId noNode = static_cast<NodeId> (-1);
+  /// Node ID of root (empty path)
+  static const NodeId rootNode = 0;
+
+  PathTrie ();
+  PathTrie (PathTrie&& other) = default;
+  PathTrie& operator= (PathTrie&& other) = default;
+
+  /// Look up a path. Returns noNode if not present.
+  NodeId Find (const wchar_t* path, size_t len) const;
+  /// Look up a path, adding nodes as necessary.
+  NodeId Intern (const wchar_t* path, size_t len);
+  /// Reconstruct the full path of a node.
+  MyUString GetPath (NodeId node) const;
+  /// Number of nodes (including root). All node IDs are below this value.
+  size_t NumNodes () const { return nodes.size(); }
+
+  typedef std::function<bool (NodeId)> NodeFilter;
+  typedef std::function<void (NodeId, const MyUString&)> NodeVisitor;
+  /**
+   * Visit all nodes for which \a filter returns \c true.
+   * Nodes are visited in order sorted by path components.
+   */
+  void ForEachSorted (const NodeFilter& filter, const NodeVisitor& visitor) const;
+private:
+  /// Component string arena
+  std::vector<std::unique_ptr<wchar_t[]>> arenaBlocks;
+  size_t arenaBlockFree = 0;
+  wchar_t* arenaPos = nullptr;
+
+  struct Component
+  {
+    const wchar_t* str;
+    uint32_t len;
+    uint32_t hash;
+  };
+  std::vector<Component> components;
+  /// Open addressing table for components: component index + 1, 0 for empty slot
+  std::vector<uint32_t> componentTable;
+
+  struct Node
+  {
+    NodeId parent;
+    uint32_t component;
+  };
+  std::vector<Node> nodes;
+  /// Open addressing table for nodes: node ID, 0 for empty slot (root is never in the table)
+  std::vector<NodeId> nodeTable;
+
+  const wchar_t* ArenaStore (const wchar_t* str, size_t len);
+  uint32_t FindComponent (const wchar_t* str, size_t len, uint32_t hash) const;
+  uint32_t InternComponent (const wchar_t* str, size_t len);
+  NodeId FindChild (NodeId parent, uint32_t component) const;
+  NodeId InternChild (NodeId parent, uint32_t component);
+  void GrowComponentTable ();
+  void GrowNodeTable ();
+  int CompareComponents (uint32_t a, uint32_t b) const;
+};
+
+/// Set of paths, based on PathTrie
+class PathSet
+{
+public:
+  PathSet () {}
+  PathSet (PathSet&& other) = default;
+  PathSet& operator= (PathSet&& other) = default;
+
+  /// Add a path. Returns whether the path was newly added.
+  bool Insert (const MyUString& path);
+  /// Remove a path. Returns whether the path was present.
+  bool Erase (const MyUString& path);
+  /// Check whether a path is present.
+  bool Contains (const MyUString& path) const;
+
+  size_t Size () const { return count; }
+  bool IsEmpty () const { return count == 0; }
+
+  /// Call \a func for all paths, in sorted order.
+  void ForEach (const std::function<void (const MyUString&)>& func) const;
+private:
+  PathTrie trie;
+  std::vector<bool> members;
+  size_t count = 0;
+};
+
+#endif // SEVENI_PATHSET_HPP_
@@ -107,7 +107,12 @@ static void SetCompression (const wchar_t* path)
 
 bool InstallLogLocation::Init (const CommonArgs& commonArgs)
 {
-  assert (commonArgs.GetGUID () != nullptr);
+  return Init (commonArgs, commonArgs.GetGUID ());
+}
+
+bool InstallLogLocation::Init (const CommonArgs& commonArgs, const wchar_t* guid)
+{
+  assert (guid != nullptr);
 
   logsDir = GetDataDir (commonArgs);
   EnsureDirectoriesExist (logsDir.Ptr());
@@ -115,8 +120,13 @@ bool InstallLogLocation::Init (const CommonArgs& commonArgs)
   filename = logsDir;
   filename += L"\\";
   // We trust the GUID string since it has supposedly passed VerifyGUID() earlier.
-  filename += commonArgs.GetGUID();
+  filename += guid;
+  manifestFilename = filename;
+  journalFilename = filename;
   filename += L".txt";
+  // Not ".txt", so these aren't taken for installed files lists
+  manifestFilename += L".manifest";
+  journalFilename += L".journal";
   return true;
 }
 
@@ -132,40 +142,129 @@ const MyUString& InstallLogLocation::GetFilename() const
   return filename;
 }
 
+const MyUString& InstallLogLocation::GetManifestFilename() const
+{
+  if (manifestFilename.IsEmpty()) throw HRESULTException (E_FAIL);
+  return manifestFilename;
+}
+
+const MyUString& InstallLogLocation::GetJournalFilename() const
+{
+  if (journalFilename.IsEmpty()) throw HRESULTException (E_FAIL);
+  return journalFilename;
+}
+
 //---------------------------------------------------------------------------
 
-void NormalizePath (MyUString& path)
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#define PATHS_USE_SSE2
+#endif
+
+wchar_t FoldPathCharSlow (wchar_t c)
 {
-  MyUString longPath;
-  // Optimization: only call GetLongPathName() if path contains short components
-  if (path.Find ('~') != -1)
+  // CharLower() treats a pointer value < 0x10000 as a single character
+  return static_cast<wchar_t> (reinterpret_cast<uintptr_t> (CharLowerW (reinterpret_cast<LPWSTR> (static_cast<uintptr_t> (c)))));
+}
+
+void FoldPathCase (wchar_t* path, size_t len)
+{
+  wchar_t* p = path;
+  wchar_t* end = path + len;
+#if defined(PATHS_USE_SSE2)
+  const __m128i nonAsciiMask = _mm_set1_epi16 (static_cast<short> (0xff80));
+  const __m128i beforeA = _mm_set1_epi16 ('A' - 1);
+  const __m128i afterZ = _mm_set1_epi16 ('Z' + 1);
+  const __m128i caseBit = _mm_set1_epi16 ('a' - 'A');
+  while (end - p >= 8)
   {
-    DWORD needBuf = GetLongPathName (path.Ptr(),
-                                     longPath.GetBuf (MAX_PATH),
-                                     path.Len() + 1);
-    if (GetLastError () != ERROR_SUCCESS)
+    __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p));
+    // Anything not plain ASCII needs the full treatment
+    __m128i nonAscii = _mm_and_si128 (v, nonAsciiMask);
+    if (_mm_movemask_epi8 (_mm_cmpeq_epi16 (nonAscii, _mm_setzero_si128 ())) != 0xffff)
+      break;
+    // All values are < 0x80 here, so signed comparisons are fine
+    __m128i isUpper = _mm_and_si128 (_mm_cmpgt_epi16 (v, beforeA), _mm_cmplt_epi16 (v, afterZ));
+    v = _mm_add_epi16 (v, _mm_and_si128 (isUpper, caseBit));
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (p), v);
+    p += 8;
+  }
+#endif
+  for (; p < end; ++p)
+  {
+    wchar_t c = *p;
+    if (c >= 0x80)
     {
-      // In case of error, just go with the original path
-      longPath.ReleaseBuf_SetEnd (0);
-      longPath = path;
+      // Let the system deal with the rest
+      CharLowerBuffW (p, static_cast<DWORD> (end - p));
+      return;
     }
-    else
+    if ((c >= 'A') && (c <= 'Z')) *p = c + ('a' - 'A');
+  }
+}
+
+static bool GetLongPath (const wchar_t* path, unsigned pathLen, MyUString& longPath)
+{
+  DWORD needBuf = GetLongPathNameW (path, longPath.GetBuf (pathLen + 1), pathLen + 1);
+  if (needBuf == 0)
+  {
+    longPath.ReleaseBuf_SetEnd (0);
+    return false;
+  }
+  if (needBuf > pathLen + 1)
+  {
+    needBuf = GetLongPathNameW (path, longPath.GetBuf (needBuf), needBuf);
+    if (needBuf == 0)
     {
-      if (needBuf > path.Len () + 1)
-      {
-        GetLongPathName (path.Ptr (),
-                        longPath.GetBuf (needBuf),
-                        needBuf);
-      }
-      longPath.ReleaseBuf_CalcLen (needBuf);
+      longPath.ReleaseBuf_SetEnd (0);
+      return false;
     }
   }
-  else
+  longPath.ReleaseBuf_SetEnd (needBuf);
+  return true;
+}
+
+/// Expand short (8.3) path components, using the directory cache where possible
+void PathNormalizer::ExpandShortNames (MyUString& path)
+{
+  int nameSep = path.ReverseFind_PathSepar ();
+  const wchar_t* name = path.Ptr () + nameSep + 1;
+  if (!useCache || (nameSep <= 0) || (wcschr (name, '~') != nullptr))
+  {
+    // Short name in last component: no way around asking the file system
+    MyUString longPath;
+    if (GetLongPath (path.Ptr (), path.Len (), longPath)) path = std::move (longPath);
+    return;
+  }
+
+  // Only the directory part contains short names: look up cache
+  MyUString dir (path.Ptr (), nameSep);
+  auto cached = longDirCache.find (dir);
+  if (cached == longDirCache.end ())
   {
-    longPath = path;
+    MyUString longDir;
+    /* In case of error, just go with the original path. Not cached: the
+     * directory may not exist yet, but be created later on. */
+    if (!GetLongPath (dir.Ptr (), dir.Len (), longDir)) return;
+    cached = longDirCache.emplace (std::move (dir), std::move (longDir)).first;
   }
-  CharLower (longPath.Ptr());
-  path = std::move (longPath);
+  if (cached->second.Len () == static_cast<unsigned> (nameSep)) return; // nothing expanded
+  path = cached->second + (path.Ptr () + nameSep);
+}
+
+void PathNormalizer::Normalize (MyUString& path)
+{
+  // Optimization: only try to expand names if path contains short components
+  if (path.Find ('~') != -1)
+  {
+    ExpandShortNames (path);
+  }
+  FoldPathCase (path.Ptr(), path.Len());
+}
+
+void NormalizePath (MyUString& path)
+{
+  PathNormalizer (false).Normalize (path);
 }
 
 MyUString GetExePath ()
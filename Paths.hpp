@@ -37,6 +37,8 @@
 
 #include "MyUString.hpp"
 
+#include <unordered_map>
+
 class CommonArgs;
 
 class InstallLogLocation
@@ -44,19 +46,60 @@ class InstallLogLocation
 public:
   /// Initialize from given common arguments
   bool Init (const CommonArgs& commonArgs);
+  /// Initialize from given common arguments, for a different GUID
+  bool Init (const CommonArgs& commonArgs, const wchar_t* guid);
 
   /// Get directory with log files
   const MyUString& GetLogsPath() const;
   /// Return log file name
   const MyUString& GetFilename() const;
+  /// Return manifest file name
+  const MyUString& GetManifestFilename() const;
+  /// Return extraction journal file name
+  const MyUString& GetJournalFilename() const;
 private:
   MyUString logsDir;
   MyUString filename;
+  MyUString manifestFilename;
+  MyUString journalFilename;
+};
+
+/**
+ * Normalizes a batch of paths (see NormalizePath()). Expanded short names
+ * of directories are remembered, so the file system is asked once per
+ * directory; use one instance per operation.
+ */
+class PathNormalizer
+{
+public:
+  PathNormalizer (bool useCache = true) : useCache (useCache) {}
+
+  void Normalize (MyUString& path);
+private:
+  bool useCache;
+  /// Expanded directory names, keyed by the (short) directory path
+  std::unordered_map<MyUString, MyUString> longDirCache;
+
+  void ExpandShortNames (MyUString& path);
 };
 
 /// Helper function to 'normalize' a path do it can be compared across different runs
 void NormalizePath (MyUString& path);
 
+/// Lower-case a non-ASCII character
+wchar_t FoldPathCharSlow (wchar_t c);
+
+/// Lower-case a single path character the same way FoldPathCase() does.
+inline wchar_t FoldPathChar (wchar_t c)
+{
+  if (c < 0x80)
+    return ((c >= 'A') && (c <= 'Z')) ? static_cast<wchar_t> (c + ('a' - 'A')) : c;
+  return FoldPathCharSlow (c);
+}
+
+/// Lower-case a path in place. ASCII is folded directly, anything else goes through CharLowerBuff().
+void FoldPathCase (wchar_t* path, size_t len);
+
 /// Get path of this EXE
 MyUString GetExePath ();
 
@@ -0,0 +1,113 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "PreviousInstall.hpp"
+
+#include "Error.hpp"
+#include "PathSet.hpp"
+#include "ProgressReporter.hpp"
+
+#include <stdio.h>
+
+PreviousInstall::PreviousInstall (const PathSet& files, const wchar_t* manifestPath, const ResourceGovernor& governor)
+  : files (files), governor (governor)
+{
+  if (GetFileAttributesW (manifestPath) == INVALID_FILE_ATTRIBUTES) return;
+  try
+  {
+    for (auto& entry : ReadManifest (manifestPath))
+      manifest.emplace (std::move (entry.path), entry.hash);
+  }
+  catch (const HRESULTException& e)
+  {
+    fprintf (stderr, "Error reading previous manifest %ls: %ls\n", manifestPath,
+             GetHRESULTString (e.GetHR()).Ptr());
+  }
+}
+
+std::vector<bool> PreviousInstall::Match (const std::vector<Candidate>& candidates)
+{
+  std::vector<bool> result (candidates.size ());
+  // Files the manifest doesn't vouch for, with the candidate index
+  std::vector<MyUString> toHash;
+  std::vector<size_t> toHashIndex;
+
+  for (size_t i = 0; i < candidates.size (); i++)
+  {
+    const auto& candidate = candidates[i];
+    if (!files.Contains (candidate.path)) continue;
+
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    if (!GetFileAttributesExW (candidate.path.Ptr(), GetFileExInfoStandard, &attr)
+        || ((attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0))
+      continue;
+    uint64_t size = (static_cast<uint64_t> (attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+    // Cheap check first: a different size means different content
+    if (size != candidate.size) continue;
+    uint64_t mTime = (static_cast<uint64_t> (attr.ftLastWriteTime.dwHighDateTime) << 32) | attr.ftLastWriteTime.dwLowDateTime;
+
+    auto entry = manifest.find (candidate.path);
+    if ((entry != manifest.end ()) && (entry->second.size == size) && (entry->second.mTime == mTime))
+    {
+      if (entry->second.crc == candidate.crc)
+      {
+        result[i] = true;
+        kept[candidate.path] = entry->second;
+      }
+      continue;
+    }
+    toHash.push_back (candidate.path);
+    toHashIndex.push_back (i);
+  }
+
+  if (!toHash.empty ())
+  {
+    ProgressReporterDummy progress;
+    auto hashes = HashFiles (toHash, governor, progress);
+    for (size_t h = 0; h < hashes.size (); h++)
+    {
+      const auto& hash = hashes[h];
+      const auto& candidate = candidates[toHashIndex[h]];
+      if ((hash.error != ERROR_SUCCESS) || hash.isDir
+          || (hash.size != candidate.size) || (hash.crc != candidate.crc))
+        continue;
+      result[toHashIndex[h]] = true;
+      kept[candidate.path] = hash;
+    }
+  }
+
+  return result;
+}
+
+const FileHash* PreviousInstall::GetKeptHash (const MyUString& path) const
+{
+  auto it = kept.find (path);
+  return it != kept.end () ? &it->second : nullptr;
+}
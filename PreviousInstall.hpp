@@ -0,0 +1,89 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Installed state of the product an upgrade replaces
+ */
+#ifndef SEVENI_PREVIOUSINSTALL_HPP_
+#define SEVENI_PREVIOUSINSTALL_HPP_
+
+#include "Manifest.hpp"
+#include "MyUString.hpp"
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+class PathSet;
+class ResourceGovernor;
+
+/**
+ * Files of the installation an upgrade replaces.
+ * Archive items that would be extracted over one of these files with the
+ * same size and CRC are skipped; the installed file is kept as it is.
+ */
+class PreviousInstall
+{
+public:
+  /**
+   * Set up from the previous installed files list and manifest.
+   * \a files must outlive the object. A missing manifest is fine, files are
+   * read to compute their CRCs then.
+   */
+  PreviousInstall (const PathSet& files, const wchar_t* manifestPath, const ResourceGovernor& governor);
+
+  /// An archive item to compare with an installed file
+  struct Candidate
+  {
+    /// Normalized target path
+    MyUString path;
+    uint64_t size;
+    uint32_t crc;
+  };
+  /**
+   * Check which candidates match a file of the previous installation.
+   * The CRC from the manifest is used for files that were not modified since
+   * it was written; other files of the right size are read on worker threads.
+   */
+  std::vector<bool> Match (const std::vector<Candidate>& candidates);
+
+  /// Get the state of a file Match() found unchanged, or nullptr
+  const FileHash* GetKeptHash (const MyUString& path) const;
+private:
+  const PathSet& files;
+  const ResourceGovernor& governor;
+  /// Manifest entries, by path
+  std::unordered_map<MyUString, FileHash> manifest;
+  /// Files found unchanged
+  std::unordered_map<MyUString, FileHash> kept;
+};
+
+#endif // SEVENI_PREVIOUSINSTALL_HPP_
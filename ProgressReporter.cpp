@@ -32,12 +32,13 @@
 
 #include "BurnPipe.hpp"
 #include "MulDiv64.hpp"
+#include "Trace.hpp"
 
 #include <assert.h>
 
 ProgressReporterMultiStep::ProgressReporterMultiStep (ProgressReporter& target) : target (target) {}
 
-ProgressReporterMultiStep::phase_type ProgressReporterMultiStep::AddPhase (uint64_t total)
+ProgressReporterMultiStep::phase_type ProgressReporterMultiStep::AddPhase (uint64_t total, const char* name)
 {
   uint64_t phasesTotal = 0;
   if (!phases.empty())
@@ -50,6 +51,7 @@ ProgressReporterMultiStep::phase_type ProgressReporterMultiStep::AddPhase (uint6
   PhaseInfo newPhase;
   newPhase.start = phasesTotal;
   newPhase.size = total;
+  newPhase.name = name;
   phases.push_back (newPhase);
   phasesDirty = true;
   return new_id;
@@ -65,6 +67,11 @@ ProgressReporter& ProgressReporterMultiStep::GetPhase (phase_type phase)
     phasesDirty = false;
   }
 
+  if (phase != currentPhase)
+  {
+    auto trace = GetTrace ();
+    if (trace && phases[phase].name) trace->BeginPhase (phases[phase].name);
+  }
   currentPhase = phase;
   currentTotal = 0;
   target.SetCompleted (phases[currentPhase].start);
@@ -66,7 +66,8 @@ public:
   ProgressReporterMultiStep (ProgressReporter& target);
 
   typedef size_t phase_type;
-  phase_type AddPhase (uint64_t total);
+  /// Add a phase. \a name is used to identify the phase in the trace.
+  phase_type AddPhase (uint64_t total, const char* name = nullptr);
 
   ProgressReporter& GetPhase (phase_type phase);
 protected:
@@ -75,6 +76,7 @@ protected:
   struct PhaseInfo
   {
     uint64_t start, size;
+    const char* name;
   };
   std::vector<PhaseInfo> phases;
   phase_type currentPhase = (phase_type)-1;
@@ -0,0 +1,173 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "ReadAheadStream.hpp"
+
+#include "Error.hpp"
+
+#include "7zip/Common/StreamUtils.h"
+
+#include <algorithm>
+
+ReadAheadInStream::ReadAheadInStream (IInStream* source, unsigned depth, UInt32 blockSize)
+  : source (source), blockSize (blockSize), blocks (depth)
+{
+  CHECK_HR(source->Seek (0, STREAM_SEEK_END, &streamSize));
+  for (Block& block : blocks)
+    block.data.resize (blockSize);
+  // Start reading with the first Read()
+  fetchPos = static_cast<UInt64> (-1);
+  WRes wres = thread.Create (ThreadFunc, this);
+  if (wres != 0) THROW_HR(HRESULT_FROM_WIN32 (wres));
+}
+
+ReadAheadInStream::~ReadAheadInStream ()
+{
+  if (!thread.IsCreated ()) return;
+  AcquireSRWLockExclusive (&lock);
+  stop = true;
+  ReleaseSRWLockExclusive (&lock);
+  WakeConditionVariable (&freedCond);
+  thread.Wait ();
+  thread.Close ();
+}
+
+THREAD_FUNC_DECL ReadAheadInStream::ThreadFunc (void* param)
+{
+  static_cast<ReadAheadInStream*> (param)->ReadLoop ();
+  return 0;
+}
+
+void ReadAheadInStream::ReadLoop ()
+{
+  AcquireSRWLockExclusive (&lock);
+  for (;;)
+  {
+    while (!stop && (fetchEnd || (numFilled >= blocks.size ())))
+      SleepConditionVariableSRW (&freedCond, &lock, INFINITE, 0);
+    if (stop) break;
+
+    // Only this thread fills blocks, and Read() never looks at unfilled ones
+    Block& block = blocks[(firstFilled + numFilled) % blocks.size ()];
+    const UInt64 start = fetchPos;
+    const unsigned readGeneration = generation;
+    const size_t toRead = static_cast<size_t> (std::min<UInt64> (blockSize, streamSize - start));
+    ReleaseSRWLockExclusive (&lock);
+
+    size_t readSize = toRead;
+    HRESULT hr = source->Seek (start, STREAM_SEEK_SET, nullptr);
+    if (SUCCEEDED(hr))
+      hr = ReadStream (source, block.data.data (), &readSize);
+    else
+      readSize = 0;
+
+    AcquireSRWLockExclusive (&lock);
+    if (readGeneration != generation) continue;
+    block.start = start;
+    block.size = static_cast<UInt32> (readSize);
+    if (readSize != 0) numFilled++;
+    fetchPos = start + readSize;
+    if (FAILED(hr) || (readSize < toRead) || (fetchPos >= streamSize))
+    {
+      fetchEnd = true;
+      fetchResult = hr;
+    }
+    WakeConditionVariable (&filledCond);
+  }
+  ReleaseSRWLockExclusive (&lock);
+}
+
+void ReadAheadInStream::Restart ()
+{
+  generation++;
+  numFilled = 0;
+  fetchPos = pos;
+  fetchEnd = false;
+  fetchResult = S_OK;
+  WakeConditionVariable (&freedCond);
+}
+
+STDMETHODIMP ReadAheadInStream::Read (void* data, UInt32 size, UInt32* processedSize)
+{
+  if (processedSize) *processedSize = 0;
+  if ((size == 0) || (pos >= streamSize)) return S_OK;
+
+  AcquireSRWLockExclusive (&lock);
+  // Blocks before the position are not needed any more
+  bool freed = false;
+  while ((numFilled > 0) && (pos >= blocks[firstFilled].start)
+         && (pos - blocks[firstFilled].start >= blocks[firstFilled].size))
+  {
+    firstFilled = (firstFilled + 1) % blocks.size ();
+    numFilled--;
+    freed = true;
+  }
+  if (freed) WakeConditionVariable (&freedCond);
+
+  // Data at the position is neither buffered nor being read
+  if ((numFilled > 0) ? (pos < blocks[firstFilled].start) : (pos != fetchPos))
+    Restart ();
+
+  while ((numFilled == 0) && !fetchEnd)
+    SleepConditionVariableSRW (&filledCond, &lock, INFINITE, 0);
+  if (numFilled == 0)
+  {
+    HRESULT hr = fetchResult;
+    ReleaseSRWLockExclusive (&lock);
+    return hr;
+  }
+  // The first block is only freed by Read() itself, so it can be copied from without the lock
+  const Block& block = blocks[firstFilled];
+  ReleaseSRWLockExclusive (&lock);
+
+  const UInt32 offset = static_cast<UInt32> (pos - block.start);
+  const UInt32 copySize = std::min (size, block.size - offset);
+  memcpy (data, block.data.data () + offset, copySize);
+  pos += copySize;
+  if (processedSize) *processedSize = copySize;
+  return S_OK;
+}
+
+STDMETHODIMP ReadAheadInStream::Seek (Int64 offset, UInt32 seekOrigin, UInt64* newPosition)
+{
+  UInt64 base;
+  switch (seekOrigin)
+  {
+  case STREAM_SEEK_SET: base = 0; break;
+  case STREAM_SEEK_CUR: base = pos; break;
+  case STREAM_SEEK_END: base = streamSize; break;
+  default: return STG_E_INVALIDFUNCTION;
+  }
+  if ((offset < 0) && (static_cast<UInt64> (-offset) > base))
+    return HRESULT_WIN32_ERROR_NEGATIVE_SEEK;
+  pos = base + offset;
+  if (newPosition) *newPosition = pos;
+  return S_OK;
+}
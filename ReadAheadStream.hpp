@@ -0,0 +1,108 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Archive input that is read ahead on a background thread
+ */
+#ifndef SEVENI_READAHEADSTREAM_HPP_
+#define SEVENI_READAHEADSTREAM_HPP_
+
+#include "Common/Common.h"
+#include "Common/MyCom.h"
+#include "7zip/IStream.h"
+#include "Windows/Thread.h"
+
+#include <vector>
+
+#include <Windows.h>
+
+/**
+ * Seekable stream that reads the blocks following the current position of
+ * another stream on a background thread, so decoders don't have to wait for
+ * every buffer refill. Reading ahead continues past the end of a folder's
+ * packed streams into the next folder's, as they follow each other in the
+ * archive. Seeking outside of the data read ahead restarts reading at the
+ * new position.
+ */
+class ReadAheadInStream : public IInStream, public CMyUnknownImp
+{
+public:
+  MY_UNKNOWN_IMP1(IInStream)
+
+  /**
+   * Read ahead up to \a depth blocks of \a blockSize bytes from \a source.
+   * Throws a HRESULTException on failure.
+   */
+  ReadAheadInStream (IInStream* source, unsigned depth, UInt32 blockSize);
+  ~ReadAheadInStream ();
+
+  STDMETHOD(Read)(void* data, UInt32 size, UInt32* processedSize);
+  STDMETHOD(Seek)(Int64 offset, UInt32 seekOrigin, UInt64* newPosition);
+private:
+  CMyComPtr<IInStream> source;
+  UInt64 streamSize = 0;
+  UInt32 blockSize;
+  /// Position of the next Read()
+  UInt64 pos = 0;
+
+  struct Block
+  {
+    std::vector<Byte> data;
+    UInt64 start = 0;
+    UInt32 size = 0;
+  };
+  /// Ring of blocks; the filled ones are consecutive parts of the stream
+  std::vector<Block> blocks;
+
+  // Members below are shared with the reading thread and guarded by the lock
+  SRWLOCK lock = SRWLOCK_INIT;
+  /// Signalled when a block was filled, or reading stopped
+  CONDITION_VARIABLE filledCond = CONDITION_VARIABLE_INIT;
+  /// Signalled when a block was freed, or reading was restarted or is to stop
+  CONDITION_VARIABLE freedCond = CONDITION_VARIABLE_INIT;
+  size_t firstFilled = 0;
+  size_t numFilled = 0;
+  /// Position of the next block to read
+  UInt64 fetchPos = 0;
+  /// Incremented when reading restarts; reads for an older generation are discarded
+  unsigned generation = 0;
+  /// Reading stopped at fetchPos, because of the end of the stream or an error
+  bool fetchEnd = true;
+  HRESULT fetchResult = S_OK;
+  bool stop = false;
+
+  NWindows::CThread thread;
+  static THREAD_FUNC_DECL ThreadFunc (void* param);
+  void ReadLoop ();
+  /// Discard all blocks and read ahead from the current position
+  void Restart ();
+};
+
+#endif // SEVENI_READAHEADSTREAM_HPP_
@@ -0,0 +1,125 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "ResourceGovernor.hpp"
+
+#include "ArgsHelper.hpp"
+
+#include "Common/Common.h"
+#include "Common/MyCom.h"
+#include "Windows/PropVariant.h"
+#include "Windows/System.h"
+#include "7zip/Archive/IArchive.h"
+#include "7zip/Archive/Common/HandlerOut.h"
+
+#include <algorithm>
+
+#include <stdio.h>
+
+// Memory reserved for our own data (file lists, buffers) when deriving the decoder limit
+static const uint64_t ownMemoryReserve = 32 << 20;
+
+ResourceGovernor::ResourceGovernor ()
+{
+  threads = NWindows::NSystem::GetNumberOfProcessors ();
+  // Same default as 7-zip
+  UInt64 ramSize = static_cast<UInt64> (sizeof (size_t)) << 28;
+  memoryBudget = ramSize;
+  if (NWindows::NSystem::GetRamSize (ramSize)) memoryBudget = ramSize / 32 * 17;
+}
+
+bool ResourceGovernor::Init (const ArgsHelper& args)
+{
+  const wchar_t* threadsArg = nullptr;
+  if (args.GetOption (L"--threads", threadsArg))
+  {
+    wchar_t* end = nullptr;
+    unsigned long value = threadsArg ? wcstoul (threadsArg, &end, 10) : 0;
+    if (!threadsArg || (end == threadsArg) || (*end != 0) || (value == 0))
+    {
+      fprintf (stderr, "Invalid value for --threads: expected a number greater than 0\n");
+      return false;
+    }
+    threads = static_cast<uint32_t> (value);
+    limitsSet = true;
+  }
+
+  const wchar_t* memoryArg = nullptr;
+  if (args.GetOption (L"--max-memory", memoryArg))
+  {
+    UInt64 ramSize = 0;
+    if (!NWindows::NSystem::GetRamSize (ramSize)) ramSize = static_cast<UInt64> (sizeof (size_t)) << 28;
+    UInt64 value = 0;
+    NWindows::NCOM::CPropVariant emptyProp;
+    if (!memoryArg || !NArchive::ParseSizeString (memoryArg, emptyProp, ramSize, value) || (value == 0))
+    {
+      fprintf (stderr, "Invalid value for --max-memory: expected a size (e.g. 512m, 2g, 50%%)\n");
+      return false;
+    }
+    memoryBudget = value;
+    limitsSet = true;
+  }
+
+  if (limitsSet)
+  {
+    printf ("Resource limits: %u thread(s), %llu MiB memory\n", threads, memoryBudget >> 20);
+  }
+  return true;
+}
+
+void ResourceGovernor::ApplyToArchive (IUnknown* archive) const
+{
+  // Without explicit limits, leave the handler defaults alone
+  if (!limitsSet) return;
+
+  CMyComPtr<ISetProperties> setProperties;
+  archive->QueryInterface (IID_ISetProperties, (void**)&setProperties);
+  if (!setProperties) return;
+
+  // Keep some of the budget for ourselves, unless it's tiny
+  uint64_t decoderMemory = memoryBudget > 2 * ownMemoryReserve ? memoryBudget - ownMemoryReserve : memoryBudget / 2;
+
+  const wchar_t* names[] = { L"mt", L"memuse", L"mtf" };
+  NWindows::NCOM::CPropVariant values[3];
+  values[0] = static_cast<UInt32> (threads);
+  values[1] = static_cast<UInt64> (decoderMemory);
+  values[2] = threads > 1;
+  HRESULT hr = setProperties->SetProperties (names, values, 3);
+  if (FAILED(hr))
+  {
+    fprintf (stderr, "Could not apply resource limits to archive handler\n");
+  }
+}
+
+uint32_t ResourceGovernor::GetWorkerCount (uint64_t memoryPerWorker) const
+{
+  uint64_t byMemory = memoryPerWorker != 0 ? memoryBudget / memoryPerWorker : threads;
+  return static_cast<uint32_t> (std::max<uint64_t> (1, std::min<uint64_t> (threads, byMemory)));
+}
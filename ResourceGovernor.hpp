@@ -0,0 +1,80 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * CPU and memory resource limits
+ */
+#ifndef SEVENI_RESOURCEGOVERNOR_HPP_
+#define SEVENI_RESOURCEGOVERNOR_HPP_
+
+#include <stdint.h>
+
+#include <Unknwn.h>
+
+class ArgsHelper;
+
+/**
+ * Decides how many threads and how much memory operations may use.
+ * Limits are taken from the \c --threads and \c --max-memory options;
+ * defaults are the number of processors and the 7-zip default memory limit.
+ */
+class ResourceGovernor
+{
+public:
+  ResourceGovernor ();
+
+  /// Parse resource options. Prints a message and returns false if an option is invalid.
+  bool Init (const ArgsHelper& args);
+
+  /// Total number of threads to use
+  uint32_t GetThreads () const { return threads; }
+  /// Total memory budget, in bytes
+  uint64_t GetMemoryBudget () const { return memoryBudget; }
+
+  /**
+   * Pass limits on to an opened archive handler.
+   * This limits LZMA2 block-parallel decoding, which falls back to
+   * single-threaded decoding if the blocks don't fit into the budget, and
+   * selects the single-threaded coder mixer if only one thread may be used.
+   */
+  void ApplyToArchive (IUnknown* archive) const;
+  /**
+   * Number of concurrent workers to use, given the memory each worker needs.
+   * Always at least 1.
+   */
+  uint32_t GetWorkerCount (uint64_t memoryPerWorker) const;
+private:
+  /// Whether any limits were given explicitly
+  bool limitsSet = false;
+  uint32_t threads;
+  uint64_t memoryBudget;
+};
+
+#endif // SEVENI_RESOURCEGOVERNOR_HPP_
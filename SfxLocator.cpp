@@ -0,0 +1,65 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "SfxLocator.hpp"
+
+#include <string.h>
+
+static const uint8_t locatorSignature[8] = { '7', 'i', 'S', 'F', 'X', 'L', 'o', 'c' };
+
+static void SetUi64 (uint8_t* p, uint64_t v)
+{
+  for (int i = 0; i < 8; i++) p[i] = static_cast<uint8_t> (v >> (i * 8));
+}
+
+static uint64_t GetUi64 (const uint8_t* p)
+{
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+void SfxLocator::Write (uint8_t (&data)[size]) const
+{
+  memcpy (data, locatorSignature, sizeof (locatorSignature));
+  SetUi64 (data + 8, archiveOffset);
+  SetUi64 (data + 16, archiveSize);
+}
+
+bool SfxLocator::Read (const uint8_t (&data)[size], uint64_t fileSize)
+{
+  if (memcmp (data, locatorSignature, sizeof (locatorSignature)) != 0) return false;
+  uint64_t offset = GetUi64 (data + 8);
+  uint64_t archSize = GetUi64 (data + 16);
+  if ((fileSize < size) || (offset > fileSize - size) || (archSize != fileSize - size - offset)) return false;
+  archiveOffset = offset;
+  archiveSize = archSize;
+  return true;
+}
@@ -0,0 +1,65 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Locator trailer of SFX executables
+ */
+#ifndef SEVENI_SFXLOCATOR_HPP_
+#define SEVENI_SFXLOCATOR_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Trailer at the very end of an SFX (SevenInstall executable with an appended
+ * archive), giving the position of the archive so it doesn't have to be
+ * searched for. Stored as signature, archive offset and archive size,
+ * all values little endian.
+ */
+struct SfxLocator
+{
+  /// Size of the serialized trailer
+  static const size_t size = 24;
+
+  /// Offset of the archive from the start of the file
+  uint64_t archiveOffset = 0;
+  /// Size of the archive
+  uint64_t archiveSize = 0;
+
+  /// Serialize
+  void Write (uint8_t (&data)[size]) const;
+  /**
+   * Deserialize. Returns false if \a data is not a locator or doesn't
+   * describe an archive that ends right before the trailer.
+   */
+  bool Read (const uint8_t (&data)[size], uint64_t fileSize);
+};
+
+#endif // SEVENI_SFXLOCATOR_HPP_
@@ -0,0 +1,255 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "StreamInput.hpp"
+
+#include "Error.hpp"
+#include "ResourceGovernor.hpp"
+
+#include "CpuArch.h"
+#include "XzCrc64.h"
+#include "ZstdDec.h"
+
+#include "7zip/Common/FileStreams.h"
+#include "7zip/Common/StreamUtils.h"
+#include "7zip/Compress/XzDecoder.h"
+#include "7zip/Compress/ZstdDecoder.h"
+#include "7zip/UI/Console/ConsoleClose.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+// Interval in which a growing file is checked for new data
+static const DWORD growPollInterval = 50;
+
+bool IsStdInArchive (const wchar_t* path)
+{
+  return wcscmp (path, L"-") == 0;
+}
+
+/// Sequential reading from a file that is possibly still being written to
+class StreamInput::GrowingFileInStream : public ISequentialInStream, public CMyUnknownImp
+{
+  MyUString path;
+  HANDLE file = INVALID_HANDLE_VALUE;
+  bool writerClosed = false;
+  std::atomic<bool> cancelled = false;
+
+  bool IsWriterClosed () const
+  {
+    // Opening without sharing write access fails as long as someone has the file open for writing
+    HANDLE h = CreateFileW (path.Ptr(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return GetLastError () != ERROR_SHARING_VIOLATION;
+    CloseHandle (h);
+    return true;
+  }
+public:
+  MY_UNKNOWN_IMP1(ISequentialInStream)
+
+  ~GrowingFileInStream ()
+  {
+    if (file != INVALID_HANDLE_VALUE) CloseHandle (file);
+  }
+
+  HRESULT Open (const wchar_t* filePath)
+  {
+    path = filePath;
+    file = CreateFileW (filePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return HRESULT_FROM_WIN32 (GetLastError ());
+    return S_OK;
+  }
+
+  /// Stop waiting for more data
+  void Cancel () { cancelled = true; }
+
+  STDMETHOD(Read)(void* data, UInt32 size, UInt32* processedSize)
+  {
+    if (processedSize) *processedSize = 0;
+    if (size == 0) return S_OK;
+    for (;;)
+    {
+      DWORD numRead = 0;
+      if (!ReadFile (file, data, size, &numRead, nullptr)) return HRESULT_FROM_WIN32 (GetLastError ());
+      if (numRead != 0)
+      {
+        if (processedSize) *processedSize = numRead;
+        return S_OK;
+      }
+      if (writerClosed) return S_OK;
+      if (cancelled || NConsoleClose::TestBreakSignal ()) return E_ABORT;
+      // Data may have been appended right before the writer closed, so read once more
+      if (IsWriterClosed ())
+        writerClosed = true;
+      else
+        Sleep (growPollInterval);
+    }
+  }
+};
+
+/// Returns the bytes used for detecting the compression before continuing with the actual stream
+class StreamInput::PrefixInStream : public ISequentialInStream, public CMyUnknownImp
+{
+  CMyComPtr<ISequentialInStream> stream;
+  Byte prefix[8];
+  UInt32 prefixSize;
+  UInt32 prefixPos = 0;
+public:
+  MY_UNKNOWN_IMP1(ISequentialInStream)
+
+  PrefixInStream (ISequentialInStream* stream, const Byte* data, UInt32 size) : stream (stream), prefixSize (size)
+  {
+    memcpy (prefix, data, size);
+  }
+
+  STDMETHOD(Read)(void* data, UInt32 size, UInt32* processedSize)
+  {
+    if (prefixPos < prefixSize)
+    {
+      UInt32 n = std::min (size, prefixSize - prefixPos);
+      memcpy (data, prefix + prefixPos, n);
+      prefixPos += n;
+      if (processedSize) *processedSize = n;
+      return S_OK;
+    }
+    return stream->Read (data, size, processedSize);
+  }
+};
+
+StreamInput::StreamInput (const wchar_t* path, const ResourceGovernor& governor)
+{
+  if (IsStdInArchive (path))
+  {
+    source = new CStdInFileStream;
+  }
+  else
+  {
+    growingFile = new GrowingFileInStream;
+    source = growingFile;
+    CHECK_HR(growingFile->Open (path));
+  }
+
+  // Detect compression from the first bytes
+  static const Byte xzSignature[] = { 0xFD, '7', 'z', 'X', 'Z', 0 };
+  Byte signature[sizeof (xzSignature)];
+  size_t signatureSize = sizeof (signature);
+  CHECK_HR(ReadStream (source, signature, &signatureSize));
+  if ((signatureSize == sizeof (xzSignature)) && (memcmp (signature, xzSignature, sizeof (xzSignature)) == 0))
+  {
+    static std::once_flag crc64TableInit;
+    std::call_once (crc64TableInit, []() { Crc64GenerateTable (); });
+
+    compression = "xz";
+    auto xzDecoder = new NCompress::NXz::CComDecoder;
+    decoder = xzDecoder;
+    xzDecoder->SetFinishMode (1);
+  }
+  else if (signatureSize >= 4)
+  {
+    UInt32 magic = GetUi32 (signature);
+    if ((magic == ZSTD_FRAME_MAGIC) || ((magic >= ZSTD_SKIPPABLE_MAGIC_MIN) && (magic <= ZSTD_SKIPPABLE_MAGIC_MAX)))
+    {
+      compression = "zstd";
+      decoder = new NCompress::NZstd::CDecoder;
+    }
+  }
+
+  CMyComPtr<ISequentialInStream> prefixed = new PrefixInStream (source, signature, static_cast<UInt32> (signatureSize));
+  if (!decoder)
+  {
+    stream = prefixed;
+    return;
+  }
+  source = prefixed;
+
+  CMyComPtr<ICompressSetCoderMt> setCoderMt;
+  decoder.QueryInterface (IID_ICompressSetCoderMt, &setCoderMt);
+  if (setCoderMt) setCoderMt->SetNumberOfThreads (governor.GetThreads ());
+  CMyComPtr<ICompressSetMemLimit> setMemLimit;
+  decoder.QueryInterface (IID_ICompressSetMemLimit, &setMemLimit);
+  if (setMemLimit) setMemLimit->SetMemLimit (governor.GetMemoryBudget ());
+
+  WRes wres = binder.CreateEvents ();
+  if (wres != 0) THROW_HR(HRESULT_FROM_WIN32 (wres));
+  binder.CreateStreams (&stream, &decoderOut);
+  wres = decoderThread.Create (DecoderThreadFunc, this);
+  if (wres != 0) THROW_HR(HRESULT_FROM_WIN32 (wres));
+}
+
+StreamInput::~StreamInput ()
+{
+  if (decoderThread.IsCreated ())
+  {
+    // Extraction failed: the decoder might be waiting for input that is never going to come
+    if (growingFile) growingFile->Cancel ();
+    CancelSynchronousIo (decoderThread);
+  }
+  StopDecoder ();
+}
+
+THREAD_FUNC_DECL StreamInput::DecoderThreadFunc (void* param)
+{
+  auto self = static_cast<StreamInput*> (param);
+  self->decoderResult = self->decoder->Code (self->source, self->decoderOut, nullptr, nullptr, nullptr);
+  // Signals the end of the data to the reader
+  self->decoderOut.Release ();
+  return 0;
+}
+
+void StreamInput::StopDecoder ()
+{
+  if (!decoderThread.IsCreated ()) return;
+  // Discard further output; the archive handler may still hold the reading side
+  binder.CloseRead ();
+  decoderThread.Wait ();
+  decoderThread.Close ();
+}
+
+HRESULT StreamInput::Finish ()
+{
+  if (!decoder) return S_OK;
+
+  if (decoderThread.IsCreated ())
+  {
+    // Decode the remainder (usually archive padding), so the checksum at the end is verified
+    Byte buffer[16384];
+    UInt32 numRead;
+    do
+    {
+      numRead = 0;
+      if (FAILED(stream->Read (buffer, sizeof (buffer), &numRead))) break;
+    } while (numRead != 0);
+    StopDecoder ();
+  }
+
+  if (decoderResult == S_FALSE) return HRESULT_FROM_WIN32 (ERROR_INVALID_DATA);
+  return SUCCEEDED(decoderResult) ? S_OK : decoderResult;
+}
@@ -0,0 +1,93 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Sequential archive input, for installing from a pipe or a growing file
+ */
+#ifndef SEVENI_STREAMINPUT_HPP_
+#define SEVENI_STREAMINPUT_HPP_
+
+#include "Common/Common.h"
+#include "Common/MyCom.h"
+#include "7zip/ICoder.h"
+#include "7zip/IStream.h"
+#include "7zip/Common/StreamBinder.h"
+#include "Windows/Thread.h"
+
+class ResourceGovernor;
+
+/// Whether an archive argument designates standard input (\c -)
+bool IsStdInArchive (const wchar_t* path);
+
+/**
+ * Reads an archive sequentially, so extraction can start while it is still
+ * arriving. Standard input is read for \c -; other paths are files that may
+ * still be written to: at the end of the data, reading waits for more until
+ * the writer closes the file.
+ * xz and zstd compressed input is decompressed on a background thread.
+ */
+class StreamInput
+{
+public:
+  /// Open the input. Throws a HRESULTException on failure.
+  StreamInput (const wchar_t* path, const ResourceGovernor& governor);
+  ~StreamInput ();
+
+  /// The (decompressed) archive data
+  ISequentialInStream* GetStream () const { return stream; }
+  /// Name of the detected compression, nullptr for uncompressed input
+  const char* GetCompression () const { return compression; }
+  /**
+   * Read to the end of the input and return the decompression result,
+   * which includes the stream checksum. Call after the archive was extracted.
+   */
+  HRESULT Finish ();
+private:
+  class GrowingFileInStream;
+  class PrefixInStream;
+
+  // Decompression. The binder must outlive the streams it created.
+  CMyComPtr<ICompressCoder> decoder;
+  CStreamBinder binder;
+  CMyComPtr<ISequentialOutStream> decoderOut;
+
+  CMyComPtr<ISequentialInStream> source;
+  GrowingFileInStream* growingFile = nullptr;
+  CMyComPtr<ISequentialInStream> stream;
+  const char* compression = nullptr;
+
+  NWindows::CThread decoderThread;
+  HRESULT decoderResult = S_OK;
+
+  static THREAD_FUNC_DECL DecoderThreadFunc (void* param);
+  void StopDecoder ();
+};
+
+#endif // SEVENI_STREAMINPUT_HPP_
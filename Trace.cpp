@@ -0,0 +1,233 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "Trace.hpp"
+
+#include "support/printf.hpp"
+
+#include "Common/Common.h"
+#include "7zip/UI/Common/ArchiveExtractCallback.h"
+
+#include <memory>
+
+#include <psapi.h>
+
+// Escape a string for use in a JSON string literal
+static MyUString JsonEscape (const wchar_t* str)
+{
+  MyUString result;
+  for (const wchar_t* p = str; *p; p++)
+  {
+    wchar_t c = *p;
+    if ((c == '"') || (c == '\\'))
+    {
+      wchar_t esc[3] = { '\\', c, 0 };
+      result += esc;
+    }
+    else if (c < 0x20)
+    {
+      wchar_t esc[7];
+      _snwprintf_s (esc, _TRUNCATE, L"\\u%04x", c);
+      result += esc;
+    }
+    else
+    {
+      wchar_t ch[2] = { c, 0 };
+      result += ch;
+    }
+  }
+  return result;
+}
+
+static uint64_t FileTimeTo_us (const FILETIME& ft)
+{
+  return ((static_cast<uint64_t> (ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10;
+}
+
+// Get user + kernel CPU time of process
+static uint64_t GetProcessCPU_us ()
+{
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if (!GetProcessTimes (GetCurrentProcess (), &creationTime, &exitTime, &kernelTime, &userTime)) return 0;
+  return FileTimeTo_us (kernelTime) + FileTimeTo_us (userTime);
+}
+
+Trace::Trace (HANDLE file) : file (file), startTicks (GetTicks ())
+{
+  Hprintf (file, "{\"event\":\"start\",\"pid\":%lu}\n", GetCurrentProcessId ());
+}
+
+Trace::~Trace ()
+{
+  CloseHandle (file);
+}
+
+uint64_t Trace::GetTicks ()
+{
+  LARGE_INTEGER v;
+  QueryPerformanceCounter (&v);
+  return static_cast<uint64_t> (v.QuadPart);
+}
+
+uint64_t Trace::TicksToMicroseconds (uint64_t ticks)
+{
+  static uint64_t freq = 0;
+  if (freq == 0)
+  {
+    LARGE_INTEGER v;
+    QueryPerformanceFrequency (&v);
+    freq = static_cast<uint64_t> (v.QuadPart);
+  }
+  return (ticks / freq) * 1000000 + (ticks % freq) * 1000000 / freq;
+}
+
+uint64_t Trace::Elapsed_ms () const
+{
+  return TicksToMicroseconds (GetTicks () - startTicks) / 1000;
+}
+
+void Trace::BeginPhase (const char* name)
+{
+  EndPhase ();
+  currentPhase = name;
+  phaseStartTicks = GetTicks ();
+  phaseStartCPU = GetProcessCPU_us ();
+}
+
+void Trace::EndPhase ()
+{
+  if (!currentPhase) return;
+  uint64_t wall_us = TicksToMicroseconds (GetTicks () - phaseStartTicks);
+  uint64_t cpu_us = GetProcessCPU_us () - phaseStartCPU;
+  Hprintf (file, "{\"event\":\"phase\",\"t_ms\":%llu,\"name\":\"%s\",\"wall_us\":%llu,\"cpu_us\":%llu}\n",
+           Elapsed_ms (), currentPhase, wall_us, cpu_us);
+  currentPhase = nullptr;
+}
+
+// Throughput in KiB/s
+static uint64_t KiBPerSecond (uint64_t bytes, uint64_t time_us)
+{
+  if (time_us == 0) return 0;
+  return (bytes * 1000000 / 1024) / time_us;
+}
+
+void Trace::ArchiveExtracted (const wchar_t* archive, uint64_t packSize, uint64_t unpackSize,
+                              uint64_t time_us, const CExtractTimings& timings)
+{
+  auto archiveEscaped = JsonEscape (archive);
+  for (unsigned i = 0; i < timings.Folders.Size (); i++)
+  {
+    const auto& folder = timings.Folders[i];
+    Hprintf (file, "{\"event\":\"folder\",\"t_ms\":%llu,\"archive\":\"%ls\",\"index\":%u,\"files\":%u,"
+                   "\"packed\":%llu,\"unpacked\":%llu,\"time_us\":%llu,\"decode_kib_per_s\":%llu}\n",
+             Elapsed_ms (), archiveEscaped.Ptr (), folder.Index, folder.NumFiles,
+             folder.PackSize, folder.UnpackSize, folder.Time_us, KiBPerSecond (folder.UnpackSize, folder.Time_us));
+  }
+  EmitHistogram ("create", timings.Create.Counts, CExtractTimings::CHistogram::kNumBuckets,
+                 timings.Create.Num, timings.Create.Sum_us, timings.Create.Max_us);
+  EmitHistogram ("write", timings.Write.Counts, CExtractTimings::CHistogram::kNumBuckets,
+                 timings.Write.Num, timings.Write.Sum_us, timings.Write.Max_us);
+  EmitHistogram ("close", timings.Close.Counts, CExtractTimings::CHistogram::kNumBuckets,
+                 timings.Close.Num, timings.Close.Sum_us, timings.Close.Max_us);
+  Hprintf (file, "{\"event\":\"archive\",\"t_ms\":%llu,\"path\":\"%ls\",\"packed\":%llu,\"unpacked\":%llu,"
+                 "\"time_us\":%llu,\"kib_per_s\":%llu}\n",
+           Elapsed_ms (), archiveEscaped.Ptr (), packSize, unpackSize, time_us, KiBPerSecond (unpackSize, time_us));
+}
+
+void Trace::AddDeletion (uint64_t time_us)
+{
+  size_t bucket = 0;
+  while ((bucket < 31) && ((time_us >> (bucket + 1)) != 0)) bucket++;
+  deletions.counts[bucket]++;
+  deletions.num++;
+  deletions.sum_us += time_us;
+  if (time_us > deletions.max_us) deletions.max_us = time_us;
+}
+
+void Trace::EmitHistogram (const char* op, const uint64_t* counts, size_t numCounts,
+                           uint64_t num, uint64_t sum_us, uint64_t max_us)
+{
+  if (num == 0) return;
+  // Omit trailing empty buckets
+  while ((numCounts > 0) && (counts[numCounts - 1] == 0)) numCounts--;
+  Hprintf (file, "{\"event\":\"latency\",\"t_ms\":%llu,\"op\":\"%s\",\"count\":%llu,\"sum_us\":%llu,\"max_us\":%llu,\"log2_us\":[",
+           Elapsed_ms (), op, num, sum_us, max_us);
+  for (size_t i = 0; i < numCounts; i++)
+  {
+    Hprintf (file, i > 0 ? ",%llu" : "%llu", counts[i]);
+  }
+  Hprintf (file, "]}\n");
+}
+
+void Trace::Finish (int exitCode)
+{
+  EndPhase ();
+  EmitHistogram ("delete", deletions.counts, 32, deletions.num, deletions.sum_us, deletions.max_us);
+
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  uint64_t kernel_us = 0, user_us = 0;
+  if (GetProcessTimes (GetCurrentProcess (), &creationTime, &exitTime, &kernelTime, &userTime))
+  {
+    kernel_us = FileTimeTo_us (kernelTime);
+    user_us = FileTimeTo_us (userTime);
+  }
+  IO_COUNTERS io = {};
+  GetProcessIoCounters (GetCurrentProcess (), &io);
+  PROCESS_MEMORY_COUNTERS mem = {};
+  mem.cb = sizeof (mem);
+  K32GetProcessMemoryInfo (GetCurrentProcess (), &mem, sizeof (mem));
+
+  Hprintf (file, "{\"event\":\"process\",\"t_ms\":%llu,\"exit_code\":%d,\"wall_us\":%llu,\"user_us\":%llu,\"kernel_us\":%llu,"
+                 "\"read_bytes\":%llu,\"write_bytes\":%llu,\"read_ops\":%llu,\"write_ops\":%llu,"
+                 "\"peak_working_set\":%llu,\"peak_pagefile\":%llu}\n",
+           Elapsed_ms (), exitCode, TicksToMicroseconds (GetTicks () - startTicks), user_us, kernel_us,
+           io.ReadTransferCount, io.WriteTransferCount, io.ReadOperationCount, io.WriteOperationCount,
+           static_cast<uint64_t> (mem.PeakWorkingSetSize), static_cast<uint64_t> (mem.PeakPagefileUsage));
+}
+
+//---------------------------------------------------------------------------
+
+static std::unique_ptr<Trace> globalTrace;
+
+HRESULT InitTrace (const wchar_t* path)
+{
+  HANDLE file = CreateFileW (path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return HRESULT_FROM_WIN32(GetLastError());
+  }
+  globalTrace.reset (new Trace (file));
+  return S_OK;
+}
+
+Trace* GetTrace ()
+{
+  return globalTrace.get ();
+}
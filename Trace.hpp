@@ -0,0 +1,113 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Machine-readable performance trace
+ */
+#ifndef SEVENI_TRACE_HPP_
+#define SEVENI_TRACE_HPP_
+
+#include "MyUString.hpp"
+
+#include <stdint.h>
+
+#include <Windows.h>
+
+struct CExtractTimings;
+
+/**
+ * Performance trace, written as JSON lines (one event object per line).
+ * Records phase timings, extraction and deletion statistics, and overall
+ * process statistics.
+ */
+class Trace
+{
+public:
+  Trace (HANDLE file);
+  ~Trace ();
+
+  /// Start a new phase. Ends the current phase, if any.
+  void BeginPhase (const char* name);
+  /// End the current phase
+  void EndPhase ();
+
+  /// Record statistics of an extracted archive
+  void ArchiveExtracted (const wchar_t* archive, uint64_t packSize, uint64_t unpackSize,
+                         uint64_t time_us, const CExtractTimings& timings);
+  /// Record duration of a file or directory deletion
+  void AddDeletion (uint64_t time_us);
+
+  /// Emit overall process statistics
+  void Finish (int exitCode);
+
+  /// Timer for measuring durations; extraction timings (CExtractTimings) use it as well
+  static uint64_t GetTicks ();
+  static uint64_t TicksToMicroseconds (uint64_t ticks);
+private:
+  HANDLE file;
+  uint64_t startTicks;
+
+  const char* currentPhase = nullptr;
+  uint64_t phaseStartTicks = 0;
+  uint64_t phaseStartCPU = 0;
+
+  struct Histogram
+  {
+    uint64_t counts[32] = {};
+    uint64_t num = 0;
+    uint64_t sum_us = 0;
+    uint64_t max_us = 0;
+  };
+  Histogram deletions;
+
+  uint64_t Elapsed_ms () const;
+  void EmitHistogram (const char* op, const uint64_t* counts, size_t numCounts,
+                      uint64_t num, uint64_t sum_us, uint64_t max_us);
+};
+
+/// Enable tracing to the given file.
+HRESULT InitTrace (const wchar_t* path);
+/// Get the trace object. Returns nullptr if tracing is disabled.
+Trace* GetTrace ();
+
+/// Helper to record the duration of a deletion in the trace
+class TraceDeletionScope
+{
+  Trace* trace;
+  uint64_t start;
+public:
+  TraceDeletionScope () : trace (GetTrace ()), start (trace ? Trace::GetTicks () : 0) {}
+  ~TraceDeletionScope ()
+  {
+    if (trace) trace->AddDeletion (Trace::TicksToMicroseconds (Trace::GetTicks () - start));
+  }
+};
+
+#endif // SEVENI_TRACE_HPP_
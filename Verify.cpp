@@ -0,0 +1,220 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "Verify.hpp"
+
+#include "ArgsHelper.hpp"
+#include "CommonArgs.hpp"
+#include "Error.hpp"
+#include "ExitCode.hpp"
+#include "InstalledFiles.hpp"
+#include "Manifest.hpp"
+#include "Paths.hpp"
+#include "PathSet.hpp"
+#include "ProgressReporter.hpp"
+#include "RegistryLocations.hpp"
+#include "ResourceGovernor.hpp"
+
+#include <deque>
+
+#include <stdio.h>
+#include <string.h>
+
+// Collect all files below a directory that are not in the known set
+static void FindExtraFiles (const MyUString& dir, const PathSet& known, std::vector<MyUString>& extraFiles)
+{
+  PathNormalizer normalizer;
+  std::deque<MyUString> dirQueue;
+  dirQueue.push_back (dir);
+  while (!dirQueue.empty ())
+  {
+    MyUString currentDir (std::move (dirQueue.front ()));
+    dirQueue.pop_front ();
+
+    MyUString findPattern (currentDir);
+    findPattern += L"\\*";
+    WIN32_FIND_DATAW findData;
+    HANDLE findHandle = FindFirstFileExW (findPattern.Ptr (), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (findHandle == INVALID_HANDLE_VALUE) continue;
+    do
+    {
+      if ((wcscmp (findData.cFileName, L".") == 0) || (wcscmp (findData.cFileName, L"..") == 0)) continue;
+      MyUString fullPath (currentDir);
+      fullPath += L"\\";
+      fullPath += findData.cFileName;
+      if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+      {
+        // Don't follow junctions and symlinks out of the installation
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+          dirQueue.push_back (std::move (fullPath));
+        continue;
+      }
+      MyUString normalized (fullPath);
+      normalizer.Normalize (normalized);
+      if (!known.Contains (normalized))
+        extraFiles.emplace_back (std::move (fullPath));
+    } while (FindNextFileW (findHandle, &findData));
+    FindClose (findHandle);
+  }
+}
+
+int DoVerify (const ArgsHelper& args, BurnPipe& pipe)
+{
+  CommonArgs commonArgs (args);
+  if (!commonArgs.checkValid ())
+  {
+    return ecArgsError;
+  }
+
+  InstallLogLocation logLocation;
+  if (!logLocation.Init (commonArgs))
+  {
+    return ecArgsError;
+  }
+
+  ResourceGovernor governor;
+  if (!governor.Init (args))
+  {
+    return ecArgsError;
+  }
+
+  auto progressOutput = GetDefaultProgress (pipe);
+  ProgressReporterMultiStep actionProgress (*progressOutput);
+  auto progPhaseHash = actionProgress.AddPhase (100, "hash");
+  auto progPhaseExtra = actionProgress.AddPhase (5, "find_extra");
+
+  try
+  {
+    std::vector<ManifestEntry> manifest;
+    try
+    {
+      manifest = ReadManifest (logLocation.GetManifestFilename ().Ptr());
+    }
+    catch (const HRESULTException& e)
+    {
+      fprintf (stderr, "Error reading manifest %ls: %ls\n", logLocation.GetManifestFilename ().Ptr(),
+               GetHRESULTString (e.GetHR()).Ptr());
+      fprintf (stderr, "A manifest is recorded when installing with --manifest.\n");
+      return e.GetHR();
+    }
+
+    std::vector<MyUString> paths;
+    paths.reserve (manifest.size ());
+    for (const auto& entry : manifest)
+      paths.push_back (entry.path);
+    auto hashes = HashFiles (paths, governor, actionProgress.GetPhase (progPhaseHash));
+
+    size_t numMissing = 0, numModified = 0, numUnreadable = 0;
+    for (size_t i = 0; i < manifest.size (); i++)
+    {
+      const auto& expected = manifest[i].hash;
+      const auto& actual = hashes[i];
+      const wchar_t* path = manifest[i].path.Ptr();
+      if ((actual.error == ERROR_FILE_NOT_FOUND) || (actual.error == ERROR_PATH_NOT_FOUND))
+      {
+        printf ("Missing: %ls\n", path);
+        ++numMissing;
+      }
+      else if (actual.error != ERROR_SUCCESS)
+      {
+        printf ("Unreadable: %ls: %ls\n", path, GetErrorString (actual.error).Ptr());
+        ++numUnreadable;
+      }
+      else if (actual.isDir || (actual.size != expected.size)
+               || (memcmp (actual.digest, expected.digest, sizeof (actual.digest)) != 0))
+      {
+        printf ("Modified: %ls\n", path);
+        ++numModified;
+      }
+      else if (actual.mTime != expected.mTime)
+      {
+        // Same content, just touched
+        printf ("Timestamp changed: %ls\n", path);
+      }
+    }
+
+    // Anything in the installation directory not installed by us?
+    auto& progExtra = actionProgress.GetPhase (progPhaseExtra);
+    progExtra.SetTotal (1);
+    std::vector<MyUString> extraFiles;
+    MyUString outputDir;
+    try
+    {
+      outputDir = ReadRegistryOutputDir (commonArgs.GetInstallScope (), commonArgs.GetGUID ());
+    }
+    catch (const HRESULTException& e)
+    {
+      fprintf (stderr, "Error determining installation directory: %ls\n", GetHRESULTString (e.GetHR()).Ptr());
+    }
+    if (!outputDir.IsEmpty ())
+    {
+      PathSet known;
+      for (const auto& path : paths)
+        known.Insert (path);
+      // Artifacts are in the installed files list, but not the manifest
+      try
+      {
+        auto listFilePath = ReadRegistryListFilePath (commonArgs.GetInstallScope (), commonArgs.GetGUID ());
+        InstalledFilesReader listReader (listFilePath.Ptr ());
+        MyUString installedFile;
+        while (!(installedFile = listReader.GetFileName()).IsEmpty())
+          known.Insert (installedFile);
+      }
+      catch (const HRESULTException&)
+      {
+        // Manifest only, then
+      }
+
+      while ((outputDir.Len() > 1) && (outputDir.Ptr()[outputDir.Len() - 1] == '\\'))
+        outputDir.DeleteFrom (outputDir.Len() - 1);
+      FindExtraFiles (outputDir, known, extraFiles);
+      for (const auto& extra : extraFiles)
+        printf ("Extra: %ls\n", extra.Ptr());
+    }
+    progExtra.SetCompleted (1);
+
+    printf ("Verified %zu file(s): %zu missing, %zu modified, %zu unreadable, %zu extra\n",
+            manifest.size (), numMissing, numModified, numUnreadable, extraFiles.size ());
+    // Extra files may well be created by the product itself, so they don't fail verification
+    if ((numMissing + numModified + numUnreadable) > 0) return ecVerifyFailed;
+  }
+  catch (const HRESULTException& e)
+  {
+    fprintf (stderr, "Error during action: %ls\n", GetHRESULTString (e.GetHR()).Ptr());
+    return e.GetHR();
+  }
+  catch (const std::exception& e)
+  {
+    fprintf (stderr, "Error during action: %s\n", e.what());
+    return ecException;
+  }
+
+  return ecSuccess;
+}
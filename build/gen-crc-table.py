@@ -0,0 +1,41 @@
+#!env python
+
+import argparse
+
+# Generate the slicing-by-8 CRC32 table used by 7zCrc.c, so it doesn't have
+# to be computed at startup.
+
+CRC_POLY = 0xEDB88320
+NUM_TABLES = 8
+
+def generate_table():
+  table = []
+  for i in range(256):
+    r = i
+    for j in range(8):
+      r = (r >> 1) ^ (CRC_POLY if (r & 1) else 0)
+    table.append(r)
+  for i in range(256, 256 * NUM_TABLES):
+    r = table[i - 256]
+    table.append(table[r & 0xFF] ^ (r >> 8))
+  return table
+
+def write_header(out, table):
+  out.write("/* 7zCrcTable.h -- Precomputed CRC32 tables (little-endian layout)\n")
+  out.write("   Generated by build/gen-crc-table.py - do not edit */\n\n")
+  out.write("#define CRC_TABLE_PRECOMPUTED_NUM_TABLES %d\n\n" % NUM_TABLES)
+  out.write("const UInt32 g_CrcTable[256 * CRC_NUM_TABLES] =\n{\n")
+  for i in range(0, len(table), 6):
+    row = ", ".join("0x%08X" % v for v in table[i:i + 6])
+    out.write("  %s%s\n" % (row, "," if i + 6 < len(table) else ""))
+  out.write("};\n")
+
+def main():
+  parser = argparse.ArgumentParser(description="Generate CRC32 tables for 7zCrc.c")
+  parser.add_argument("-o", dest="output", required=True, help="Output header file")
+  args = parser.parse_args()
+  with open(args.output, "w", newline="\n") as out:
+    write_header(out, generate_table())
+
+if __name__ == "__main__":
+  main()
@@ -41,8 +41,10 @@
 #include "ExitCode.hpp"
 #include "Extract.hpp"
 #include "LogFile.hpp"
+#include "Trace.hpp"
 
 #include "InstallRemove.hpp"
+#include "Verify.hpp"
 
 #include "7zCrc.h"
 
@@ -61,7 +63,22 @@ static void PrintHelp (const wchar_t* exe)
     printf ("Syntax:\n");
     printf ("\t%ls install [-L<log file>] [-M|-U] [-D<data dir>|-d<data dir name>] -g<GUID> -o<DIR> <archive.7z>...\n", exe);
     printf ("\t%ls repair [-L<log file>] [-M|-U] [-D<data dir>|-d<data dir name>] -g<GUID> <archive.7z>...\n", exe);
+    printf ("\t%ls upgrade [-L<log file>] [-M|-U] [-D<data dir>|-d<data dir name>] -g<GUID> --from=<old GUID> <archive.7z>...\n", exe);
     printf ("\t%ls remove [-L<log file>] [-M|-U] -g<GUID> [--ignore-dependents]\n", exe);
+    printf ("\t%ls verify [-L<log file>] [-M|-U] [-D<data dir>|-d<data dir name>] -g<GUID>\n", exe);
+    printf ("\nAll commands accept --trace=<file> to write a performance trace (JSON lines).\n");
+    printf ("install and repair accept --threads=<N> and --max-memory=<size> (e.g. 512m, 50%%) to limit resource use.\n");
+    printf ("install and repair accept --io-profile=<auto|ssd|hdd|network>, --io-buffer=<size> and --no-preallocate to tune file I/O.\n");
+    printf ("install and repair accept --overwrite=<in-place|delete> to choose how existing files are replaced (default: in-place).\n");
+    printf ("install and repair accept --sparse to write zero-filled regions of files as holes, saving disk space and writes.\n");
+    printf ("install and repair accept --map-output=<size|off> to write files of at least that size through a file mapping (default: 64m).\n");
+    printf ("install and repair accept --read-ahead=<0-8> to read that many buffers of archive data ahead on a background thread (0: off).\n");
+    printf ("install and repair accept --stream to extract tarballs (optionally xz or zstd compressed) while they are still being written; '-' reads standard input.\n");
+    printf ("install and repair accept --dedup[=<store dir>] to hard-link identical files of all products to one stored copy; remove cleans up the store.\n");
+    printf ("install and repair accept --cache[=<dir>] and --cache-size=<size> to reuse previously extracted files instead of decompressing them again.\n");
+    printf ("Archives embedded in another file can be given as <file>@<offset>:<length> to read them in place.\n");
+    printf ("install and repair accept --manifest to record sizes and content hashes of installed files for verify.\n");
+    printf ("upgrade accepts the install and repair options; it keeps files of <old GUID> that did not change and takes over its dependents.\n");
 }
 
 enum ECommand
@@ -69,7 +86,9 @@ enum ECommand
     cmdUnknown,
     cmdInstall,
     cmdRepair,
-    cmdRemove
+    cmdUpgrade,
+    cmdRemove,
+    cmdVerify
 };
 
 int wmain (int argc, const wchar_t* const argv[])
@@ -81,10 +100,17 @@ int wmain (int argc, const wchar_t* const argv[])
          - GUID is used to identify contents for uninstall later
         repair -g<GUID> <archive.7z> ...
          (almost synonymous for install, uses previously set output dir)
+        upgrade -g<GUID> --from=<old GUID> <archive.7z> ...
+         - Replace the installation of <old GUID> with the archive contents
+         - Files with the same size and CRC as installed are not extracted again
+         - Files not in the archives anymore are removed
+         - <old GUID> is unregistered, its dependents are moved to GUID
         remove -g<GUID> [--ignore-dependents]
          - Uninstall previously installed files
          - --ignore-dependents - ignore registry dependency infos
          - -r - Remove output directory used at install time
+        verify -g<GUID>
+         - Check installed files against the manifest recorded by install --manifest
 
      TODO: extract
          - no logging
@@ -134,10 +160,18 @@ int wmain (int argc, const wchar_t* const argv[])
     {
         cmd = cmdRepair;
     }
+    else if (wcscmp (argv[command_index], L"upgrade") == 0)
+    {
+        cmd = cmdUpgrade;
+    }
     else if (wcscmp (argv[command_index], L"remove") == 0)
     {
         cmd = cmdRemove;
     }
+    else if (wcscmp (argv[command_index], L"verify") == 0)
+    {
+        cmd = cmdVerify;
+    }
     else
     {
         printf ("Unknown command %ls\n", argv[1]);
@@ -154,7 +188,8 @@ int wmain (int argc, const wchar_t* const argv[])
         filtered_args[num_filtered++] = argv[i];
     }
 
-    // Also used by IsSFX(), so call early in all cases
+    // Also used by IsSFX(), so call early in all cases.
+    // (CRC tables are precomputed; this only picks the CRC update function.)
     CrcGenerateTable();
 
     ArgsHelper args (num_filtered, filtered_args);
@@ -164,15 +199,34 @@ int wmain (int argc, const wchar_t* const argv[])
     // Now return error if any occured during argument initialization
     if (error_result) return *error_result;
 
+    const wchar_t* trace_file = nullptr;
+    if (args.GetOption (L"--trace", trace_file) && trace_file)
+    {
+        HRESULT trace_res = InitTrace (trace_file);
+        if (FAILED(trace_res))
+            fprintf (stderr, "Error creating trace file %ls: %ls\n", trace_file, GetHRESULTString (trace_res).Ptr());
+    }
+
+    int result = 0;
     switch (cmd)
     {
     case cmdInstall:
-        return DoInstallRemove (args, pipe, Action::Install);
+        result = DoInstallRemove (args, pipe, Action::Install);
+        break;
     case cmdRepair:
-        return DoInstallRemove (args, pipe, Action::Repair);
+        result = DoInstallRemove (args, pipe, Action::Repair);
+        break;
+    case cmdUpgrade:
+        result = DoInstallRemove (args, pipe, Action::Upgrade);
+        break;
     case cmdRemove:
-        return DoInstallRemove (args, pipe, Action::Remove);
+        result = DoInstallRemove (args, pipe, Action::Remove);
+        break;
+    case cmdVerify:
+        result = DoVerify (args, pipe);
+        break;
     }
 
-    return 0;
+    if (auto trace = GetTrace ()) trace->Finish (result);
+    return result;
 }
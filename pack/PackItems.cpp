@@ -0,0 +1,109 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "PackItems.hpp"
+
+#include "Error.hpp"
+
+#include "Common/Wildcard.h"
+#include "Windows/FileFind.h"
+#include "Windows/FileName.h"
+
+#include <algorithm>
+
+#include <stdio.h>
+
+using namespace NWindows::NFile;
+
+static void CollectDirectory (const FString& dirPath, const UString& archivePrefix, std::vector<PackItem>& items)
+{
+  std::vector<NFind::CFileInfo> files;
+  std::vector<NFind::CFileInfo> subDirs;
+
+  NFind::CEnumerator enumerator;
+  enumerator.SetDirPrefix (dirPath);
+  NFind::CFileInfo fi;
+  for (;;)
+  {
+    bool found = false;
+    if (!enumerator.Next (fi, found))
+    {
+      DWORD error = GetLastError ();
+      fprintf (stderr, "Error reading directory %ls: %ls\n", fs2us (dirPath).Ptr(), GetErrorString (error).Ptr());
+      THROW_HR(HRESULT_FROM_WIN32 (error));
+    }
+    if (!found) break;
+    if (fi.IsDir ())
+      subDirs.push_back (fi);
+    else
+      files.push_back (fi);
+  }
+
+  auto byName = [](const NFind::CFileInfo& a, const NFind::CFileInfo& b)
+  {
+    return CompareFileNames (fs2us (a.Name), fs2us (b.Name)) < 0;
+  };
+  std::sort (files.begin(), files.end(), byName);
+  std::sort (subDirs.begin(), subDirs.end(), byName);
+
+  for (const auto& file : files)
+  {
+    PackItem item;
+    item.path = archivePrefix + fs2us (file.Name);
+    item.fullPath = dirPath + file.Name;
+    item.size = file.Size;
+    item.mTime = file.MTime;
+    item.attrib = file.Attrib;
+    items.push_back (std::move (item));
+  }
+
+  for (const auto& dir : subDirs)
+  {
+    PackItem item;
+    item.path = archivePrefix + fs2us (dir.Name);
+    item.fullPath = dirPath + dir.Name;
+    item.mTime = dir.MTime;
+    item.attrib = dir.Attrib;
+    item.isDir = true;
+    items.push_back (item);
+
+    CollectDirectory (item.fullPath + FCHAR_PATH_SEPARATOR, item.path + WCHAR_PATH_SEPARATOR, items);
+  }
+}
+
+std::vector<PackItem> CollectPackItems (const FString& sourceDir)
+{
+  FString dirPrefix (sourceDir);
+  NName::NormalizeDirPathPrefix (dirPrefix);
+
+  std::vector<PackItem> items;
+  CollectDirectory (dirPrefix, UString(), items);
+  return items;
+}
@@ -0,0 +1,64 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Files to be packed
+ */
+#ifndef SEVENI_PACK_PACKITEMS_HPP_
+#define SEVENI_PACK_PACKITEMS_HPP_
+
+#include "Common/MyString.h"
+
+#include <vector>
+
+#include <Windows.h>
+
+/// A file or directory to be packed
+struct PackItem
+{
+  /// Path in the archive, relative to the source directory
+  UString path;
+  /// Full path on disk
+  FString fullPath;
+  UInt64 size = 0;
+  FILETIME mTime = {};
+  DWORD attrib = 0;
+  bool isDir = false;
+};
+
+/**
+ * Collect everything below \a sourceDir, in the order it is to be packed:
+ * the files of a directory are kept together, so an installer writes them
+ * one directory at a time. Directories are visited in name order.
+ * Throws a HRESULTException if a directory can't be read.
+ */
+std::vector<PackItem> CollectPackItems (const FString& sourceDir);
+
+#endif // SEVENI_PACK_PACKITEMS_HPP_
@@ -0,0 +1,418 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "PackPatch.hpp"
+
+#include "Error.hpp"
+#include "Patch.hpp"
+
+#include "7zCrc.h"
+
+#include "Windows/FileDir.h"
+#include "Windows/FileIO.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <string.h>
+
+using namespace NWindows::NFile;
+
+// Smallest source block size; shorter matches are not worth an instruction
+static const UInt32 blockSizeMin = 32;
+// Limit for the number of source blocks, bounding the memory for the hash table
+static const UInt64 numBlocksMax = 1 << 21;
+// Added data is written in instructions of at most this size
+static const size_t addSizeMax = 1 << 20;
+// Size of the pieces matches are extended by
+static const size_t matchChunkSize = 1 << 16;
+// Multiplier of the rolling block hash
+static const UInt32 hashMultiplier = 0x01000193;
+
+namespace
+{
+  /// Reads a file through a buffer, at any position
+  class FileWindow
+  {
+  public:
+    FileWindow (const FString& path, size_t bufferSize);
+
+    UInt64 Size () const { return size; }
+    /**
+     * Get \a length bytes at \a pos. \a length is reduced at the end of the
+     * file, and must not be larger than the buffer size.
+     */
+    const Byte* Get (UInt64 pos, size_t& length);
+  private:
+    NIO::CInFile file;
+    std::unique_ptr<Byte[]> buffer;
+    size_t bufferSize;
+    UInt64 bufferPos = 0;
+    size_t bufferLen = 0;
+    UInt64 size = 0;
+  };
+
+  /// Hash table of source blocks, by hash of their contents
+  class BlockTable
+  {
+  public:
+    BlockTable (UInt64 numBlocks);
+
+    /// Add a block, unless one with the same hash is present
+    void Insert (UInt32 hash, UInt32 block);
+    /// Find a block with the given hash
+    bool Find (UInt32 hash, UInt32& block) const;
+  private:
+    struct Slot
+    {
+      UInt32 hash;
+      /// Block index + 1, 0 for an empty slot
+      UInt32 block;
+    };
+    std::vector<Slot> slots;
+    unsigned shift;
+
+    size_t SlotIndex (UInt32 hash) const { return static_cast<size_t> ((hash * 0x9E3779B1u) >> shift); }
+  };
+
+  /// Patch file output
+  class PatchWriter
+  {
+  public:
+    PatchWriter (const FString& path);
+    ~PatchWriter ();
+
+    void Write (const void* data, size_t size);
+    void WriteInstruction (PatchInstruction::Op op, UInt64 offset, UInt64 length);
+    /// Close the patch file, keeping it
+    void Finish ();
+
+    UInt64 Size () const { return written + buffer.size(); }
+  private:
+    FString path;
+    NIO::COutFile file;
+    bool open = true;
+    std::vector<Byte> buffer;
+    UInt64 written = 0;
+
+    void Flush ();
+  };
+} // anonymous namespace
+
+static void ThrowLastError ()
+{
+  DWORD error = GetLastError ();
+  THROW_HR(HRESULT_FROM_WIN32 (error != ERROR_SUCCESS ? error : ERROR_READ_FAULT));
+}
+
+FileWindow::FileWindow (const FString& path, size_t bufferSize)
+  : buffer (new Byte[bufferSize]), bufferSize (bufferSize)
+{
+  if (!file.Open (path) || !file.GetLength (size)) ThrowLastError ();
+}
+
+const Byte* FileWindow::Get (UInt64 pos, size_t& length)
+{
+  if (pos >= size)
+  {
+    length = 0;
+    return buffer.get();
+  }
+  length = static_cast<size_t> (std::min<UInt64> (length, size - pos));
+  if ((pos < bufferPos) || (pos + length > bufferPos + bufferLen))
+  {
+    UInt64 newPosition = 0;
+    UInt32 readSize = static_cast<UInt32> (std::min<UInt64> (bufferSize, size - pos));
+    UInt32 processed = 0;
+    if (!file.Seek (pos, newPosition) || !file.Read (buffer.get(), readSize, processed)) ThrowLastError ();
+    if (processed != readSize)
+    {
+      // File got shorter while reading
+      THROW_HR(HRESULT_FROM_WIN32 (ERROR_HANDLE_EOF));
+    }
+    bufferPos = pos;
+    bufferLen = processed;
+  }
+  return buffer.get() + (pos - bufferPos);
+}
+
+BlockTable::BlockTable (UInt64 numBlocks)
+{
+  unsigned bits = 4;
+  while ((UInt64 (1) << bits) < numBlocks * 2) bits++;
+  slots.resize (size_t (1) << bits);
+  shift = 32 - bits;
+}
+
+void BlockTable::Insert (UInt32 hash, UInt32 block)
+{
+  size_t mask = slots.size() - 1;
+  for (size_t i = SlotIndex (hash); ; i = (i + 1) & mask)
+  {
+    Slot& slot = slots[i];
+    if (slot.block == 0)
+    {
+      slot.hash = hash;
+      slot.block = block + 1;
+      return;
+    }
+    if (slot.hash == hash) return;
+  }
+}
+
+bool BlockTable::Find (UInt32 hash, UInt32& block) const
+{
+  size_t mask = slots.size() - 1;
+  for (size_t i = SlotIndex (hash); ; i = (i + 1) & mask)
+  {
+    const Slot& slot = slots[i];
+    if (slot.block == 0) return false;
+    if (slot.hash == hash)
+    {
+      block = slot.block - 1;
+      return true;
+    }
+  }
+}
+
+PatchWriter::PatchWriter (const FString& path) : path (path)
+{
+  if (!file.Create (path, true)) ThrowLastError ();
+}
+
+PatchWriter::~PatchWriter ()
+{
+  // Not finished: discard
+  if (open)
+  {
+    file.Close ();
+    NDir::DeleteFileAlways (path);
+  }
+}
+
+void PatchWriter::Write (const void* data, size_t size)
+{
+  const Byte* p = static_cast<const Byte*> (data);
+  buffer.insert (buffer.end(), p, p + size);
+  if (buffer.size() >= (1 << 20)) Flush ();
+}
+
+void PatchWriter::WriteInstruction (PatchInstruction::Op op, UInt64 offset, UInt64 length)
+{
+  PatchInstruction instruction;
+  instruction.op = op;
+  instruction.offset = offset;
+  instruction.length = length;
+  uint8_t data[PatchInstruction::size];
+  instruction.Write (data);
+  Write (data, sizeof (data));
+}
+
+void PatchWriter::Flush ()
+{
+  const Byte* p = buffer.data();
+  size_t left = buffer.size();
+  while (left > 0)
+  {
+    UInt32 processed = 0;
+    if (!file.Write (p, static_cast<UInt32> (std::min<size_t> (left, 1 << 20)), processed) || (processed == 0))
+      ThrowLastError ();
+    p += processed;
+    left -= processed;
+  }
+  written += buffer.size();
+  buffer.clear();
+}
+
+void PatchWriter::Finish ()
+{
+  Flush ();
+  if (!file.Close ()) ThrowLastError ();
+  open = false;
+}
+
+static UInt32 HashBlock (const Byte* data, UInt32 size)
+{
+  UInt32 hash = 0;
+  for (UInt32 i = 0; i < size; i++)
+    hash = hash * hashMultiplier + data[i];
+  return hash;
+}
+
+// Compute the CRC of a file and, if \a table is given, add all its blocks to it
+static UInt32 ScanSource (FileWindow& file, UInt32 blockSize, BlockTable* table)
+{
+  UInt32 crc = CRC_INIT_VAL;
+  UInt64 pos = 0;
+  while (pos < file.Size())
+  {
+    size_t length = matchChunkSize;
+    const Byte* data = file.Get (pos, length);
+    crc = CrcUpdate (crc, data, length);
+    if (table)
+    {
+      // The chunk size is a multiple of the block size, so blocks don't straddle chunks
+      for (size_t b = 0; b + blockSize <= length; b += blockSize)
+        table->Insert (HashBlock (data + b, blockSize), static_cast<UInt32> ((pos + b) / blockSize));
+    }
+    pos += length;
+  }
+  return CRC_GET_DIGEST (crc);
+}
+
+// Number of bytes that are equal in source and target, from the given positions on
+static UInt64 MatchForward (FileWindow& source, UInt64 sourcePos, FileWindow& target, UInt64 targetPos)
+{
+  UInt64 total = 0;
+  for (;;)
+  {
+    size_t sourceLength = matchChunkSize;
+    const Byte* s = source.Get (sourcePos + total, sourceLength);
+    size_t length = sourceLength;
+    const Byte* t = target.Get (targetPos + total, length);
+    if (length == 0) break;
+    size_t n = 0;
+    while ((n < length) && (s[n] == t[n])) n++;
+    total += n;
+    if (n < length) break;
+  }
+  return total;
+}
+
+// Number of bytes at the end of \a literals that equal the source bytes before \a sourcePos
+static size_t MatchBackward (FileWindow& source, UInt64 sourcePos, const std::vector<Byte>& literals)
+{
+  size_t total = 0;
+  while ((total < literals.size()) && (total < sourcePos))
+  {
+    size_t length = static_cast<size_t> (std::min<UInt64> (std::min<size_t> (literals.size() - total, 4096), sourcePos - total));
+    const Byte* s = source.Get (sourcePos - total - length, length);
+    const Byte* l = literals.data() + literals.size() - total - length;
+    size_t n = 0;
+    while ((n < length) && (s[length - 1 - n] == l[length - 1 - n])) n++;
+    total += n;
+    if (n < length) break;
+  }
+  return total;
+}
+
+bool CreatePatch (const FString& sourcePath, const FString& targetPath, const FString& patchPath,
+                  UInt64 maxPatchSize, UInt64& patchSize)
+{
+  FileWindow source (sourcePath, matchChunkSize * 4);
+  FileWindow target (targetPath, matchChunkSize * 16);
+
+  UInt32 blockSize = blockSizeMin;
+  while (source.Size() / blockSize > numBlocksMax) blockSize *= 2;
+  UInt64 numBlocks = source.Size() / blockSize;
+  // Powers of the multiplier, for removing the byte leaving the hash window
+  UInt32 leavingFactor = 1;
+  for (UInt32 i = 1; i < blockSize; i++) leavingFactor *= hashMultiplier;
+
+  BlockTable table (numBlocks);
+  PatchHeader header;
+  header.sourceSize = source.Size();
+  header.sourceCrc = ScanSource (source, blockSize, &table);
+  header.targetSize = target.Size();
+  header.targetCrc = ScanSource (target, blockSize, nullptr);
+
+  PatchWriter writer (patchPath);
+  uint8_t headerData[PatchHeader::size];
+  header.Write (headerData);
+  writer.Write (headerData, sizeof (headerData));
+
+  std::vector<Byte> literals;
+  auto flushLiterals = [&]()
+  {
+    if (literals.empty()) return;
+    writer.WriteInstruction (PatchInstruction::Add, 0, literals.size());
+    writer.Write (literals.data(), literals.size());
+    literals.clear();
+  };
+
+  UInt64 pos = 0;
+  UInt32 hash = 0;
+  bool haveHash = false;
+  while ((numBlocks > 0) && (pos + blockSize <= target.Size()))
+  {
+    if (writer.Size() + literals.size() > maxPatchSize) return false;
+
+    // The block at pos, and the byte entering the hash window next
+    size_t length = blockSize + 1;
+    const Byte* window = target.Get (pos, length);
+    if (!haveHash)
+    {
+      hash = HashBlock (window, blockSize);
+      haveHash = true;
+    }
+
+    UInt32 block;
+    if (table.Find (hash, block))
+    {
+      UInt64 sourcePos = static_cast<UInt64> (block) * blockSize;
+      size_t sourceLength = blockSize;
+      const Byte* sourceBlock = source.Get (sourcePos, sourceLength);
+      if ((sourceLength == blockSize) && (memcmp (sourceBlock, window, blockSize) == 0))
+      {
+        UInt64 matchLength = blockSize + MatchForward (source, sourcePos + blockSize, target, pos + blockSize);
+        size_t back = MatchBackward (source, sourcePos, literals);
+        literals.resize (literals.size() - back);
+        flushLiterals ();
+        writer.WriteInstruction (PatchInstruction::Copy, sourcePos - back, matchLength + back);
+        pos += matchLength;
+        haveHash = false;
+        continue;
+      }
+    }
+
+    literals.push_back (window[0]);
+    if (literals.size() >= addSizeMax) flushLiterals ();
+    if (length > blockSize)
+      hash = (hash - window[0] * leavingFactor) * hashMultiplier + window[blockSize];
+    pos++;
+  }
+  // No block fits anymore
+  while (pos < target.Size())
+  {
+    size_t length = matchChunkSize;
+    const Byte* data = target.Get (pos, length);
+    literals.insert (literals.end(), data, data + length);
+    if (literals.size() >= addSizeMax) flushLiterals ();
+    pos += length;
+  }
+  flushLiterals ();
+  writer.WriteInstruction (PatchInstruction::End, 0, 0);
+  if (writer.Size() > maxPatchSize) return false;
+
+  patchSize = writer.Size();
+  writer.Finish ();
+  return true;
+}
@@ -0,0 +1,50 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Patches against files of an earlier version
+ */
+#ifndef SEVENI_PACK_PACKPATCH_HPP_
+#define SEVENI_PACK_PACKPATCH_HPP_
+
+#include "Common/MyString.h"
+
+/**
+ * Create a patch that turns \a sourcePath into \a targetPath, written to
+ * \a patchPath (see Patch.hpp for the format). Blocks of the source are
+ * hashed, and looked for at every position of the target; matches are
+ * extended in both directions and copied, everything else is added.
+ * Returns false, and leaves no patch file, if the patch would be larger than
+ * \a maxPatchSize. Throws a HRESULTException on I/O errors.
+ */
+bool CreatePatch (const FString& sourcePath, const FString& targetPath, const FString& patchPath,
+                  UInt64 maxPatchSize, UInt64& patchSize);
+
+#endif // SEVENI_PACK_PACKPATCH_HPP_
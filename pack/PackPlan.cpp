@@ -0,0 +1,144 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "PackPlan.hpp"
+
+#include "Alloc.h"
+#include "Lzma2Dec.h"
+#include "Lzma2Enc.h"
+
+#include <algorithm>
+#include <memory>
+
+#include <Windows.h>
+
+// LZMA2 chunk size limits; the upper limit is the LZMA2 encoder default for large dictionaries
+static const uint32_t chunkSizeMin = 1 << 20;
+static const uint32_t chunkSizeMax = 1 << 28;
+// Number of chunks each core should get at least, so the load evens out
+static const uint64_t chunksPerCore = 2;
+// Limit for the buffers needed to decode one chunk per core during installation
+static const uint64_t decodeMemoryMax = 1 << 30;
+// Minimum total time for decode rate measurement, in seconds
+static const double measureTimeMin = 0.1;
+
+PackPlan MakePackPlan (uint64_t totalSize, uint32_t targetCores, uint32_t level)
+{
+  PackPlan plan;
+  plan.targetCores = std::max<uint32_t> (targetCores, 1);
+  plan.level = level;
+
+  CLzmaEncProps lzmaProps;
+  LzmaEncProps_Init (&lzmaProps);
+  lzmaProps.level = static_cast<int> (level);
+  LzmaEncProps_Normalize (&lzmaProps);
+
+  /* Start with the LZMA2 encoder default, but make chunks small enough that
+   * all cores get work, without needing excessive memory for decoding */
+  uint64_t chunkSize = std::min<uint64_t> (std::max<uint64_t> (static_cast<uint64_t> (lzmaProps.dictSize) * 4, chunkSizeMin), chunkSizeMax);
+  while ((chunkSize > chunkSizeMin)
+         && ((totalSize / chunkSize < chunksPerCore * plan.targetCores) || (chunkSize * plan.targetCores > decodeMemoryMax)))
+    chunkSize /= 2;
+  plan.chunkSize = static_cast<uint32_t> (chunkSize);
+  // Matches can't reach beyond the start of a chunk anyway
+  plan.dictSize = static_cast<uint32_t> (std::min<uint64_t> (lzmaProps.dictSize, chunkSize));
+  plan.solidBlockSize = chunkSize * plan.targetCores;
+  return plan;
+}
+
+static double GetSeconds ()
+{
+  LARGE_INTEGER counter, frequency;
+  QueryPerformanceCounter (&counter);
+  QueryPerformanceFrequency (&frequency);
+  return static_cast<double> (counter.QuadPart) / static_cast<double> (frequency.QuadPart);
+}
+
+double MeasureDecodeRate (const uint8_t* data, size_t size, const PackPlan& plan)
+{
+  if (size == 0) return 0;
+
+  CLzma2EncHandle enc = Lzma2Enc_Create (&g_Alloc, &g_BigAlloc);
+  if (!enc) return 0;
+  CLzma2EncProps props;
+  Lzma2EncProps_Init (&props);
+  props.lzmaProps.level = static_cast<int> (plan.level);
+  props.lzmaProps.dictSize = plan.dictSize;
+  props.blockSize = plan.chunkSize;
+  props.numTotalThreads = 1;
+  size_t packedSize = size + size / 16 + (1 << 16);
+  std::unique_ptr<Byte[]> packed (new Byte[packedSize]);
+  SRes res = Lzma2Enc_SetProps (enc, &props);
+  Byte prop = Lzma2Enc_WriteProperties (enc);
+  if (res == SZ_OK)
+    res = Lzma2Enc_Encode2 (enc, nullptr, packed.get(), &packedSize, nullptr, data, size, nullptr);
+  Lzma2Enc_Destroy (enc);
+  if (res != SZ_OK) return 0;
+
+  // Decode repeatedly, so timer resolution doesn't matter
+  std::unique_ptr<Byte[]> unpacked (new Byte[size]);
+  uint64_t totalDecoded = 0;
+  double start = GetSeconds ();
+  double elapsed;
+  do
+  {
+    SizeT destLen = size;
+    SizeT srcLen = packedSize;
+    ELzmaStatus status;
+    if (Lzma2Decode (unpacked.get(), &destLen, packed.get(), &srcLen, prop, LZMA_FINISH_END, &status, &g_Alloc) != SZ_OK)
+      return 0;
+    totalDecoded += destLen;
+    elapsed = GetSeconds () - start;
+  } while (elapsed < measureTimeMin);
+  return static_cast<double> (totalDecoded) / elapsed;
+}
+
+double PredictThroughput (const std::vector<uint64_t>& solidBlockSizes, const PackPlan& plan, double coreDecodeRate)
+{
+  if (coreDecodeRate <= 0) return 0;
+
+  uint64_t totalSize = 0;
+  double seconds = 0;
+  for (uint64_t blockSize : solidBlockSizes)
+  {
+    if (blockSize == 0) continue;
+    totalSize += blockSize;
+
+    /* Chunks are decoded in "waves" of one chunk per core. All waves but the
+     * last take as long as a full chunk; the last one as long as its largest chunk. */
+    uint64_t numChunks = (blockSize + plan.chunkSize - 1) / plan.chunkSize;
+    uint64_t numWaves = (numChunks + plan.targetCores - 1) / plan.targetCores;
+    uint64_t lastChunkSize = blockSize - (numChunks - 1) * plan.chunkSize;
+    bool lastWaveHasFullChunk = (numWaves - 1) * plan.targetCores < numChunks - 1;
+    uint64_t criticalSize = (numWaves - 1) * plan.chunkSize + (lastWaveHasFullChunk ? plan.chunkSize : lastChunkSize);
+    seconds += static_cast<double> (criticalSize) / coreDecodeRate;
+  }
+  return seconds > 0 ? static_cast<double> (totalSize) / seconds : 0;
+}
@@ -0,0 +1,79 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Compression parameters for fast installation
+ */
+#ifndef SEVENI_PACK_PACKPLAN_HPP_
+#define SEVENI_PACK_PACKPLAN_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/**
+ * How an archive is laid out for installation on a given number of cores.
+ * Installation decodes solid blocks one after the other, and the LZMA2
+ * chunks within a solid block in parallel. So solid blocks are sized to
+ * give every core one chunk to decode.
+ */
+struct PackPlan
+{
+  /// Number of cores the archive is optimized for
+  uint32_t targetCores;
+  /// Compression level (1-9)
+  uint32_t level;
+  /// LZMA dictionary size
+  uint32_t dictSize;
+  /// Size of independently decodable LZMA2 chunks
+  uint32_t chunkSize;
+  /// Maximum (uncompressed) size of a solid block
+  uint64_t solidBlockSize;
+};
+
+/// Choose compression parameters for \a totalSize bytes of input
+PackPlan MakePackPlan (uint64_t totalSize, uint32_t targetCores, uint32_t level);
+
+/**
+ * Measure single-threaded decoding speed (uncompressed bytes per second)
+ * by compressing and decoding \a data with the parameters from \a plan.
+ * Returns 0 if the measurement failed.
+ */
+double MeasureDecodeRate (const uint8_t* data, size_t size, const PackPlan& plan);
+
+/**
+ * Predict install throughput (uncompressed bytes per second), given the
+ * uncompressed sizes of the solid blocks of the archive and the decoding
+ * speed of a single core. Only decoding is taken into account.
+ */
+double PredictThroughput (const std::vector<uint64_t>& solidBlockSizes, const PackPlan& plan, double coreDecodeRate);
+
+#endif // SEVENI_PACK_PACKPLAN_HPP_
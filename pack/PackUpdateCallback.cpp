@@ -0,0 +1,114 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+#include "PackUpdateCallback.hpp"
+
+#include "Error.hpp"
+
+#include "Windows/PropVariant.h"
+#include "7zip/Common/FileStreams.h"
+
+#include <stdio.h>
+
+STDMETHODIMP PackUpdateCallback::SetTotal (UInt64 size)
+{
+  total = size;
+  return S_OK;
+}
+
+STDMETHODIMP PackUpdateCallback::SetCompleted (const UInt64* completeValue)
+{
+  if (!completeValue || (total == 0)) return S_OK;
+  unsigned percent = static_cast<unsigned> (*completeValue * 100 / total);
+  if (percent != lastPercent)
+  {
+    printf ("\r%3u%%", percent);
+    fflush (stdout);
+    lastPercent = percent;
+  }
+  return S_OK;
+}
+
+STDMETHODIMP PackUpdateCallback::GetUpdateItemInfo (UInt32 /*index*/, Int32* newData, Int32* newProps, UInt32* indexInArchive)
+{
+  if (newData) *newData = 1;
+  if (newProps) *newProps = 1;
+  if (indexInArchive) *indexInArchive = static_cast<UInt32> (-1);
+  return S_OK;
+}
+
+STDMETHODIMP PackUpdateCallback::GetProperty (UInt32 index, PROPID propID, PROPVARIANT* value)
+{
+  if (index >= items.size()) return E_INVALIDARG;
+  const PackItem& item = items[index];
+
+  NWindows::NCOM::CPropVariant prop;
+  switch (propID)
+  {
+  case kpidPath:    prop = item.path; break;
+  case kpidIsDir:   prop = item.isDir; break;
+  case kpidSize:    prop = item.size; break;
+  case kpidMTime:   prop = item.mTime; break;
+  case kpidAttrib:  prop = static_cast<UInt32> (item.attrib); break;
+  case kpidIsAnti:  prop = false; break;
+  }
+  prop.Detach (value);
+  return S_OK;
+}
+
+STDMETHODIMP PackUpdateCallback::GetStream (UInt32 index, ISequentialInStream** inStream)
+{
+  *inStream = nullptr;
+  if (index >= items.size()) return E_INVALIDARG;
+  const PackItem& item = items[index];
+  if (item.isDir) return S_OK;
+  currentIndex = index;
+
+  CInFileStream* inStreamSpec = new CInFileStream;
+  CMyComPtr<ISequentialInStream> stream (inStreamSpec);
+  if (!inStreamSpec->OpenSequential (item.fullPath))
+  {
+    DWORD error = GetLastError ();
+    fprintf (stderr, "\nError opening %ls: %ls\n", fs2us (item.fullPath).Ptr(), GetErrorString (error).Ptr());
+    return HRESULT_FROM_WIN32 (error);
+  }
+  *inStream = stream.Detach ();
+  return S_OK;
+}
+
+STDMETHODIMP PackUpdateCallback::SetOperationResult (Int32 operationResult)
+{
+  if (operationResult != NArchive::NUpdate::NOperationResult::kOK)
+  {
+    fprintf (stderr, "\nError reading %ls\n", fs2us (items[currentIndex].fullPath).Ptr());
+    return E_FAIL;
+  }
+  return S_OK;
+}
@@ -0,0 +1,60 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**\file
+ * Archive update callback for packing files from disk
+ */
+#ifndef SEVENI_PACK_PACKUPDATECALLBACK_HPP_
+#define SEVENI_PACK_PACKUPDATECALLBACK_HPP_
+
+#include "PackItems.hpp"
+
+#include "Common/MyCom.h"
+#include "7zip/Archive/IArchive.h"
+
+/**
+ * Supplies the collected items to an archive handler. Items are all new;
+ * progress is printed as a percentage.
+ */
+class PackUpdateCallback : public IArchiveUpdateCallback, public CMyUnknownImp
+{
+  const std::vector<PackItem>& items;
+  UInt64 total = 0;
+  unsigned lastPercent = ~0u;
+  UInt32 currentIndex = 0;
+public:
+  PackUpdateCallback (const std::vector<PackItem>& items) : items (items) {}
+
+  MY_UNKNOWN_IMP1(IArchiveUpdateCallback)
+
+  INTERFACE_IArchiveUpdateCallback(;)
+};
+
+#endif // SEVENI_PACK_PACKUPDATECALLBACK_HPP_
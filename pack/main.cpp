@@ -0,0 +1,341 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+ */
+
+/**
+ * SevenPack - create 7z archives laid out for fast installation with SevenInstall
+ */
+#include "Common/MyInitGuid.h" // Must be placed before any header originating from 7zip
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+
+#include "ArgsHelper.hpp"
+#include "Error.hpp"
+#include "Patch.hpp"
+#include "SfxLocator.hpp"
+
+#include "PackItems.hpp"
+#include "PackPatch.hpp"
+#include "PackPlan.hpp"
+#include "PackUpdateCallback.hpp"
+
+#include "7zCrc.h"
+
+#include "Common/Common.h"
+#include "Windows/FileDir.h"
+#include "Windows/FileFind.h"
+#include "Windows/PropVariant.h"
+#include "Windows/System.h"
+#include "7zip/Archive/7z/7zHandler.h"
+#include "7zip/Common/FileStreams.h"
+#include "7zip/Common/StreamUtils.h"
+
+#include <algorithm>
+#include <memory>
+
+// Amount of input data used to measure decoding speed
+static const size_t sampleSizeMax = 16 << 20;
+// Smaller files are always packed in full
+static const UInt64 patchSizeMin = 64 << 10;
+
+static void PrintHelp (const wchar_t* exe)
+{
+    printf ("Syntax:\n");
+    printf ("\t%ls [--cores=<N>] [--level=<1-9>] [--threads=<N>] [--sfx=<SevenInstall.exe>]\n", exe);
+    printf ("\t\t[--patch-from=<old source dir> [--patch-fallback]] <archive.7z> <source dir>\n");
+    printf ("\n--cores gives the number of cores to optimize installation for (default: this machine's).\n");
+    printf ("--threads limits the threads used for compression.\n");
+    printf ("--sfx prepends the given executable and appends a locator, creating a self-installing archive.\n");
+    printf ("--patch-from stores files that also exist in the given directory as patches against those,\n"
+            "  if that is less than half the size. Such an archive can only upgrade that exact old version.\n");
+    printf ("--patch-fallback also stores the patched files in full, so installing over other versions works.\n");
+}
+
+static bool GetUIntOption (const ArgsHelper& args, const wchar_t* name, uint32_t minValue, uint32_t maxValue, uint32_t& value)
+{
+    const wchar_t* arg = nullptr;
+    if (!args.GetOption (name, arg)) return true;
+    wchar_t* end = nullptr;
+    unsigned long v = arg ? wcstoul (arg, &end, 10) : 0;
+    if (!arg || (end == arg) || (*end != 0) || (v < minValue) || (v > maxValue))
+    {
+        fprintf (stderr, "Invalid value for %ls: expected a number from %u to %u\n", name, minValue, maxValue);
+        return false;
+    }
+    value = static_cast<uint32_t> (v);
+    return true;
+}
+
+/**
+ * Replace files that also exist in \a oldDir by patches against those, if a
+ * patch is small enough. Patches are created in \a tempDir. Items are ordered
+ * so full files come first, followed by the patches, followed by the full
+ * files of patched items if \a fallback is set: the fallbacks are only
+ * extracted if a patch can't be applied.
+ */
+static void AddPatchItems (std::vector<PackItem>& items, const FString& oldDir, const FString& tempDir, bool fallback)
+{
+    std::vector<PackItem> fullItems;
+    std::vector<PackItem> patchItems;
+    std::vector<PackItem> fallbackItems;
+    UInt64 sizeBefore = 0;
+    UInt64 sizeAfter = 0;
+    for (auto& item : items)
+    {
+        FString oldPath (oldDir + FCHAR_PATH_SEPARATOR + us2fs (item.path));
+        if (item.isDir || (item.size < patchSizeMin) || !NWindows::NFile::NFind::DoesFileExist (oldPath))
+        {
+            fullItems.push_back (std::move (item));
+            continue;
+        }
+
+        wchar_t patchName[16];
+        swprintf (patchName, ARRAY_SIZE(patchName), L"%u", static_cast<unsigned> (patchItems.size()));
+        FString patchPath (tempDir + FCHAR_PATH_SEPARATOR + us2fs (patchName));
+        UInt64 patchSize = 0;
+        if (!CreatePatch (oldPath, item.fullPath, patchPath, item.size / 2, patchSize))
+        {
+            fullItems.push_back (std::move (item));
+            continue;
+        }
+        sizeBefore += item.size;
+        sizeAfter += patchSize;
+
+        PackItem patchItem (item);
+        patchItem.path = UString (patchItemDir) + WCHAR_PATH_SEPARATOR + item.path;
+        patchItem.fullPath = patchPath;
+        patchItem.size = patchSize;
+        patchItems.push_back (std::move (patchItem));
+        if (fallback) fallbackItems.push_back (std::move (item));
+    }
+    printf ("Patched %u file(s), %llu MiB in %llu MiB of patches\n",
+            static_cast<unsigned> (patchItems.size()), sizeBefore >> 20, sizeAfter >> 20);
+
+    items = std::move (fullItems);
+    items.insert (items.end(), patchItems.begin(), patchItems.end());
+    items.insert (items.end(), fallbackItems.begin(), fallbackItems.end());
+}
+
+// Read the start of the input, in packing order, for measuring decode speed
+static std::vector<uint8_t> ReadSample (const std::vector<PackItem>& items)
+{
+    std::vector<uint8_t> sample;
+    for (const auto& item : items)
+    {
+        if (item.isDir || (item.size == 0)) continue;
+        size_t readSize = static_cast<size_t> (std::min<UInt64> (item.size, sampleSizeMax - sample.size()));
+        CInFileStream* streamSpec = new CInFileStream;
+        CMyComPtr<ISequentialInStream> stream (streamSpec);
+        if (!streamSpec->OpenSequential (item.fullPath)) continue;
+        size_t oldSize = sample.size();
+        sample.resize (oldSize + readSize);
+        if (ReadStream (stream, sample.data() + oldSize, &readSize) != S_OK) readSize = 0;
+        sample.resize (oldSize + readSize);
+        if (sample.size() >= sampleSizeMax) break;
+    }
+    return sample;
+}
+
+static void CopyStub (const wchar_t* stubPath, ISequentialOutStream* outStream, UInt64& stubSize)
+{
+    CInFileStream* stubSpec = new CInFileStream;
+    CMyComPtr<ISequentialInStream> stub (stubSpec);
+    if (!stubSpec->OpenSequential (stubPath))
+    {
+        DWORD error = GetLastError ();
+        fprintf (stderr, "Error opening %ls: %ls\n", stubPath, GetErrorString (error).Ptr());
+        THROW_HR(HRESULT_FROM_WIN32 (error));
+    }
+    stubSize = 0;
+    Byte buffer[1 << 16];
+    for (;;)
+    {
+        size_t size = sizeof (buffer);
+        CHECK_HR(ReadStream (stub, buffer, &size));
+        if (size == 0) break;
+        CHECK_HR(WriteStream (outStream, buffer, size));
+        stubSize += size;
+    }
+}
+
+static void SetArchiveProperties (IOutArchive* outArchive, const PackPlan& plan, uint32_t threads)
+{
+    CMyComPtr<ISetProperties> setProperties;
+    CHECK_HR(outArchive->QueryInterface (IID_ISetProperties, (void**)&setProperties));
+
+    wchar_t method[64];
+    swprintf (method, ARRAY_SIZE(method), L"LZMA2:d=%ub:c=%ub", plan.dictSize, plan.chunkSize);
+    wchar_t solid[32];
+    swprintf (solid, ARRAY_SIZE(solid), L"%llub", static_cast<unsigned long long> (plan.solidBlockSize));
+
+    const wchar_t* names[] = { L"x", L"0", L"s", L"mt", L"hc", L"qs", L"qo" };
+    NWindows::NCOM::CPropVariant values[ARRAY_SIZE(names)];
+    values[0] = static_cast<UInt32> (plan.level);
+    values[1] = method;
+    values[2] = solid;
+    values[3] = static_cast<UInt32> (threads);
+    // An uncompressed header can be read without running a decoder
+    values[4] = false;
+    // Keep the directory grouping of the items
+    values[5] = false;
+    values[6] = true;
+    CHECK_HR(setProperties->SetProperties (names, values, ARRAY_SIZE(names)));
+}
+
+// Get the uncompressed sizes of the solid blocks of the archive just written
+static std::vector<uint64_t> GetSolidBlockSizes (const wchar_t* archivePath, UInt64 archiveOffset)
+{
+    CInFileStream* inStreamSpec = new CInFileStream;
+    CMyComPtr<IInStream> inStream (inStreamSpec);
+    if (!inStreamSpec->Open (archivePath)) THROW_HR(HRESULT_FROM_WIN32 (GetLastError ()));
+    CHECK_HR(inStream->Seek (archiveOffset, STREAM_SEEK_SET, nullptr));
+
+    CMyComPtr<IInArchive> archive (new NArchive::N7z::CHandler);
+    const UInt64 maxCheckStartPosition = 0;
+    CHECK_HR(archive->Open (inStream, &maxCheckStartPosition, nullptr));
+
+    std::vector<uint64_t> blockSizes;
+    UInt32 numItems = 0;
+    CHECK_HR(archive->GetNumberOfItems (&numItems));
+    for (UInt32 i = 0; i < numItems; i++)
+    {
+        NWindows::NCOM::CPropVariant block, size;
+        CHECK_HR(archive->GetProperty (i, kpidBlock, &block));
+        CHECK_HR(archive->GetProperty (i, kpidSize, &size));
+        if ((block.vt != VT_UI4) || (size.vt != VT_UI8)) continue;
+        if (block.ulVal >= blockSizes.size()) blockSizes.resize (block.ulVal + 1);
+        blockSizes[block.ulVal] += size.uhVal.QuadPart;
+    }
+    archive->Close ();
+    return blockSizes;
+}
+
+static int Pack (const ArgsHelper& args, const wchar_t* archivePath, const wchar_t* sourceDir)
+{
+    uint32_t cores = NWindows::NSystem::GetNumberOfProcessors ();
+    uint32_t level = 7;
+    uint32_t threads = cores;
+    if (!GetUIntOption (args, L"--cores", 1, 1024, cores)
+        || !GetUIntOption (args, L"--level", 1, 9, level)
+        || !GetUIntOption (args, L"--threads", 1, 1024, threads))
+        return 1;
+    const wchar_t* sfxStub = nullptr;
+    args.GetOption (L"--sfx", sfxStub);
+    const wchar_t* patchFrom = nullptr;
+    args.GetOption (L"--patch-from", patchFrom);
+    bool patchFallback = args.GetOption (L"--patch-fallback");
+
+    try
+    {
+        // Holds the patches until the archive is written
+        NWindows::NFile::NDir::CTempDir patchDir;
+        auto items = CollectPackItems (us2fs (sourceDir));
+        if (patchFrom)
+        {
+            if (!patchDir.Create (FTEXT ("7ip"))) THROW_HR(HRESULT_FROM_WIN32 (GetLastError ()));
+            AddPatchItems (items, us2fs (patchFrom), patchDir.GetPath(), patchFallback);
+        }
+        UInt64 totalSize = 0;
+        for (const auto& item : items) totalSize += item.size;
+
+        PackPlan plan = MakePackPlan (totalSize, cores, level);
+        printf ("%u files and directories, %llu MiB\n", static_cast<unsigned> (items.size()), totalSize >> 20);
+        printf ("Optimizing for %u core(s): %u MiB solid blocks, %u MiB LZMA2 chunks, %u MiB dictionary\n",
+                plan.targetCores, static_cast<unsigned> (plan.solidBlockSize >> 20), plan.chunkSize >> 20, plan.dictSize >> 20);
+
+        COutFileStream* outStreamSpec = new COutFileStream;
+        CMyComPtr<IOutStream> outStream (outStreamSpec);
+        if (!outStreamSpec->Create (archivePath, true))
+        {
+            DWORD error = GetLastError ();
+            fprintf (stderr, "Error creating %ls: %ls\n", archivePath, GetErrorString (error).Ptr());
+            return 1;
+        }
+
+        UInt64 archiveOffset = 0;
+        if (sfxStub) CopyStub (sfxStub, outStream, archiveOffset);
+
+        NArchive::N7z::CHandler* handlerSpec = new NArchive::N7z::CHandler;
+        CMyComPtr<IOutArchive> outArchive (handlerSpec);
+        SetArchiveProperties (outArchive, plan, threads);
+
+        PackUpdateCallback* callbackSpec = new PackUpdateCallback (items);
+        CMyComPtr<IArchiveUpdateCallback> callback (callbackSpec);
+        CHECK_HR(outArchive->UpdateItems (outStream, static_cast<UInt32> (items.size()), callback));
+        printf ("\n");
+
+        if (sfxStub)
+        {
+            UInt64 archiveEnd = 0;
+            CHECK_HR(outStream->Seek (0, STREAM_SEEK_END, &archiveEnd));
+            SfxLocator locator;
+            locator.archiveOffset = archiveOffset;
+            locator.archiveSize = archiveEnd - archiveOffset;
+            uint8_t locatorData[SfxLocator::size];
+            locator.Write (locatorData);
+            CHECK_HR(WriteStream (outStream, locatorData, sizeof (locatorData)));
+        }
+        CHECK_HR(outStreamSpec->Close ());
+
+        auto sample = ReadSample (items);
+        double coreRate = MeasureDecodeRate (sample.data(), sample.size(), plan);
+        double throughput = PredictThroughput (GetSolidBlockSizes (archivePath, archiveOffset), plan, coreRate);
+        if (throughput > 0)
+        {
+            printf ("Predicted install throughput on %u core(s): %.1f MiB/s (decoding only; %.1f MiB/s per core measured here)\n",
+                    plan.targetCores, throughput / (1 << 20), coreRate / (1 << 20));
+        }
+    }
+    catch (const HRESULTException& e)
+    {
+        fprintf (stderr, "Error creating %ls: %ls\n", archivePath, GetHRESULTString (e.GetHR()).Ptr());
+        return 1;
+    }
+    return 0;
+}
+
+int wmain (int argc, const wchar_t* const argv[])
+{
+    printf ("7z installer packer\n\n");
+
+    // Only picks the CRC update function; the tables are precomputed
+    CrcGenerateTable ();
+
+    ArgsHelper args (argc, argv);
+    std::vector<const wchar_t*> freeArgs;
+    args.GetFreeArgs (freeArgs);
+    if (freeArgs.size() != 2)
+    {
+        PrintHelp (argv[0]);
+        return 1;
+    }
+    return Pack (args, freeArgs[0], freeArgs[1]);
+}
@@ -0,0 +1,243 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+*/
+
+/*
+ * Buffered, asynchronous output to a file handle
+ */
+
+#include "printf.hpp"
+
+#include "printf_impl/OutputBuffer.hpp"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+namespace printf_impl
+{
+    /// Size of output buffer
+    static const size_t outputBufferSize = 1024 * 1024;
+    /// Amount of buffered data that causes the writer thread to wake up immediately
+    static const size_t writeThreshold = 64 * 1024;
+    /// Time after which buffered data is written, even if the threshold was not reached
+    static const DWORD writeDelay = 100;
+
+    bool OutputBuffer::Start (size_t size)
+    {
+        buffer = new (std::nothrow) char[size];
+        if (!buffer) return false;
+        capacity = size;
+        thread = CreateThread (nullptr, 0, &ThreadProc, this, 0, nullptr);
+        if (!thread)
+        {
+            delete[] buffer;
+            buffer = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void OutputBuffer::Stop ()
+    {
+        if (!thread) return;
+
+        AcquireSRWLockExclusive (&lock);
+        stop = true;
+        WakeAllConditionVariable (&dataAvailable);
+        ReleaseSRWLockExclusive (&lock);
+
+        // Writer thread drains the buffer before exiting
+        WaitForSingleObject (thread, INFINITE);
+        CloseHandle (thread);
+        thread = nullptr;
+    }
+
+    DWORD WINAPI OutputBuffer::ThreadProc (void* param)
+    {
+        static_cast<OutputBuffer*> (param)->WriterLoop ();
+        return 0;
+    }
+
+    void OutputBuffer::WriterLoop ()
+    {
+        AcquireSRWLockExclusive (&lock);
+        while (true)
+        {
+            while ((head == tail) && !stop)
+                SleepConditionVariableSRW (&dataAvailable, &lock, INFINITE, 0);
+            if (head == tail) break; // stopped and drained
+
+            // Give producers a chance to accumulate more data
+            if (!stop && (head - tail < writeThreshold) && (flushTarget <= tail))
+                SleepConditionVariableSRW (&dataAvailable, &lock, writeDelay, 0);
+
+            size_t start = tail % capacity;
+            size_t len = head - tail;
+            if (len > capacity - start) len = capacity - start;
+            ReleaseSRWLockExclusive (&lock);
+
+            DWORD bytes_written = 0;
+            BOOL result = WriteFile (handle, buffer + start, static_cast<DWORD> (len), &bytes_written, nullptr);
+
+            AcquireSRWLockExclusive (&lock);
+            // Data is dropped on errors so producers don't block forever
+            if (!result) error = true;
+            tail += len;
+            WakeAllConditionVariable (&spaceAvailable);
+        }
+        ReleaseSRWLockExclusive (&lock);
+    }
+
+    int OutputBuffer::Write (const char* s, size_t n)
+    {
+        AcquireSRWLockExclusive (&lock);
+        size_t done = 0;
+        while ((done < n) && !stop)
+        {
+            while ((head - tail == capacity) && !stop)
+            {
+                WakeConditionVariable (&dataAvailable);
+                SleepConditionVariableSRW (&spaceAvailable, &lock, INFINITE, 0);
+            }
+            if (stop) break;
+
+            size_t start = head % capacity;
+            size_t len = n - done;
+            if (len > capacity - (head - tail)) len = capacity - (head - tail);
+            if (len > capacity - start) len = capacity - start;
+            bool wasEmpty = head == tail;
+            memcpy (buffer + start, s + done, len);
+            head += len;
+            done += len;
+            if (wasEmpty || (head - tail >= writeThreshold))
+                WakeConditionVariable (&dataAvailable);
+        }
+        if (done < n)
+        {
+            // Keep output order: let the writer thread drain the buffer first
+            while (head != tail)
+                SleepConditionVariableSRW (&spaceAvailable, &lock, INFINITE, 0);
+        }
+        bool failed = error;
+        ReleaseSRWLockExclusive (&lock);
+
+        if (done < n)
+        {
+            // Writer thread is gone, write directly
+            DWORD bytes_written = 0;
+            if (!WriteFile (handle, s + done, static_cast<DWORD> (n - done), &bytes_written, nullptr))
+                failed = true;
+        }
+        return failed ? -1 : static_cast<int> (n);
+    }
+
+    bool OutputBuffer::Flush (DWORD timeout)
+    {
+        if (!thread) return true;
+
+        DWORD startTime = GetTickCount ();
+        if (timeout == INFINITE)
+            AcquireSRWLockExclusive (&lock);
+        else
+        {
+            /* Bounded flushes come from the unhandled exception filter: the
+             * crashing thread may hold the lock, so never block on it */
+            while (!TryAcquireSRWLockExclusive (&lock))
+            {
+                if (GetTickCount () - startTime >= timeout) return false;
+                Sleep (1);
+            }
+        }
+        size_t target = head;
+        if (flushTarget < target) flushTarget = target;
+        WakeConditionVariable (&dataAvailable);
+        bool result = true;
+        while (tail < target)
+        {
+            DWORD waitTime = INFINITE;
+            if (timeout != INFINITE)
+            {
+                DWORD elapsed = GetTickCount () - startTime;
+                if (elapsed >= timeout)
+                {
+                    result = false;
+                    break;
+                }
+                waitTime = timeout - elapsed;
+            }
+            SleepConditionVariableSRW (&spaceAvailable, &lock, waitTime, 0);
+        }
+        ReleaseSRWLockExclusive (&lock);
+        return result;
+    }
+} // namespace printf_impl
+
+static printf_impl::OutputBuffer* bufferedOutput = nullptr;
+static LPTOP_LEVEL_EXCEPTION_FILTER prevExceptionFilter = nullptr;
+
+static void StopBufferedOutput ()
+{
+    if (bufferedOutput) bufferedOutput->Stop ();
+}
+
+static LONG WINAPI FlushOnUnhandledException (EXCEPTION_POINTERS* exceptionInfo)
+{
+    // Try to get the log out before the process goes away. Don't wait forever, the writer may be stuck.
+    if (bufferedOutput) bufferedOutput->Flush (1000);
+    return prevExceptionFilter ? prevExceptionFilter (exceptionInfo) : EXCEPTION_CONTINUE_SEARCH;
+}
+
+printf_impl::OutputBuffer* printf_impl::GetOutputBuffer (HANDLE handle)
+{
+    auto buffer = bufferedOutput;
+    return (buffer && (buffer->GetHandle () == handle)) ? buffer : nullptr;
+}
+
+bool BufferHandleOutput (HANDLE handle)
+{
+    if (bufferedOutput) return false;
+
+    auto buffer = new (std::nothrow) printf_impl::OutputBuffer (handle);
+    if (!buffer) return false;
+    if (!buffer->Start (printf_impl::outputBufferSize))
+    {
+        delete buffer;
+        return false;
+    }
+    bufferedOutput = buffer;
+    atexit (&StopBufferedOutput);
+    prevExceptionFilter = SetUnhandledExceptionFilter (&FlushOnUnhandledException);
+    return true;
+}
+
+void FlushBufferedOutput ()
+{
+    if (bufferedOutput) bufferedOutput->Flush ();
+}
@@ -37,6 +37,7 @@
 
 #include "printf.hpp"
 
+#include "printf_impl/BufferedSink.hpp"
 #include "printf_impl/CharBufferSink.hpp"
 #include "printf_impl/HandleSink.hpp"
 #include "printf_impl/WCharBufferSink.hpp"
@@ -71,6 +72,19 @@
         }                                                                   \
     }
 
+// Print to a handle, going through the output buffer if there is one
+template<typename Char>
+static int print_to_handle (HANDLE handle, const Char* format, va_list args)
+{
+    if (auto buffer = printf_impl::GetOutputBuffer (handle))
+    {
+        printf_impl::BufferedSink sink (*buffer);
+        return printf_impl::print (sink, format, args);
+    }
+    printf_impl::HandleSink sink (handle);
+    return printf_impl::print (sink, format, args);
+}
+
 extern "C" int __stdio_common_vfprintf (uint64_t options, FILE* file, const char* format, _locale_t locale, va_list args)
 {
     CHECK_PARAM(file, EINVAL, -1);
@@ -81,8 +95,7 @@ extern "C" int __stdio_common_vfprintf (uint64_t options, FILE* file, const char
     {
         HANDLE h = GetStdHandle ((file == stdout) ? STD_OUTPUT_HANDLE : STD_ERROR_HANDLE);
         CHECK_PARAM(h != INVALID_HANDLE_VALUE, EBADF, -1);
-        printf_impl::HandleSink sink (h);
-        return printf_impl::print (sink, format, args);
+        return print_to_handle (h, format, args);
     }
 
     return -1;
@@ -98,8 +111,7 @@ extern "C" int __stdio_common_vfwprintf (uint64_t options, FILE* file, const wch
     {
         HANDLE h = GetStdHandle ((file == stdout) ? STD_OUTPUT_HANDLE : STD_ERROR_HANDLE);
         CHECK_PARAM(h != INVALID_HANDLE_VALUE, EBADF, -1);
-        printf_impl::HandleSink sink (h);
-        return printf_impl::print (sink, format, args);
+        return print_to_handle (h, format, args);
     }
 
     return -1;
@@ -207,10 +219,9 @@ int Hprintf (HANDLE handle, const char* format, ...)
     CHECK_PARAM(handle != INVALID_HANDLE_VALUE, EINVAL, -1);
     CHECK_PARAM(format, EINVAL, -1);
 
-    printf_impl::HandleSink sink (handle);
     va_list args;
     va_start (args, format);
-    int ret = printf_impl::print (sink, format, args);
+    int ret = print_to_handle (handle, format, args);
     va_end (args);
 
     return ret;
@@ -221,10 +232,9 @@ int Hwprintf (HANDLE handle, const wchar_t* format, ...)
     CHECK_PARAM(handle != INVALID_HANDLE_VALUE, EINVAL, -1);
     CHECK_PARAM(format, EINVAL, -1);
 
-    printf_impl::HandleSink sink (handle);
     va_list args;
     va_start (args, format);
-    int ret = printf_impl::print (sink, format, args);
+    int ret = print_to_handle (handle, format, args);
     va_end (args);
 
     return ret;
@@ -235,8 +245,7 @@ int vHprintf (HANDLE handle, const wchar_t* format, va_list args)
     CHECK_PARAM(handle != INVALID_HANDLE_VALUE, EINVAL, -1);
     CHECK_PARAM(format, EINVAL, -1);
 
-    printf_impl::HandleSink sink (handle);
-    return printf_impl::print (sink, format, args);
+    return print_to_handle (handle, format, args);
 }
 
 int vHwprintf (HANDLE handle, const wchar_t* format, va_list args)
@@ -244,6 +253,5 @@ int vHwprintf (HANDLE handle, const wchar_t* format, va_list args)
     CHECK_PARAM(handle != INVALID_HANDLE_VALUE, EINVAL, -1);
     CHECK_PARAM(format, EINVAL, -1);
 
-    printf_impl::HandleSink sink (handle);
-    return printf_impl::print (sink, format, args);
+    return print_to_handle (handle, format, args);
 }
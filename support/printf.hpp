@@ -44,4 +44,13 @@ int vHprintf (HANDLE handle, const wchar_t* format, va_list args);
 int vHwprintf (HANDLE handle, const wchar_t* format, va_list args);
 //@}
 
+/**
+ * Buffer output to a file handle.
+ * Output is encoded as UTF-8 and written by a background thread.
+ * Buffered data is written out at exit and on unhandled exceptions.
+ */
+bool BufferHandleOutput (HANDLE handle);
+/// Wait until all buffered output was written
+void FlushBufferedOutput ();
+
 #endif // __SUPPORT_PRINTF_HPP__
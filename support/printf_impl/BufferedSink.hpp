@@ -0,0 +1,154 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+*/
+
+#ifndef __SUPPORT_PRINTF_IMPL_BUFFEREDSINK_HPP__
+#define __SUPPORT_PRINTF_IMPL_BUFFEREDSINK_HPP__
+
+#include "OutputBuffer.hpp"
+#include "Sink.hpp"
+
+namespace printf_impl
+{
+    /**
+     * Sink writing UTF-8 to an OutputBuffer.
+     * Output is collected locally and committed to the buffer in larger
+     * pieces, usually once per printf call.
+     */
+    class BufferedSink : public Sink
+    {
+        OutputBuffer& output;
+        char local[1024];
+        size_t local_len = 0;
+        bool failed = false;
+
+        void commit ()
+        {
+            if (local_len == 0) return;
+            if (output.Write (local, local_len) < 0) failed = true;
+            local_len = 0;
+        }
+        char* reserve (size_t n)
+        {
+            if (local_len + n > sizeof (local)) commit ();
+            return local + local_len;
+        }
+        void put_codepoint (unsigned int c)
+        {
+            char* p = reserve (4);
+            if (c < 0x80)
+            {
+                p[0] = static_cast<char> (c);
+                local_len += 1;
+            }
+            else if (c < 0x800)
+            {
+                p[0] = static_cast<char> (0xC0 | (c >> 6));
+                p[1] = static_cast<char> (0x80 | (c & 0x3F));
+                local_len += 2;
+            }
+            else if (c < 0x10000)
+            {
+                p[0] = static_cast<char> (0xE0 | (c >> 12));
+                p[1] = static_cast<char> (0x80 | ((c >> 6) & 0x3F));
+                p[2] = static_cast<char> (0x80 | (c & 0x3F));
+                local_len += 3;
+            }
+            else
+            {
+                p[0] = static_cast<char> (0xF0 | (c >> 18));
+                p[1] = static_cast<char> (0x80 | ((c >> 12) & 0x3F));
+                p[2] = static_cast<char> (0x80 | ((c >> 6) & 0x3F));
+                p[3] = static_cast<char> (0x80 | (c & 0x3F));
+                local_len += 4;
+            }
+        }
+    public:
+        BufferedSink (OutputBuffer& output) : output (output) {}
+        ~BufferedSink () { commit (); }
+
+        int operator()(const wchar_t* s, int n) override
+        {
+            // Encode directly to UTF-8, no need for WideCharToMultiByte()
+            for (int i = 0; i < n; i++)
+            {
+                unsigned int c = s[i];
+                if ((c >= 0xD800) && (c < 0xDC00) && (i + 1 < n)
+                    && (s[i + 1] >= 0xDC00) && (s[i + 1] < 0xE000))
+                {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (s[i + 1] - 0xDC00);
+                    i++;
+                }
+                else if ((c >= 0xD800) && (c < 0xE000))
+                {
+                    // Unpaired surrogate
+                    c = 0xFFFD;
+                }
+                put_codepoint (c);
+            }
+            return failed ? -1 : n;
+        }
+        int operator()(const char* s, int n) override
+        {
+            // Pure ASCII can be copied as-is
+            int ascii_len = 0;
+            while ((ascii_len < n) && (static_cast<unsigned char> (s[ascii_len]) < 0x80)) ascii_len++;
+            if (ascii_len == n) return ascii (s, n);
+
+            // Convert to wide char
+            int buf_req = MultiByteToWideChar (CP_ACP, 0, s, n, nullptr, 0);
+            if (buf_req == 0) return -1;
+            auto buf = static_cast<wchar_t*> (_malloca (buf_req * sizeof(wchar_t)));
+            int ret = -1;
+            if (MultiByteToWideChar (CP_ACP, 0, s, n, buf, buf_req) != 0)
+            {
+                ret = operator()(buf, buf_req);
+            }
+            _freea (buf);
+            return ret;
+        }
+        int ascii (const char* s, int n) override
+        {
+            int total = n;
+            while (n > 0)
+            {
+                size_t chunk = static_cast<size_t> (n);
+                if (chunk > sizeof (local)) chunk = sizeof (local);
+                char* p = reserve (chunk);
+                memcpy (p, s, chunk);
+                local_len += chunk;
+                s += chunk;
+                n -= static_cast<int> (chunk);
+            }
+            return failed ? -1 : total;
+        }
+    };
+} // namespace printf_impl
+
+#endif // __SUPPORT_PRINTF_IMPL_BUFFEREDSINK_HPP__
@@ -0,0 +1,92 @@
+/*
+    SevenInstall
+    Copyright (c) 2013-2021 Frank Richter
+
+    This is free and unencumbered software released into the public domain.
+
+    Anyone is free to copy, modify, publish, use, compile, sell, or
+    distribute this software, either in source code form or as a compiled
+    binary, for any purpose, commercial or non-commercial, and by any
+    means.
+
+    In jurisdictions that recognize copyright laws, the author or authors
+    of this software dedicate any and all copyright interest in the
+    software to the public domain. We make this dedication for the benefit
+    of the public at large and to the detriment of our heirs and
+    successors. We intend this dedication to be an overt act of
+    relinquishment in perpetuity of all present and future rights to this
+    software under copyright law.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+    OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+
+    For more information, please refer to <http://unlicense.org>
+*/
+
+#ifndef __SUPPORT_PRINTF_IMPL_OUTPUTBUFFER_HPP__
+#define __SUPPORT_PRINTF_IMPL_OUTPUTBUFFER_HPP__
+
+#include <windows.h>
+
+namespace printf_impl
+{
+    /**
+     * Ring buffer for output to a file handle.
+     * Data is written to the handle by a background thread, either when
+     * enough data accumulated or after a short delay.
+     */
+    class OutputBuffer
+    {
+        HANDLE handle;
+        char* buffer = nullptr;
+        size_t capacity = 0;
+        /// Write position (total bytes committed)
+        size_t head = 0;
+        /// Read position (total bytes written to handle)
+        size_t tail = 0;
+        /// Position up to which data should be written without delay
+        size_t flushTarget = 0;
+        bool stop = false;
+        bool error = false;
+
+        SRWLOCK lock = SRWLOCK_INIT;
+        CONDITION_VARIABLE dataAvailable = CONDITION_VARIABLE_INIT;
+        CONDITION_VARIABLE spaceAvailable = CONDITION_VARIABLE_INIT;
+        HANDLE thread = nullptr;
+
+        static DWORD WINAPI ThreadProc (void* param);
+        void WriterLoop ();
+    public:
+        OutputBuffer (HANDLE handle) : handle (handle) {}
+        ~OutputBuffer () { Stop (); delete[] buffer; }
+
+        /// Allocate buffer and start writer thread
+        bool Start (size_t size);
+        /// Write out all remaining data and stop writer thread
+        void Stop ();
+
+        HANDLE GetHandle () const { return handle; }
+
+        /**
+         * Add data to the buffer. Blocks if the buffer is full.
+         * After Stop(), data is written to the handle directly.
+         */
+        int Write (const char* s, size_t n);
+        /**
+         * Wait until all buffered data was written (or \a timeout elapsed).
+         * With a timeout, the lock is only tried, so this is safe to call from
+         * an exception filter.
+         */
+        bool Flush (DWORD timeout = INFINITE);
+    };
+
+    /// Return the output buffer for a handle, if output to it is buffered
+    OutputBuffer* GetOutputBuffer (HANDLE handle);
+} // namespace printf_impl
+
+#endif // __SUPPORT_PRINTF_IMPL_OUTPUTBUFFER_HPP__
@@ -28,6 +28,8 @@
     For more information, please refer to <http://unlicense.org>
 */
 
+#include "printf.hpp"
+
 #include <stdio.h>
 #include <windows.h>
 
@@ -48,6 +50,7 @@ extern "C" int fflush (FILE* stream)
 {
   bool flush_stdout = (stream == stdout) || (stream == nullptr);
   bool flush_stderr = (stream == stderr) || (stream == nullptr);
+  FlushBufferedOutput ();
   if (flush_stdout) FlushFileBuffers (GetStdHandle (STD_OUTPUT_HANDLE));
   if (flush_stderr) FlushFileBuffers (GetStdHandle (STD_ERROR_HANDLE));
   return (flush_stdout ? 1 : 0) + (flush_stderr ? 1 : 0);